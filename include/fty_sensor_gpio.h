@@ -35,6 +35,19 @@ using namespace std;
 //  Add your own public definitions here, if you need them
 #define FTY_SENSOR_GPIO_AGENT "fty-sensor-gpio"
 #define DEFAULT_POLL_INTERVAL 2000
+#define DEFAULT_TICK_BUDGET 50
+#define DEFAULT_MAILBOX_BUDGET 16
+#define DEFAULT_FLAP_WINDOW 60000
+#define DEFAULT_FLAP_THRESHOLD 10
+#define DEFAULT_FLAP_RATE_LIMIT 60000
+#define DEFAULT_HISTORY_SIZE 64
+#define DEFAULT_COUNTER_WINDOW 60000
+#define DEFAULT_DWELL_INTERVAL 300000
+#define DEFAULT_STATS_INTERVAL 0
+#define DEFAULT_PROMETHEUS_INTERVAL 15000
+#define DEFAULT_SHM_CAPACITY 256
+#define GPIO_ALERT_TTL 750
+#define GPIO_ABNORMAL_COUNT_TTL 300
 #define DEFAULT_STATEFILE_PATH "/var/lib/fty/fty-sensor-gpio/state"
 
 // TODO: get from config
@@ -61,8 +74,47 @@ typedef struct _gpx_info_s {
     char* alarm_message;  // Alert message to publish
     char* alarm_severity; // Applied severity
     bool alert_triggered;   //flag to remember if an alert has been fired
+    int alert_abnormal;   // Consecutive samples in abnormal state, for the local alerts
+    int alert_normal;     // Consecutive samples in normal state, for the local alerts
+    int64_t alert_published; // Monotonic timestamp of the last ACTIVE local alert, msec
+    int poll_interval;    // Sensor specific check interval, msec (0: use the agent one)
+    int burst_interval;   // Check interval after a state change, msec (0: no burst mode)
+    int burst_duration;   // Duration of the burst mode after a state change, msec
+    int64_t next_poll;    // Monotonic deadline of the next check, msec (0: not scheduled)
+    int64_t burst_until;  // Monotonic end of the burst mode, msec
+    double poll_phase;    // Phase of the checks within the interval, [0, 1[ (-1: not set)
+    uint64_t samples;     // Number of samples read
+    int64_t last_sample;  // Monotonic timestamp of the last sample, msec
+    double sample_period; // Moving average of the achieved sampling period, msec
+    struct _gpio_filter_t *filter; // Debounce filter of the GPI samples (NULL: raw samples)
+    int oversample;       // Number of samples read per check
+    struct _gpio_flap_t *flap; // Flapping detector (NULL: disabled)
+    int flap_rate_limit;  // Minimum interval between publications while flapping, msec
+    int64_t last_publish; // Monotonic timestamp of the last publication, msec
+    int change_state;     // State as of the last change
+    int64_t last_change;  // Wall clock timestamp of the last state change, msec (0: unknown)
+    struct _gpio_history_t *history; // Recent states history (NULL: disabled)
+    char* counter_edge;   // Edge(s) counted as pulses, rising | falling | both (NULL: not a counter)
+    struct _gpio_counter_t *counter; // Pulse counter of a GPI in counter mode (NULL: level sensor)
+    int64_t state_time [2];      // Cumulative time spent closed / opened, msec
+    int64_t state_since;  // Monotonic timestamp of the last time accounting, msec (0: none yet)
+    int64_t dwell_published [2]; // Cumulative times as of their last publication, msec
+    struct _gpio_expr_t *expr; // Expression of a virtual sensor over other sensors (NULL: physical sensor)
+    int64_t sample_mono_ns; // Monotonic time of the last sample or edge, nsec (0: none yet)
+    int64_t sample_time_ns; // Wall clock time of the last sample or edge, nsec
+    int64_t raw_change_ns;  // Monotonic time of the first raw sample differing from the state, nsec (0: none)
+    int64_t accept_mono_ns; // Monotonic time of the last state change accepted, until published, nsec (0: none)
 } _gpx_info_t;
 
+// Counter of the GPI in abnormal state, for a sensor type and a location
+typedef struct _gpx_abnormal_s {
+    char* type;           // GPI sensor type
+    char* location;       // Location of the sensors
+    int count;            // Number of sensors in abnormal state
+    bool changed;         // Changed since its last publication
+    int64_t last_publish; // Monotonic timestamp of the last publication, msec
+} _gpx_abnormal_t;
+
 // Config file accessors
 const char* s_get (zconfig_t *config, const char* key, std::string &dfl);
 const char* s_get (zconfig_t *config, const char* key, const char*dfl);
@@ -70,6 +122,12 @@ const char* s_get (zconfig_t *config, const char* key, const char*dfl);
 // Implemented in assets actor
 extern zlistx_t *_gpx_list;
 extern zlistx_t * get_gpx_list(bool verbose);
+extern _gpx_info_t * get_gpx_info(const char *name);
+extern struct _gpio_index_t * get_gpx_attribute_index(const char *attribute);
+extern void update_gpx_state_index(_gpx_info_t *gpx_info, int previous_state);
+extern void update_gpx_abnormal(_gpx_info_t *gpx_info, int previous_state);
+extern _gpx_abnormal_t * pop_gpx_abnormal_change(void);
+extern zhashx_t * get_gpx_abnormal(void);
 extern pthread_mutex_t gpx_list_mutex;
 
 // Implemented in server actor
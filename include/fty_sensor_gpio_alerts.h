@@ -27,17 +27,32 @@ extern "C" {
 #endif
 
 //  @interface
-//  fty_sensor_gpio_alerts actor
-FTY_SENSOR_GPIO_EXPORT void
-fty_sensor_gpio_alerts(zsock_t *pipe, void *args);
-
 //  Create a new fty_sensor_gpio_alerts
-//FTY_SENSOR_GPIO_EXPORT fty_sensor_gpio_alerts_t *
-//    fty_sensor_gpio_alerts_new (void);
+FTY_SENSOR_GPIO_EXPORT fty_sensor_gpio_alerts_t *
+    fty_sensor_gpio_alerts_new (const char* name);
 
 //  Destroy the fty_sensor_gpio_alerts
-//FTY_SENSOR_GPIO_EXPORT void
-//    fty_sensor_gpio_alerts_destroy (fty_sensor_gpio_alerts_t **self_p);
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_alerts_destroy (fty_sensor_gpio_alerts_t **self_p);
+
+//  Connect to malamute, to publish the alerts on the _ALERTS_SYS stream.
+//  Return 0 if OK, -1 otherwise
+FTY_SENSOR_GPIO_EXPORT int
+    fty_sensor_gpio_alerts_connect (fty_sensor_gpio_alerts_t *self, const char *endpoint);
+
+//  Set the verbosity
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_alerts_set_verbose (fty_sensor_gpio_alerts_t *self, bool verbose);
+
+//  Set the number of consecutive samples needed to raise and to resolve an
+//  alert (default: 1)
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_alerts_set_hysteresis (fty_sensor_gpio_alerts_t *self, int active_count, int resolve_count);
+
+//  Evaluate a sample of the state of a sensor against its normal state, and
+//  publish an alert on transitions (gpx_list_mutex held by the caller)
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_alerts_check (fty_sensor_gpio_alerts_t *self, struct _gpx_info_s *gpx_info);
 
 //  Self test of this class
 FTY_SENSOR_GPIO_EXPORT void
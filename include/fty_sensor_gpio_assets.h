@@ -53,6 +53,9 @@ FTY_SENSOR_GPIO_EXPORT int
     const char* sensor_location, const char* sensor_power_source,
     const char* sensor_alarm_message, const char* sensor_alarm_severity);
 
+FTY_SENSOR_GPIO_EXPORT int
+    delete_sensor(fty_sensor_gpio_assets_t *self, const char* assetname);
+
 FTY_SENSOR_GPIO_EXPORT void
     request_sensor_power_source(fty_sensor_gpio_assets_t *self, const char* asset_name);
 
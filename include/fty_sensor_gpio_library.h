@@ -85,6 +85,10 @@ typedef struct _fty_sensor_gpio_assets_t fty_sensor_gpio_assets_t;
 #define FTY_SENSOR_GPIO_ASSETS_T_DEFINED
 typedef struct _fty_sensor_gpio_server_t fty_sensor_gpio_server_t;
 #define FTY_SENSOR_GPIO_SERVER_T_DEFINED
+typedef struct _fty_sensor_gpio_alerts_t fty_sensor_gpio_alerts_t;
+#define FTY_SENSOR_GPIO_ALERTS_T_DEFINED
+typedef struct _fty_sensor_gpio_shm_t fty_sensor_gpio_shm_t;
+#define FTY_SENSOR_GPIO_SHM_T_DEFINED
 #endif // FTY_SENSOR_GPIO_BUILD_DRAFT_API
 
 
@@ -93,6 +97,8 @@ typedef struct _fty_sensor_gpio_server_t fty_sensor_gpio_server_t;
 #include "libgpio.h"
 #include "fty_sensor_gpio_assets.h"
 #include "fty_sensor_gpio_server.h"
+#include "fty_sensor_gpio_alerts.h"
+#include "fty_sensor_gpio_shm.h"
 #endif // FTY_SENSOR_GPIO_BUILD_DRAFT_API
 
 #ifdef FTY_SENSOR_GPIO_BUILD_DRAFT_API
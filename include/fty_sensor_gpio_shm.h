@@ -0,0 +1,121 @@
+/*  =========================================================================
+    fty_sensor_gpio_shm - Shared memory table of the sensors states
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef FTY_SENSOR_GPIO_SHM_H_INCLUDED
+#define FTY_SENSOR_GPIO_SHM_H_INCLUDED
+
+// Version of the layout of the shared memory table
+#define FTY_SENSOR_GPIO_SHM_VERSION   1
+// Size of the asset names, and of the port names, including the final '\0'
+#define FTY_SENSOR_GPIO_SHM_NAME_SIZE 64
+#define FTY_SENSOR_GPIO_SHM_PORT_SIZE 16
+
+// State of a sensor, as copied out of the table
+typedef struct {
+    char    asset_name [FTY_SENSOR_GPIO_SHM_NAME_SIZE]; // Sensor asset name
+    char    port [FTY_SENSOR_GPIO_SHM_PORT_SIZE]; // Port name (GPIn, GPOn, VGIn)
+    int32_t direction;  // GPIO_DIRECTION_IN | GPIO_DIRECTION_OUT
+    int32_t number;     // GPI or GPO number
+    int32_t state;      // GPIO_STATE_CLOSED | GPIO_STATE_OPENED | GPIO_STATE_UNKNOWN
+    int32_t reserved;
+    int64_t time_ns;    // Wall clock time of the last change of the state, nsec (0: unknown)
+} fty_sensor_gpio_shm_entry_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create (or reset) the table at path, for the agent to write the states of
+//  up to capacity sensors into it. An existing table is never shrunk, so its
+//  capacity may end up larger. Return NULL on error.
+FTY_SENSOR_GPIO_EXPORT fty_sensor_gpio_shm_t *
+    fty_sensor_gpio_shm_new (const char *path, size_t capacity);
+
+//  @interface
+//  Map the table at path, read only, for a local consumer. Return NULL if
+//  it does not exist, or is not a table of this version.
+FTY_SENSOR_GPIO_EXPORT fty_sensor_gpio_shm_t *
+    fty_sensor_gpio_shm_open (const char *path);
+
+//  @interface
+//  Write the state of a sensor in place, in its slot (a free one for a new
+//  sensor). Nothing is written if the entry is unchanged. Return the slot,
+//  or -1 if the table is full.
+FTY_SENSOR_GPIO_EXPORT int
+    fty_sensor_gpio_shm_update (fty_sensor_gpio_shm_t *self, const fty_sensor_gpio_shm_entry_t *entry);
+
+//  @interface
+//  Free the slot of a sensor
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_shm_remove (fty_sensor_gpio_shm_t *self, const char *asset_name);
+
+//  @interface
+//  Start a sweep of the sensors: the ones which are not updated until the
+//  end of the sweep get their slot freed then
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_shm_sweep_begin (fty_sensor_gpio_shm_t *self);
+
+//  @interface
+//  End a sweep of the sensors, freeing the slots of those not updated
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_shm_sweep_end (fty_sensor_gpio_shm_t *self);
+
+//  @interface
+//  Get the number of slots of the table
+FTY_SENSOR_GPIO_EXPORT size_t
+    fty_sensor_gpio_shm_capacity (fty_sensor_gpio_shm_t *self);
+
+//  @interface
+//  Get the version of the content of the table, incremented by each write,
+//  so that a consumer can cheaply tell whether anything changed
+FTY_SENSOR_GPIO_EXPORT uint64_t
+    fty_sensor_gpio_shm_generation (fty_sensor_gpio_shm_t *self);
+
+//  @interface
+//  Copy a consistent snapshot of a slot, without any lock. Return 0 if the
+//  slot holds a sensor, -1 if it is free, out of range, or if it could not
+//  be read consistently (writer stopped in the middle of a write).
+FTY_SENSOR_GPIO_EXPORT int
+    fty_sensor_gpio_shm_read (fty_sensor_gpio_shm_t *self, size_t slot, fty_sensor_gpio_shm_entry_t *entry);
+
+//  @interface
+//  Copy a consistent snapshot of the state of a sensor, by asset name.
+//  Return 0 if found, -1 otherwise.
+FTY_SENSOR_GPIO_EXPORT int
+    fty_sensor_gpio_shm_find (fty_sensor_gpio_shm_t *self, const char *asset_name, fty_sensor_gpio_shm_entry_t *entry);
+
+//  Destroy the fty_sensor_gpio_shm. The table itself is kept, so that
+//  consumers and a restarted agent keep on using the same mapping.
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_shm_destroy (fty_sensor_gpio_shm_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_EXPORT void
+    fty_sensor_gpio_shm_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -43,6 +43,14 @@
 #define GPIO_POWERED_SELF        1
 #define GPIO_POWERED_EXTERNAL    2
 
+// Statistics of the accesses to the GPIOs
+#define GPIO_STAT_READS      0  // GPIO reads
+#define GPIO_STAT_WRITES     1  // GPIO writes
+#define GPIO_STAT_SYSCALLS   2  // System calls on the sysfs
+#define GPIO_STAT_FAILURES   3  // Failed reads and writes
+#define GPIO_STAT_RETRIES    4  // Retries of the direction setting (500 msec sleeps)
+#define GPIO_STATS           5
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -67,6 +75,30 @@ FTY_SENSOR_GPIO_EXPORT int
 FTY_SENSOR_GPIO_EXPORT int
     libgpio_write (libgpio_t *self_p, int GPO_number, int value);
 
+//  @interface
+//  Write several GPOs at once, storing each result (0 or -1) in 'results'
+//  if not NULL. Return the number of failed writes.
+FTY_SENSOR_GPIO_EXPORT int
+    libgpio_write_bulk (libgpio_t *self, int count, const int *GPO_numbers, const int *values, int *results);
+
+//  @interface
+//  Watch the edges ("rising", "falling" or "both") of a GPI. Return a
+//  descriptor which signals POLLPRI upon each edge, or -1 on failure
+FTY_SENSOR_GPIO_EXPORT int
+    libgpio_watch (libgpio_t *self, int GPI_number, const char *edge);
+
+//  @interface
+//  Acknowledge an edge signaled on a watched GPI descriptor, and return the
+//  current value of the GPI, or -1 on failure. Unlike the other functions,
+//  it may be called from another thread than the one using the library.
+FTY_SENSOR_GPIO_EXPORT int
+    libgpio_watch_ack (libgpio_t *self, int fd);
+
+//  @interface
+//  Stop watching the edges of a GPI, closing its descriptor if valid
+FTY_SENSOR_GPIO_EXPORT void
+    libgpio_unwatch (libgpio_t *self, int GPI_number, int fd);
+
 //  @interface
 //  Get the textual name for a status
 FTY_SENSOR_GPIO_EXPORT const string
@@ -114,12 +146,14 @@ FTY_SENSOR_GPIO_EXPORT int
 
 //  @interface
 // Add mapping GPI number -> HW pin number
-FTY_SENSOR_GPIO_EXPORT void
+//  Return 0 on success, -1 if the port is out of the supported GPI range
+FTY_SENSOR_GPIO_EXPORT int
     libgpio_add_gpi_mapping (libgpio_t *self, int port_num, int pin_num);
 
 //  @interface
 // Add mapping GPO number -> HW pin number
-FTY_SENSOR_GPIO_EXPORT void
+//  Return 0 on success, -1 if the port is out of the supported GPO range
+FTY_SENSOR_GPIO_EXPORT int
     libgpio_add_gpo_mapping (libgpio_t *self, int port_num, int pin_num);
 
 //  @interface
@@ -132,6 +166,35 @@ FTY_SENSOR_GPIO_EXPORT void
 FTY_SENSOR_GPIO_EXPORT void
     libgpio_set_verbose (libgpio_t *self, bool verbose);
 
+//  @interface
+//  Get a statistic (GPIO_STAT_*) of the accesses to the GPIOs. Statistics
+//  are updated without locking, and can be read from any thread.
+FTY_SENSOR_GPIO_EXPORT uint64_t
+    libgpio_get_stat (libgpio_t *self, int stat);
+
+//  @interface
+//  Record the transitions of the GPIOs read and of the GPOs written to a
+//  trace file, from now on (path NULL: stop recording), instead of any trace
+//  replayed.
+//  Return 0 if OK, -1 otherwise.
+FTY_SENSOR_GPIO_EXPORT int
+    libgpio_record (libgpio_t *self, const char *path);
+
+//  @interface
+//  Replay a trace file instead of accessing the GPIOs (path NULL: stop
+//  replaying), instead of any trace recorded. The reads return the values of
+//  the trace as of the time elapsed since this call multiplied by speed, or
+//  with one more event per read if speed is 0. The writes only update the
+//  value of the GPOs, and the edges can't be watched. Return 0 if OK, -1
+//  otherwise.
+FTY_SENSOR_GPIO_EXPORT int
+    libgpio_replay (libgpio_t *self, const char *path, double speed);
+
+//  @interface
+//  Get the number of events of the trace not replayed yet
+FTY_SENSOR_GPIO_EXPORT size_t
+    libgpio_replay_remaining (libgpio_t *self);
+
 //  Destroy the libgpio
 FTY_SENSOR_GPIO_EXPORT void
     libgpio_destroy (libgpio_t **self_p);
@@ -53,38 +53,74 @@ usage(){
 
 }
 
-// Send an update request over the MQ to check for GPIO status
+// Startup sequencing context, shared by the main loop handlers
+typedef struct {
+    zactor_t *server;         // server actor
+    zactor_t *assets;         // assets actor
+    int64_t  start;           // monotonic timestamp of the agent startup, msec
+    int      hwcap_attempts;  // number of HW_CAP requests sent
+    int      hwcap_backoff;   // delay before the next HW_CAP retry, msec
+    bool     assets_enabled;  // assets actor has been enabled
+    bool     verbose;
+} startup_t;
+
+// Bounds of the exponential backoff for HW_CAP retries, msec
+#define HWCAP_RETRY_MIN      1000
+#define HWCAP_RETRY_MAX     30000
+
+// Request HW_CAP to do the initial configuration for local GPI/GPO
 static int
-s_update_event (zloop_t *loop, int timer_id, void *output)
+s_request_hwcap_event (zloop_t *loop, int timer_id, void *arg)
 {
-    zstr_send (output, "UPDATE");
+    startup_t *startup = (startup_t *) arg;
+    startup->hwcap_attempts++;
+    zstr_send (startup->server, "HW_CAP");
     return 0;
 }
 
-// Schedule HW_CAP request to do the initial configuration for local GPI/GPO
+// Handle the notifications from the server and assets actors:
+// * HW_CAP/OK|ERROR: enable the assets actor as soon as the server actor is
+//   configured, or retry later with an exponential backoff
+// * ASSETS_READY: trigger the first poll as soon as the inventory is known
 static int
-s_request_hwcap_event (zloop_t *loop, int timer_id, void *output)
+s_actor_event (zloop_t *loop, zsock_t *reader, void *arg)
 {
-    if (!hw_cap_inited) {
-        zstr_send (output, "HW_CAP");
-        return 0;
-    }
-    else // we can stop this timer, valid reply received
-        return zloop_timer_end (loop, timer_id);
-}
+    startup_t *startup = (startup_t *) arg;
+    zmsg_t *message = zmsg_recv (reader);
+    if (!message)
+        return -1;
+    char *event = zmsg_popstr (message);
+    char *status = zmsg_popstr (message);
+    int64_t elapsed = zclock_mono () - startup->start;
 
-// Condition asset actor on the successful configuration of server actor (HW_CAP)
-static int
-s_server_ready_event (zloop_t *loop, int timer_id, void *output)
-{
-    if (hw_cap_inited) {
-        zstr_sendx (output, "PRODUCER", FTY_PROTO_STREAM_ASSETS, NULL);
-        zstr_sendx (output, "CONSUMER", FTY_PROTO_STREAM_ASSETS, ".*", NULL);
-        // we can now stop this timer
-        return zloop_timer_end (loop, timer_id);
+    if (event && streq (event, "HW_CAP")) {
+        if (status && streq (status, "OK")) {
+            zsys_info ("startup: HW capabilities configured after %" PRIi64 " ms (%d attempt(s))",
+                elapsed, startup->hwcap_attempts);
+            if (!startup->assets_enabled) {
+                zstr_sendx (startup->assets, "PRODUCER", FTY_PROTO_STREAM_ASSETS, NULL);
+                zstr_sendx (startup->assets, "CONSUMER", FTY_PROTO_STREAM_ASSETS, ".*", NULL);
+                startup->assets_enabled = true;
+                my_zsys_debug (startup->verbose, "startup: assets actor enabled after %" PRIi64 " ms", elapsed);
+            }
+        }
+        else {
+            zsys_warning ("startup: HW capabilities request failed, retrying in %d ms",
+                startup->hwcap_backoff);
+            zloop_timer (loop, startup->hwcap_backoff, 1, s_request_hwcap_event, startup);
+            startup->hwcap_backoff *= 2;
+            if (startup->hwcap_backoff > HWCAP_RETRY_MAX)
+                startup->hwcap_backoff = HWCAP_RETRY_MAX;
+        }
+    }
+    else if (event && streq (event, "ASSETS_READY")) {
+        zsys_info ("startup: sensors inventory loaded after %" PRIi64 " ms, first poll triggered", elapsed);
+        zstr_send (startup->server, "UPDATE");
     }
-    else // continue to loop
-        return 0;
+    zstr_free (&event);
+    zstr_free (&status);
+    zmsg_destroy (&message);
+    return 0;
 }
 
 int main (int argc, char *argv [])
@@ -96,8 +132,22 @@ int main (int argc, char *argv [])
     char* endpoint = NULL;
     const char* str_poll_interval = NULL;
     int poll_interval = DEFAULT_POLL_INTERVAL;
+    int tick_budget = DEFAULT_TICK_BUDGET;
+    int mailbox_budget = DEFAULT_MAILBOX_BUDGET;
+    int dwell_interval = DEFAULT_DWELL_INTERVAL;
+    int stats_interval = DEFAULT_STATS_INTERVAL;
+    std::string prometheus_file;
+    int prometheus_interval = DEFAULT_PROMETHEUS_INTERVAL;
+    std::string shm_file;
+    std::string gpio_record;
+    std::string gpio_replay;
+    std::string gpio_replay_speed = "1";
+    bool alerts_enabled = false;
+    std::string alerts_active_count = "1";
+    std::string alerts_resolve_count = "1";
     bool verbose = false;
     int argn;
+    int64_t startup_start = zclock_mono ();
 
     // Parse command line
     for (argn = 1; argn < argc; argn++) {
@@ -149,6 +199,35 @@ int main (int argc, char *argv [])
             poll_interval = atoi(str_poll_interval);
         }
         my_zsys_debug (verbose, "Polling interval set to %i", poll_interval);
+        // Time budget of a polling tick
+        tick_budget = atoi (s_get (config, "server/tick_budget", std::to_string (DEFAULT_TICK_BUDGET).c_str ()));
+        my_zsys_debug (verbose, "Polling tick budget set to %i", tick_budget);
+        mailbox_budget = atoi (s_get (config, "server/mailbox_budget", std::to_string (DEFAULT_MAILBOX_BUDGET).c_str ()));
+        my_zsys_debug (verbose, "Mailbox budget set to %i", mailbox_budget);
+        // Interval between publications of the times in state
+        dwell_interval = atoi (s_get (config, "server/dwell_interval", std::to_string (DEFAULT_DWELL_INTERVAL).c_str ()));
+        my_zsys_debug (verbose, "Times in state publication interval set to %i", dwell_interval);
+        // Interval between publications of the agent statistics
+        stats_interval = atoi (s_get (config, "server/stats_interval", std::to_string (DEFAULT_STATS_INTERVAL).c_str ()));
+        my_zsys_debug (verbose, "Statistics publication interval set to %i", stats_interval);
+        // Prometheus text file, for the textfile collector of the node exporter
+        prometheus_file = s_get (config, "server/prometheus_file", "");
+        prometheus_interval = atoi (s_get (config, "server/prometheus_interval", std::to_string (DEFAULT_PROMETHEUS_INTERVAL).c_str ()));
+        my_zsys_debug (verbose, "Prometheus file '%s' written every %i", prometheus_file.c_str (), prometheus_interval);
+        // Shared memory table of the sensors states, opt-in for local consumers
+        shm_file = s_get (config, "server/shm_file", "");
+        my_zsys_debug (verbose, "Shared memory table set to '%s'", shm_file.c_str ());
+        // Record or replay of GPIO traces, for troubleshooting and benchmarks
+        gpio_record = s_get (config, "server/gpio_record", "");
+        gpio_replay = s_get (config, "server/gpio_replay", "");
+        gpio_replay_speed = s_get (config, "server/gpio_replay_speed", "1");
+        my_zsys_debug (verbose, "GPIO trace recorded to '%s', replayed from '%s' at speed %s",
+            gpio_record.c_str (), gpio_replay.c_str (), gpio_replay_speed.c_str ());
+        // Local alerts generation, opt-in as fty-alert-engine raises them
+        // from the metrics otherwise
+        alerts_enabled = streq (s_get (config, "alerts/enabled", "false"), "true");
+        alerts_active_count = s_get (config, "alerts/active_count", "1");
+        alerts_resolve_count = s_get (config, "alerts/resolve_count", "1");
         if (endpoint) zstr_free(&endpoint);
         endpoint = strdup(s_get (config, "malamute/endpoint", NULL));
         actor_name = strdup(s_get (config, "malamute/address", NULL));
@@ -216,19 +295,58 @@ int main (int argc, char *argv [])
     zstr_sendx (server, "TEMPLATE_DIR", template_dir, NULL);
     //zstr_sendx (server, "HW_CAP", NULL);
     zstr_sendx (server, "STATEFILE", state_file, NULL);
+    zstr_sendx (server, "TICK_BUDGET", std::to_string (tick_budget).c_str (), NULL);
+    zstr_sendx (server, "MAILBOX_BUDGET", std::to_string (mailbox_budget).c_str (), NULL);
+    zstr_sendx (server, "POLL_INTERVAL", std::to_string (poll_interval).c_str (), NULL);
+    zstr_sendx (server, "DWELL_INTERVAL", std::to_string (dwell_interval).c_str (), NULL);
+    zstr_sendx (server, "STATS_INTERVAL", std::to_string (stats_interval).c_str (), NULL);
+    zstr_sendx (server, "PROMETHEUS_INTERVAL", std::to_string (prometheus_interval).c_str (), NULL);
+    zstr_sendx (server, "PROMETHEUS_FILE", prometheus_file.c_str (), NULL);
+    zstr_sendx (server, "SHM", shm_file.c_str (), NULL);
+    // Local alerts generation, evaluated upon each sample
+    if (alerts_enabled)
+        zstr_sendx (server, "ALERTS", alerts_active_count.c_str (), alerts_resolve_count.c_str (), NULL);
+    // Recording and replaying are exclusive, the replay prevails
+    if (!gpio_replay.empty ())
+        zstr_sendx (server, "GPIO_REPLAY", gpio_replay.c_str (), gpio_replay_speed.c_str (), NULL);
+    else if (!gpio_record.empty ())
+        zstr_sendx (server, "GPIO_RECORD", gpio_record.c_str (), NULL);
+    // Local GPI -> GPO automation rules
+    zconfig_t *rule = config? zconfig_locate (config, "automation") : NULL;
+    rule = rule? zconfig_child (rule) : NULL;
+    while (rule) {
+        zstr_sendx (server, "RULE", zconfig_name (rule),
+            zconfig_get (rule, "gpi", ""), zconfig_get (rule, "state", ""),
+            zconfig_get (rule, "delay", "0"), zconfig_get (rule, "gpo", ""),
+            zconfig_get (rule, "action", ""), zconfig_get (rule, "revert", "false"),
+            NULL);
+        rule = zconfig_next (rule);
+    }
 
     // 2nd stream to handle assets
     zstr_sendx (assets, "TEMPLATE_DIR", template_dir, NULL);
     zstr_sendx (assets, "CONNECT", endpoint, NULL);
 
     // Setup:
-    // * an update event message every x microseconds, to check GPI status
-    // * a request event message every 5 seconds, to request local HW capabilities
-    // * asset actor production/consumption when server actor has received local HW capabilities
+    // * GPI status check every x milliseconds, scheduled by the server actor
+    // * an immediate request of the local HW capabilities, retried with an
+    //   exponential backoff until the server actor reports success
+    // * asset actor production/consumption as soon as the server actor
+    //   reports that it has received local HW capabilities
+    // * a first poll as soon as the assets actor has loaded the inventory
+    startup_t startup;
+    startup.server = server;
+    startup.assets = assets;
+    startup.start = startup_start;
+    startup.hwcap_attempts = 0;
+    startup.hwcap_backoff = HWCAP_RETRY_MIN;
+    startup.assets_enabled = false;
+    startup.verbose = verbose;
+
     zloop_t *gpio_events = zloop_new();
-    zloop_timer (gpio_events, poll_interval, 0, s_update_event, server);
-    zloop_timer (gpio_events, 5000, 0, s_request_hwcap_event, server);
-    zloop_timer (gpio_events, 2000, 0, s_server_ready_event, assets);
+    zloop_reader (gpio_events, zactor_sock (server), s_actor_event, &startup);
+    zloop_reader (gpio_events, zactor_sock (assets), s_actor_event, &startup);
+    s_request_hwcap_event (gpio_events, -1, &startup);
     zloop_start (gpio_events);
 
     // Cleanup
@@ -0,0 +1,366 @@
+/*  =========================================================================
+    fty_sensor_gpio_alerts - 42ITy GPIO alerts handler
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_sensor_gpio_alerts - 42ITy GPIO alerts handler
+@discuss
+    Evaluate the state of the GPIs, including the virtual ones (VGI), against
+    the normal state of the sensor each time the server actor samples it,
+    and publish the related alerts on the _ALERTS_SYS stream:
+    * ACTIVE, once the sensor has been in abnormal state for 'active count'
+      consecutive samples,
+    * RESOLVED, once the sensor has been back to its normal state for
+      'resolve count' consecutive samples.
+    Alerts are only published on these transitions, and ACTIVE alerts are
+    refreshed before their TTL expires. The evaluation state is kept in the
+    sensor entry, so that it survives an update of the asset and goes away
+    with its deletion. The server actor owns this object, so that alerts
+    reach the bus in one hop, without consuming its own metrics back from
+    the broker.
+
+    The alert message comes from the sensor template ('alarm-message'), where
+    "$status", "$device_name" and "$location" are expanded.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Structure of our class
+
+struct _fty_sensor_gpio_alerts_t {
+    bool               verbose;       // is actor verbose or not
+    char               *name;         // actor name
+    mlm_client_t       *mlm;          // malamute client
+    int                active_count;  // Consecutive abnormal samples to raise an alert
+    int                resolve_count; // Consecutive normal samples to resolve an alert
+};
+
+//  --------------------------------------------------------------------------
+//  Create a new fty_sensor_gpio_alerts
+
+fty_sensor_gpio_alerts_t *
+fty_sensor_gpio_alerts_new (const char* name)
+{
+    fty_sensor_gpio_alerts_t *self = (fty_sensor_gpio_alerts_t *) zmalloc (sizeof (fty_sensor_gpio_alerts_t));
+    assert (self);
+
+    //  Initialize class properties
+    self->mlm           = mlm_client_new();
+    self->name          = strdup(name);
+    self->verbose       = false;
+    self->active_count  = 1;
+    self->resolve_count = 1;
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the fty_sensor_gpio_alerts
+
+void
+fty_sensor_gpio_alerts_destroy (fty_sensor_gpio_alerts_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        fty_sensor_gpio_alerts_t *self = *self_p;
+
+        //  Free class properties
+        zstr_free(&self->name);
+        mlm_client_destroy (&self->mlm);
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Replace all the occurrences of a variable in a string
+
+static void
+s_replace_all (std::string &str, const std::string &from, const std::string &to)
+{
+    size_t pos = 0;
+    while ((pos = str.find (from, pos)) != std::string::npos) {
+        str.replace (pos, from.length (), to);
+        pos += to.length ();
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Publish an alert for a sensor (gpx_list_mutex held by the caller)
+
+static void
+s_publish_alert (fty_sensor_gpio_alerts_t *self, _gpx_info_t *gpx_info, int state, const char *alert_state)
+{
+    std::string rule = std::string (gpx_info->type? gpx_info->type : "gpio")
+        + ".state-change@" + gpx_info->asset_name;
+    const char *severity = (gpx_info->alarm_severity && !streq (gpx_info->alarm_severity, ""))?
+        gpx_info->alarm_severity : "WARNING";
+
+    std::string description = gpx_info->alarm_message? gpx_info->alarm_message : "";
+    s_replace_all (description, "$status", libgpio_get_status_string (state));
+    s_replace_all (description, "$device_name", gpx_info->ext_name? gpx_info->ext_name : gpx_info->asset_name);
+    s_replace_all (description, "$location", gpx_info->location? gpx_info->location : "");
+
+    zlist_t *actions = zlist_new ();
+    zlist_autofree (actions);
+    zlist_append (actions, (void *) "EMAIL");
+
+    zmsg_t *msg = fty_proto_encode_alert (
+        NULL,
+        time (NULL),
+        GPIO_ALERT_TTL,
+        rule.c_str (),
+        gpx_info->asset_name,
+        alert_state,
+        severity,
+        description.c_str (),
+        actions);
+    zlist_destroy (&actions);
+    if (msg) {
+        std::string subject = rule + "/" + severity + "@" + gpx_info->asset_name;
+        my_zsys_debug (self->verbose, "%s: publishing %s alert %s (%s)",
+            self->name, alert_state, subject.c_str (), description.c_str ());
+        int r = mlm_client_send (self->mlm, subject.c_str (), &msg);
+        if (r != 0)
+            zsys_error ("%s: failed to send alert %s", self->name, subject.c_str ());
+        zmsg_destroy (&msg);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Connect to malamute, to publish the alerts on the _ALERTS_SYS stream.
+//  Return 0 if OK, -1 otherwise
+
+int
+fty_sensor_gpio_alerts_connect (fty_sensor_gpio_alerts_t *self, const char *endpoint)
+{
+    assert (self);
+    if (mlm_client_connect (self->mlm, endpoint, 5000, self->name) == -1) {
+        zsys_error ("%s:\tConnection to endpoint '%s' failed", self->name, endpoint);
+        return -1;
+    }
+    mlm_client_set_producer (self->mlm, FTY_PROTO_STREAM_ALERTS_SYS);
+    my_zsys_debug (self->verbose, "%s: CONNECT %s", self->name, endpoint);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the verbosity
+
+void
+fty_sensor_gpio_alerts_set_verbose (fty_sensor_gpio_alerts_t *self, bool verbose)
+{
+    assert (self);
+    self->verbose = verbose;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the number of consecutive samples needed to raise and to resolve an
+//  alert (at least 1)
+
+void
+fty_sensor_gpio_alerts_set_hysteresis (fty_sensor_gpio_alerts_t *self, int active_count, int resolve_count)
+{
+    assert (self);
+    self->active_count = (active_count < 1)? 1 : active_count;
+    self->resolve_count = (resolve_count < 1)? 1 : resolve_count;
+    my_zsys_debug (self->verbose, "%s: HYSTERESIS=%d/%d", self->name,
+        self->active_count, self->resolve_count);
+}
+
+//  --------------------------------------------------------------------------
+//  Evaluate a sample of the state of a sensor, and publish an alert on
+//  transitions (gpx_list_mutex held by the caller)
+
+void
+fty_sensor_gpio_alerts_check (fty_sensor_gpio_alerts_t *self, _gpx_info_t *gpx_info)
+{
+    assert (self);
+    // GPO statuses are actions, not alarms, while virtual sensors (VGI)
+    // alarm like the physical ones
+    if ((gpx_info->gpx_direction != GPIO_DIRECTION_IN) || gpx_info->counter
+        || (gpx_info->current_state == GPIO_STATE_UNKNOWN))
+        return;
+    if (gpx_info->normal_state == GPIO_STATE_UNKNOWN) {
+        // Not monitored
+        gpx_info->alert_abnormal = 0;
+        gpx_info->alert_normal = 0;
+        return;
+    }
+    int state = gpx_info->current_state;
+
+    if (state != gpx_info->normal_state) {
+        gpx_info->alert_abnormal++;
+        gpx_info->alert_normal = 0;
+    }
+    else {
+        gpx_info->alert_normal++;
+        gpx_info->alert_abnormal = 0;
+    }
+
+    int64_t now = zclock_mono ();
+    if (!gpx_info->alert_triggered && (gpx_info->alert_abnormal >= self->active_count)) {
+        gpx_info->alert_triggered = true;
+        s_publish_alert (self, gpx_info, state, "ACTIVE");
+        gpx_info->alert_published = now;
+    }
+    else
+    if (gpx_info->alert_triggered && (gpx_info->alert_normal >= self->resolve_count)) {
+        gpx_info->alert_triggered = false;
+        s_publish_alert (self, gpx_info, state, "RESOLVED");
+    }
+    else
+    if (gpx_info->alert_triggered && (state != gpx_info->normal_state)
+        && (now - gpx_info->alert_published >= GPIO_ALERT_TTL * 1000 / 2)) {
+        // Refresh the active alert before it expires
+        s_publish_alert (self, gpx_info, state, "ACTIVE");
+        gpx_info->alert_published = now;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+//  Receive the next alert, and check its state
+static void
+s_assert_alert (mlm_client_t *client, const char *state, const char *description)
+{
+    zpoller_t *poller = zpoller_new (mlm_client_msgpipe (client), NULL);
+    void *which = zpoller_wait (poller, 5000);
+    zpoller_destroy (&poller);
+    assert (which);
+    zmsg_t *msg = mlm_client_recv (client);
+    assert (msg);
+    assert (streq (mlm_client_subject (client), "door-contact-sensor.state-change@sensorgpio-20/WARNING@sensorgpio-20"));
+    fty_proto_t *alert = fty_proto_decode (&msg);
+    assert (alert);
+    assert (fty_proto_id (alert) == FTY_PROTO_ALERT);
+    assert (streq (fty_proto_rule (alert), "door-contact-sensor.state-change@sensorgpio-20"));
+    assert (streq (fty_proto_name (alert), "sensorgpio-20"));
+    assert (streq (fty_proto_state (alert), state));
+    assert (streq (fty_proto_severity (alert), "WARNING"));
+    assert (streq (fty_proto_description (alert), description));
+    fty_proto_destroy (&alert);
+}
+
+//  Sample a new state of a sensor, as the server actor does
+static void
+s_sample (fty_sensor_gpio_alerts_t *self, const char *assetname, int state)
+{
+    pthread_mutex_lock (&gpx_list_mutex);
+    _gpx_info_t *gpx_info = get_gpx_info (assetname);
+    assert (gpx_info);
+    gpx_info->current_state = state;
+    fty_sensor_gpio_alerts_check (self, gpx_info);
+    pthread_mutex_unlock (&gpx_list_mutex);
+}
+
+void
+fty_sensor_gpio_alerts_test (bool verbose)
+{
+    printf (" * fty_sensor_gpio_alerts: ");
+
+    //  @selftest
+
+    static const char* endpoint = "inproc://fty_sensor_gpio_alerts_test";
+
+    zactor_t *server = zactor_new (mlm_server, (void*) "Malamute");
+    zstr_sendx (server, "BIND", endpoint, NULL);
+    if (verbose)
+        zstr_send (server, "VERBOSE");
+
+    // Prepare the testbed with a GPI. The asset handler checks the GPx
+    // number against the count of GPIs of the process, which a libgpio sets
+    // (see the FIXME about sharing libgpio)
+    libgpio_t *gpio_lib = libgpio_new ();
+    libgpio_set_gpi_count (gpio_lib, 10);
+    libgpio_destroy (&gpio_lib);
+    fty_sensor_gpio_assets_t *assets_self = fty_sensor_gpio_assets_new("gpio-assets");
+    int rv = add_sensor(assets_self, "create",
+        "Eaton", "sensorgpio-20", "GPIO-Sensor-Door2",
+        "DCS001", "door-contact-sensor",
+        "closed", "1",
+        "GPI", "IPC1", "Rack2", "",
+        "Door $device_name in $location has been $status", "WARNING");
+    assert (rv == 0);
+
+    fty_sensor_gpio_alerts_t *self = fty_sensor_gpio_alerts_new ("gpio-alerts");
+    assert (self);
+    fty_sensor_gpio_alerts_set_verbose (self, verbose);
+    assert (fty_sensor_gpio_alerts_connect (self, endpoint) == 0);
+    fty_sensor_gpio_alerts_set_hysteresis (self, 1, 2);
+
+    mlm_client_t *alerts_listener = mlm_client_new ();
+    mlm_client_connect (alerts_listener, endpoint, 1000, "alerts_listener");
+    mlm_client_set_consumer (alerts_listener, FTY_PROTO_STREAM_ALERTS_SYS, ".*");
+    zclock_sleep (500);
+
+    // Test #1: normal state, no alert
+    s_sample (self, "sensorgpio-20", GPIO_STATE_CLOSED);
+
+    // Test #2: abnormal state raises an alert, only once
+    s_sample (self, "sensorgpio-20", GPIO_STATE_OPENED);
+    s_assert_alert (alerts_listener, "ACTIVE", "Door GPIO-Sensor-Door2 in Rack2 has been opened");
+    s_sample (self, "sensorgpio-20", GPIO_STATE_OPENED);
+
+    // Test #3: an update of the asset keeps the alert raised, and doesn't
+    // raise it again
+    rv = add_sensor(assets_self, "update",
+        "Eaton", "sensorgpio-20", "GPIO-Sensor-Door2",
+        "DCS001", "door-contact-sensor",
+        "closed", "1",
+        "GPI", "IPC1", "Rack2", "",
+        "Door $device_name in $location has been $status", "WARNING");
+    assert (rv == 0);
+    s_sample (self, "sensorgpio-20", GPIO_STATE_OPENED);
+
+    // Test #4: hysteresis, 2 normal samples are needed to resolve it
+    s_sample (self, "sensorgpio-20", GPIO_STATE_CLOSED);
+    s_sample (self, "sensorgpio-20", GPIO_STATE_CLOSED);
+    s_assert_alert (alerts_listener, "RESOLVED", "Door GPIO-Sensor-Door2 in Rack2 has been closed");
+
+    // Test #5: the evaluation state goes away with the asset, a new asset
+    // with the same name starts afresh
+    fty_sensor_gpio_alerts_set_hysteresis (self, 2, 2);
+    s_sample (self, "sensorgpio-20", GPIO_STATE_OPENED);
+    assert (delete_sensor (assets_self, "sensorgpio-20") == 0);
+    rv = add_sensor(assets_self, "create",
+        "Eaton", "sensorgpio-20", "GPIO-Sensor-Door2",
+        "DCS001", "door-contact-sensor",
+        "closed", "1",
+        "GPI", "IPC1", "Rack2", "",
+        "Door $device_name in $location has been $status", "WARNING");
+    assert (rv == 0);
+    s_sample (self, "sensorgpio-20", GPIO_STATE_OPENED);
+
+    // Nothing else has been published
+    zpoller_t *poller = zpoller_new (mlm_client_msgpipe (alerts_listener), NULL);
+    assert (zpoller_wait (poller, 500) == NULL);
+    zpoller_destroy (&poller);
+
+    mlm_client_destroy (&alerts_listener);
+    fty_sensor_gpio_alerts_destroy (&self);
+    fty_sensor_gpio_assets_destroy (&assets_self);
+    zactor_destroy (&server);
+    //  @end
+    printf ("OK\n");
+}
@@ -30,6 +30,17 @@
 
 // List of monitored GPx
 zlistx_t *_gpx_list = NULL;
+// Index of the monitored GPx, by asset and ext name
+zhashx_t *_gpx_index = NULL;
+// Secondary indexes of the monitored GPx, by location, type, parent and state
+gpio_index_t *_gpx_by_location = NULL;
+gpio_index_t *_gpx_by_type = NULL;
+gpio_index_t *_gpx_by_parent = NULL;
+gpio_index_t *_gpx_by_state = NULL;
+// Counters of the monitored GPI in abnormal state, by "<type>@<location>"
+zhashx_t *_gpx_abnormal = NULL;
+// Counters changed since their last publication (_gpx_abnormal_t, not owned)
+zlistx_t *_gpx_abnormal_changes = NULL;
 // GPx list protection mutex
 pthread_mutex_t gpx_list_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -58,6 +69,223 @@ get_gpx_list(bool verbose)
     return _gpx_list;
 }
 
+//  --------------------------------------------------------------------------
+//  Return the monitored sensor with this asset name, or else with this ext
+//  name, or NULL. gpx_list_mutex must be held by the caller
+
+_gpx_info_t *
+get_gpx_info(const char *name)
+{
+    if (!_gpx_index || !name)
+        return NULL;
+    return (_gpx_info_t *) zhashx_lookup (_gpx_index, name);
+}
+
+//  --------------------------------------------------------------------------
+//  Add a sensor to the index of the monitored sensors by name. Asset names
+//  take precedence over ext names, and among the sensors sharing an ext
+//  name, the first one added wins. gpx_list_mutex must be held by the caller
+
+static void
+s_name_index_add (_gpx_info_t *gpx_info)
+{
+    if (gpx_info->asset_name)
+        zhashx_update (_gpx_index, gpx_info->asset_name, gpx_info);
+    if (gpx_info->ext_name && !zhashx_lookup (_gpx_index, gpx_info->ext_name))
+        zhashx_insert (_gpx_index, gpx_info->ext_name, gpx_info);
+}
+
+//  Remove a name from the index if it designates this sensor, and give it
+//  to the sensor it now designates, if any
+
+static void
+s_name_index_release (_gpx_info_t *gpx_info, const char *name)
+{
+    if (!name || (zhashx_lookup (_gpx_index, name) != gpx_info))
+        return;
+    zhashx_delete (_gpx_index, name);
+    _gpx_info_t *fallback = NULL;
+    _gpx_info_t *item = (_gpx_info_t *)zlistx_first (_gpx_list);
+    while (item) {
+        if (item != gpx_info) {
+            if (item->asset_name && streq (item->asset_name, name)) {
+                fallback = item;
+                break;
+            }
+            if (!fallback && item->ext_name && streq (item->ext_name, name))
+                fallback = item;
+        }
+        item = (_gpx_info_t *)zlistx_next (_gpx_list);
+    }
+    if (fallback)
+        zhashx_insert (_gpx_index, name, fallback);
+}
+
+//  Remove a sensor from the index of the monitored sensors by name, before
+//  it leaves the list. gpx_list_mutex must be held by the caller
+
+static void
+s_name_index_remove (_gpx_info_t *gpx_info)
+{
+    s_name_index_release (gpx_info, gpx_info->asset_name);
+    s_name_index_release (gpx_info, gpx_info->ext_name);
+}
+
+//  --------------------------------------------------------------------------
+//  Return the secondary index of the monitored sensors for an attribute
+//  (location, type, parent or state), or NULL if not indexed.
+//  gpx_list_mutex must be held by the caller while using it
+
+gpio_index_t *
+get_gpx_attribute_index(const char *attribute)
+{
+    if (!attribute)
+        return NULL;
+    if (streq (attribute, "location"))
+        return _gpx_by_location;
+    if (streq (attribute, "type"))
+        return _gpx_by_type;
+    if (streq (attribute, "parent"))
+        return _gpx_by_parent;
+    if (streq (attribute, "state"))
+        return _gpx_by_state;
+    return NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Move a sensor in the state index, after a change of its recorded state
+//  (change_state). gpx_list_mutex must be held by the caller
+
+void
+update_gpx_state_index(_gpx_info_t *gpx_info, int previous_state)
+{
+    if (!_gpx_by_state)
+        return;
+    gpio_index_move (_gpx_by_state,
+        libgpio_get_status_string (previous_state).c_str (),
+        libgpio_get_status_string (gpx_info->change_state).c_str (),
+        gpx_info);
+}
+
+//  --------------------------------------------------------------------------
+//  zhashx handling -- destroy an abnormal state counter
+
+static void
+s_abnormal_free (void **item)
+{
+    _gpx_abnormal_t *abnormal = (_gpx_abnormal_t *) *item;
+    if (!abnormal)
+        return;
+    zstr_free (&abnormal->type);
+    zstr_free (&abnormal->location);
+    free (abnormal);
+    *item = NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Return true if a GPI sensor in this state is counted as abnormal
+
+static bool
+s_is_abnormal (_gpx_info_t *gpx_info, int state)
+{
+    return (gpx_info->gpx_direction == GPIO_DIRECTION_IN)
+        && gpx_info->type && gpx_info->location
+        && (state != GPIO_STATE_UNKNOWN) && (state != gpx_info->normal_state);
+}
+
+//  --------------------------------------------------------------------------
+//  Add 'delta' to the abnormal state counter of the type and location of a
+//  sensor, and queue it for publication.
+//  gpx_list_mutex must be held by the caller
+
+static void
+s_abnormal_add (_gpx_info_t *gpx_info, int delta)
+{
+    if (!_gpx_abnormal)
+        return;
+    std::string key = std::string (gpx_info->type) + "@" + gpx_info->location;
+    _gpx_abnormal_t *abnormal = (_gpx_abnormal_t *) zhashx_lookup (_gpx_abnormal, key.c_str ());
+    if (!abnormal) {
+        abnormal = (_gpx_abnormal_t *) zmalloc (sizeof (_gpx_abnormal_t));
+        abnormal->type = strdup (gpx_info->type);
+        abnormal->location = strdup (gpx_info->location);
+        zhashx_insert (_gpx_abnormal, key.c_str (), abnormal);
+    }
+    abnormal->count += delta;
+    if (!abnormal->changed) {
+        abnormal->changed = true;
+        zlistx_add_end (_gpx_abnormal_changes, abnormal);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Update the abnormal state counters after a change of the recorded state
+//  (change_state) of a sensor, in O(1).
+//  gpx_list_mutex must be held by the caller
+
+void
+update_gpx_abnormal(_gpx_info_t *gpx_info, int previous_state)
+{
+    bool was_abnormal = s_is_abnormal (gpx_info, previous_state);
+    bool abnormal = s_is_abnormal (gpx_info, gpx_info->change_state);
+    if (abnormal != was_abnormal)
+        s_abnormal_add (gpx_info, abnormal? 1 : -1);
+}
+
+//  --------------------------------------------------------------------------
+//  Return the next abnormal state counter changed since its last
+//  publication, or NULL if none.
+//  gpx_list_mutex must be held by the caller
+
+_gpx_abnormal_t *
+pop_gpx_abnormal_change(void)
+{
+    if (!_gpx_abnormal_changes)
+        return NULL;
+    _gpx_abnormal_t *abnormal = (_gpx_abnormal_t *) zlistx_detach (_gpx_abnormal_changes, NULL);
+    if (abnormal)
+        abnormal->changed = false;
+    return abnormal;
+}
+
+//  --------------------------------------------------------------------------
+//  Return all the abnormal state counters, by "<type>@<location>".
+//  gpx_list_mutex must be held by the caller while using them
+
+zhashx_t *
+get_gpx_abnormal(void)
+{
+    return _gpx_abnormal;
+}
+
+//  --------------------------------------------------------------------------
+//  Add a sensor to, or remove it from, the secondary indexes.
+//  gpx_list_mutex must be held by the caller
+
+static void
+s_index_add (_gpx_info_t *gpx_info)
+{
+    gpio_index_insert (_gpx_by_location, gpx_info->location, gpx_info);
+    gpio_index_insert (_gpx_by_type, gpx_info->type, gpx_info);
+    gpio_index_insert (_gpx_by_parent, gpx_info->parent, gpx_info);
+    gpio_index_insert (_gpx_by_state,
+        libgpio_get_status_string (gpx_info->change_state).c_str (), gpx_info);
+}
+
+static void
+s_index_remove (_gpx_info_t *gpx_info)
+{
+    // A removed sensor no longer counts as abnormal
+    if (s_is_abnormal (gpx_info, gpx_info->change_state))
+        s_abnormal_add (gpx_info, -1);
+
+    gpio_index_remove (_gpx_by_location, gpx_info->location, gpx_info);
+    gpio_index_remove (_gpx_by_type, gpx_info->type, gpx_info);
+    gpio_index_remove (_gpx_by_parent, gpx_info->parent, gpx_info);
+    gpio_index_remove (_gpx_by_state,
+        libgpio_get_status_string (gpx_info->change_state).c_str (), gpx_info);
+}
+
 //  --------------------------------------------------------------------------
 //  zlist handling -- destroy an item
 
@@ -98,6 +326,14 @@ void sensor_free(void **item)
     if (gpx_info->alarm_severity)
         free(gpx_info->alarm_severity);
 
+    gpio_filter_destroy (&gpx_info->filter);
+    gpio_flap_destroy (&gpx_info->flap);
+    gpio_history_destroy (&gpx_info->history);
+    gpio_counter_destroy (&gpx_info->counter);
+    if (gpx_info->counter_edge)
+        free(gpx_info->counter_edge);
+    gpio_expr_destroy (&gpx_info->expr);
+
     free(gpx_info);
 }
 
@@ -153,6 +389,38 @@ _gpx_info_t *sensor_new()
     gpx_info->alarm_message = NULL;
     gpx_info->alarm_severity = NULL;
     gpx_info->alert_triggered = false;
+    gpx_info->alert_abnormal = 0;
+    gpx_info->alert_normal = 0;
+    gpx_info->alert_published = 0;
+    gpx_info->poll_interval = 0;
+    gpx_info->burst_interval = 0;
+    gpx_info->burst_duration = 0;
+    gpx_info->next_poll = 0;
+    gpx_info->burst_until = 0;
+    gpx_info->poll_phase = -1;
+    gpx_info->samples = 0;
+    gpx_info->last_sample = 0;
+    gpx_info->sample_period = 0;
+    gpx_info->filter = NULL;
+    gpx_info->oversample = 1;
+    gpx_info->flap = NULL;
+    gpx_info->flap_rate_limit = DEFAULT_FLAP_RATE_LIMIT;
+    gpx_info->last_publish = 0;
+    gpx_info->change_state = GPIO_STATE_UNKNOWN;
+    gpx_info->last_change = 0;
+    gpx_info->history = NULL;
+    gpx_info->counter_edge = NULL;
+    gpx_info->counter = NULL;
+    gpx_info->state_time [GPIO_STATE_CLOSED] = 0;
+    gpx_info->state_time [GPIO_STATE_OPENED] = 0;
+    gpx_info->state_since = 0;
+    gpx_info->dwell_published [GPIO_STATE_CLOSED] = 0;
+    gpx_info->dwell_published [GPIO_STATE_OPENED] = 0;
+    gpx_info->expr = NULL;
+    gpx_info->sample_mono_ns = 0;
+    gpx_info->sample_time_ns = 0;
+    gpx_info->raw_change_ns = 0;
+    gpx_info->accept_mono_ns = 0;
 
     return gpx_info;
 }
@@ -182,7 +450,7 @@ add_sensor(fty_sensor_gpio_assets_t *self, const char* operation,
                 return 1;
             }
         }
-        else {
+        else if (!streq (sensor_gpx_direction, "virtual")) {
             if (gpx_number > libgpio_get_gpi_count ()) {
                 zsys_info ("ERROR: GPI number is higher than the number of supported GPI");
                 return 1;
@@ -215,6 +483,7 @@ add_sensor(fty_sensor_gpio_assets_t *self, const char* operation,
         // current_state = GPIO_STATE_CLOSED;
     }
     else {
+        // Virtual sensors are GPIs computed from other sensors
         gpx_info->gpx_direction = GPIO_DIRECTION_IN;
     }
     if (sensor_parent)
@@ -239,6 +508,30 @@ add_sensor(fty_sensor_gpio_assets_t *self, const char* operation,
         // In case of update, we remove the previous entry, and create a new one
         if ( streq (operation, "update" ) ) {
             // FIXME: we may lose some data, check for merging entries prior to deleting
+            _gpx_info_t *prev = (_gpx_info_t *) zlistx_handle_item (prev_gpx_info);
+            // Keep the cumulative times in state
+            for (int state = GPIO_STATE_CLOSED; state <= GPIO_STATE_OPENED; state++) {
+                gpx_info->state_time [state] = prev->state_time [state];
+                gpx_info->dwell_published [state] = prev->dwell_published [state];
+            }
+            // Keep the alert raised, as its evaluation state survives too
+            gpx_info->alert_triggered = prev->alert_triggered;
+            gpx_info->alert_abnormal = prev->alert_abnormal;
+            gpx_info->alert_normal = prev->alert_normal;
+            gpx_info->alert_published = prev->alert_published;
+            // Keep the debounce filter, flapping detector, history and pulse
+            // counter: the sensor options only replace those whose settings
+            // change, and resize the history
+            gpx_info->filter = prev->filter;
+            prev->filter = NULL;
+            gpx_info->flap = prev->flap;
+            prev->flap = NULL;
+            gpx_info->history = prev->history;
+            prev->history = NULL;
+            gpx_info->counter = prev->counter;
+            prev->counter = NULL;
+            s_name_index_remove (prev);
+            s_index_remove (prev);
             if (zlistx_delete (_gpx_list, (void *)prev_gpx_info) == -1) {
                 zsys_error ("Update: error deleting the previous GPx record for '%s'!", assetname);
                 pthread_mutex_unlock (&gpx_list_mutex);
@@ -252,6 +545,8 @@ add_sensor(fty_sensor_gpio_assets_t *self, const char* operation,
         }
     }
     zlistx_add_end (_gpx_list, (void *) gpx_info);
+    s_name_index_add (gpx_info);
+    s_index_add (gpx_info);
 
     pthread_mutex_unlock (&gpx_list_mutex);
 
@@ -270,7 +565,9 @@ add_sensor(fty_sensor_gpio_assets_t *self, const char* operation,
 //  --------------------------------------------------------------------------
 //  Sensors handling
 //  Delete an entry from our zlist of monitored sensors
-static int
+
+//static
+int
 delete_sensor(fty_sensor_gpio_assets_t *self, const char* assetname)
 {
     int retval = 0;
@@ -314,12 +611,173 @@ delete_sensor(fty_sensor_gpio_assets_t *self, const char* assetname)
     else {
         my_zsys_debug (self->verbose, "Deleting '%s'", assetname);
         // Delete from zlist
+        s_name_index_remove ((_gpx_info_t *) zlistx_handle_item (gpx_info_result));
+        s_index_remove ((_gpx_info_t *) zlistx_handle_item (gpx_info_result));
         zlistx_delete (_gpx_list, (void *)gpx_info_result);
     }
     pthread_mutex_unlock (&gpx_list_mutex);
     return retval;
 }
 
+//  --------------------------------------------------------------------------
+//  Sensors handling
+//  Find an entry in our zlist of monitored sensors
+//  gpx_list_mutex must be held by the caller
+
+static _gpx_info_t *
+s_find_sensor (const char* assetname)
+{
+    _gpx_info_t *gpx_info = get_gpx_info (assetname);
+    if (gpx_info && gpx_info->asset_name && streq (gpx_info->asset_name, assetname))
+        return gpx_info;
+    return NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Get an integer sensor option from the user config (asset ext attribute),
+//  or fallback to the template value, or to the provided default
+
+static int
+s_get_sensor_option (zconfig_t *config_template, fty_proto_t *ftymessage,
+    const char *template_key, const char *ext_key, int dfl)
+{
+    const char *value = config_template? s_get (config_template, template_key, "") : "";
+    value = fty_proto_ext_string (ftymessage, ext_key, value);
+    if (!value || streq (value, ""))
+        return dfl;
+    return atoi (value);
+}
+
+//  --------------------------------------------------------------------------
+//  Sensors handling
+//  Apply the optional settings, from the template or overriden by the user
+//  config, to an already monitored sensor
+
+static void
+s_apply_sensor_options (fty_sensor_gpio_assets_t *self, const char* assetname,
+    zconfig_t *config_template, fty_proto_t *ftymessage)
+{
+    pthread_mutex_lock (&gpx_list_mutex);
+    _gpx_info_t *gpx_info = s_find_sensor (assetname);
+    if (gpx_info) {
+        // Polling: specific interval, and faster sampling after a change
+        gpx_info->poll_interval = s_get_sensor_option (config_template, ftymessage,
+            "poll-interval", "poll_interval", 0);
+        gpx_info->burst_interval = s_get_sensor_option (config_template, ftymessage,
+            "burst-interval", "burst_interval", 0);
+        gpx_info->burst_duration = s_get_sensor_option (config_template, ftymessage,
+            "burst-duration", "burst_duration", 0);
+        my_zsys_debug (self->verbose, "%s: polling every %d ms, %d ms for %d ms after a change",
+            assetname, gpx_info->poll_interval, gpx_info->burst_interval, gpx_info->burst_duration);
+
+        // Debouncing: N-of-M majority over the samples, minimum stable time,
+        // and number of samples read per check
+        int samples = s_get_sensor_option (config_template, ftymessage,
+            "debounce-samples", "debounce_samples", 1);
+        int threshold = s_get_sensor_option (config_template, ftymessage,
+            "debounce-threshold", "debounce_threshold", 0);
+        int stable_time = s_get_sensor_option (config_template, ftymessage,
+            "debounce-stable-time", "debounce_stable_time", 0);
+        gpx_info->oversample = s_get_sensor_option (config_template, ftymessage,
+            "oversample", "oversample", 1);
+        if (gpx_info->oversample < 1)
+            gpx_info->oversample = 1;
+        if ((gpx_info->gpx_direction == GPIO_DIRECTION_IN) && ((samples > 1) || (stable_time > 0))) {
+            // Keep the samples voted so far, unless the settings change
+            gpio_filter_t *filter = gpio_filter_new (samples, threshold, stable_time);
+            if (gpx_info->filter && gpio_filter_same_settings (gpx_info->filter, filter))
+                gpio_filter_destroy (&filter);
+            else {
+                gpio_filter_destroy (&gpx_info->filter);
+                gpx_info->filter = filter;
+            }
+            my_zsys_debug (self->verbose, "%s: debouncing over %d sample(s), stable for %d ms, %d sample(s) per check",
+                assetname, samples, stable_time, gpx_info->oversample);
+        }
+        else
+            gpio_filter_destroy (&gpx_info->filter);
+
+        // Flapping detection: transitions over a sliding window, and rate
+        // limit of the publications while flapping
+        int flap_window = s_get_sensor_option (config_template, ftymessage,
+            "flap-window", "flap_window", DEFAULT_FLAP_WINDOW);
+        int flap_threshold = s_get_sensor_option (config_template, ftymessage,
+            "flap-threshold", "flap_threshold", DEFAULT_FLAP_THRESHOLD);
+        int flap_restore = s_get_sensor_option (config_template, ftymessage,
+            "flap-restore", "flap_restore", -1);
+        gpx_info->flap_rate_limit = s_get_sensor_option (config_template, ftymessage,
+            "flap-rate-limit", "flap_rate_limit", DEFAULT_FLAP_RATE_LIMIT);
+        if ((gpx_info->gpx_direction == GPIO_DIRECTION_IN) && (flap_window > 0) && (flap_threshold > 0)) {
+            // Keep the transitions seen so far, unless the settings change
+            gpio_flap_t *flap = gpio_flap_new (flap_window, flap_threshold, flap_restore);
+            if (gpx_info->flap && gpio_flap_same_settings (gpx_info->flap, flap))
+                gpio_flap_destroy (&flap);
+            else {
+                gpio_flap_destroy (&gpx_info->flap);
+                gpx_info->flap = flap;
+            }
+        }
+        else
+            gpio_flap_destroy (&gpx_info->flap);
+
+        // History of the recent states, as runs of identical samples
+        int history_size = s_get_sensor_option (config_template, ftymessage,
+            "history-size", "history_size", DEFAULT_HISTORY_SIZE);
+        if (history_size <= 0)
+            gpio_history_destroy (&gpx_info->history);
+        else
+        if (!gpx_info->history)
+            gpx_info->history = gpio_history_new (history_size);
+        else
+            // Keep the states recorded so far, resized if needed
+            gpio_history_resize (gpx_info->history, history_size);
+
+        // Counter mode: the pulses on a GPI are counted from its edges,
+        // instead of sampling its level
+        const char *counter_edge = config_template? s_get (config_template, "counter-edge", "") : "";
+        counter_edge = fty_proto_ext_string (ftymessage, "counter_edge", counter_edge);
+        int counter_window = s_get_sensor_option (config_template, ftymessage,
+            "counter-window", "counter_window", DEFAULT_COUNTER_WINDOW);
+        if (gpx_info->counter_edge) {
+            free (gpx_info->counter_edge);
+            gpx_info->counter_edge = NULL;
+        }
+        if ((gpx_info->gpx_direction == GPIO_DIRECTION_IN) && counter_edge && !streq (counter_edge, "")) {
+            gpx_info->counter_edge = strdup (counter_edge);
+            // Keep the pulses counted so far, unless the window changes
+            if (gpx_info->counter && (gpio_counter_window (gpx_info->counter) != counter_window))
+                gpio_counter_destroy (&gpx_info->counter);
+            if (!gpx_info->counter)
+                gpx_info->counter = gpio_counter_new (counter_window);
+            my_zsys_debug (self->verbose, "%s: counting %s edges, rate over %d ms",
+                assetname, gpx_info->counter_edge, gpio_counter_window (gpx_info->counter));
+        }
+        else
+            gpio_counter_destroy (&gpx_info->counter);
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+}
+
+//  --------------------------------------------------------------------------
+//  Sensors handling
+//  Attach its compiled expression to an already monitored virtual sensor
+
+static void
+s_set_sensor_expression (fty_sensor_gpio_assets_t *self, const char* assetname, gpio_expr_t **expr_p)
+{
+    pthread_mutex_lock (&gpx_list_mutex);
+    _gpx_info_t *gpx_info = s_find_sensor (assetname);
+    if (gpx_info) {
+        gpio_expr_destroy (&gpx_info->expr);
+        gpx_info->expr = *expr_p;
+        *expr_p = NULL;
+        my_zsys_debug (self->verbose, "%s: virtual sensor over %d sensor(s)",
+            assetname, gpio_expr_inputs (gpx_info->expr));
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+    gpio_expr_destroy (expr_p);
+}
+
 //  --------------------------------------------------------------------------
 //  Check if this asset is a GPIO sensor by
 //  * Checking the provided subtype
@@ -458,12 +916,32 @@ fty_sensor_gpio_handle_asset (fty_sensor_gpio_assets_t *self, fty_proto_t *ftyme
                 zconfig_destroy (&config_template);
                 return;
             }
+            // Virtual sensors are computed from the states of other sensors,
+            // with an expression compiled once here
+            gpio_expr_t *expr = NULL;
+            if (streq (sensor_gpx_direction, "virtual")) {
+                const char *expression = s_get (config_template, "expression", "");
+                expression = fty_proto_ext_string (ftymessage, "expression", expression);
+                expr = gpio_expr_new (expression);
+                if (!expr) {
+                    zsys_error ("Invalid expression '%s' for virtual sensor '%s'! Skipping sensor",
+                        expression, assetname);
+                    zconfig_destroy (&config_template);
+                    return;
+                }
+            }
 
-            add_sensor( self, operation,
+            int rv = add_sensor( self, operation,
                         manufacturer, assetname, extname, asset_model,
                         sensor_type, sensor_normal_state,
                         sensor_gpx_number, sensor_gpx_direction, asset_parent_name1,
                         sensor_location, power_source, sensor_alarm_message, sensor_alarm_severity);
+            if (rv == 0) {
+                s_apply_sensor_options (self, assetname, config_template, ftymessage);
+                if (expr)
+                    s_set_sensor_expression (self, assetname, &expr);
+            }
+            gpio_expr_destroy (&expr);
 
             zconfig_destroy (&config_template);
         }
@@ -497,11 +975,13 @@ fty_sensor_gpio_handle_asset (fty_sensor_gpio_assets_t *self, fty_proto_t *ftyme
             zmsg_addstr (request, sensor_normal_state);
             mlm_client_sendto (self->mlm, FTY_SENSOR_GPIO_AGENT, "GPOSTATE", NULL, 1000, &request);
 
-            add_sensor( self, operation,
+            int rv = add_sensor( self, operation,
                         "", assetname, extname, "",
                         "", sensor_normal_state,
                         sensor_gpx_number, sensor_gpx_direction, asset_parent_name1,
                         "", "", "", "");
+            if (rv == 0)
+                s_apply_sensor_options (self, assetname, NULL, ftymessage);
 
         }
     }
@@ -647,6 +1127,16 @@ fty_sensor_gpio_assets_new (const char* name)
     zlistx_set_duplicator (_gpx_list, (czmq_duplicator *) sensor_dup);
     zlistx_set_destructor (_gpx_list, (czmq_destructor *) sensor_free);
     zlistx_set_comparator (_gpx_list, (czmq_comparator *) sensor_cmp);
+    // Items are owned by the list
+    _gpx_index = zhashx_new ();
+    assert (_gpx_index);
+    _gpx_by_location = gpio_index_new ();
+    _gpx_by_type = gpio_index_new ();
+    _gpx_by_parent = gpio_index_new ();
+    _gpx_by_state = gpio_index_new ();
+    _gpx_abnormal = zhashx_new ();
+    zhashx_set_destructor (_gpx_abnormal, s_abnormal_free);
+    _gpx_abnormal_changes = zlistx_new ();
 
     return self;
 }
@@ -662,6 +1152,13 @@ fty_sensor_gpio_assets_destroy (fty_sensor_gpio_assets_t **self_p)
     if (*self_p) {
         fty_sensor_gpio_assets_t *self = *self_p;
         //  Free class properties
+        zhashx_destroy (&_gpx_index);
+        gpio_index_destroy (&_gpx_by_location);
+        gpio_index_destroy (&_gpx_by_type);
+        gpio_index_destroy (&_gpx_by_parent);
+        gpio_index_destroy (&_gpx_by_state);
+        zlistx_destroy (&_gpx_abnormal_changes);
+        zhashx_destroy (&_gpx_abnormal);
         zlistx_purge (_gpx_list);
         zlistx_destroy (&_gpx_list);
         pthread_mutex_unlock (&gpx_list_mutex);
@@ -734,6 +1231,8 @@ fty_sensor_gpio_assets (zsock_t *pipe, void *args)
                     my_zsys_debug (self->verbose, "fty-gpio-sensor-assets: setting PRODUCER on %s", stream);
                     zstr_free (&stream);
                     request_sensor_assets(self);
+                    // Let the caller know the inventory is loaded
+                    zstr_send (pipe, "ASSETS_READY");
                 }
                 else if (streq (cmd, "CONSUMER")) {
                     char *stream = zmsg_popstr (message);
@@ -964,6 +1463,16 @@ fty_sensor_gpio_assets_test (bool verbose)
         assert (gpx_info->gpx_direction == GPIO_DIRECTION_IN);
         assert (streq (gpx_info->alarm_severity, "WARNING"));
         assert (streq (gpx_info->alarm_message, "Door has been $status"));
+        // No specific polling settings
+        assert (gpx_info->poll_interval == 0);
+        assert (gpx_info->burst_interval == 0);
+        // Debounced, from the template file
+        assert (gpx_info->filter);
+        assert (gpx_info->oversample == 3);
+        // Flapping detection and history, by default
+        assert (gpx_info->flap);
+        assert (gpx_info->flap_rate_limit == DEFAULT_FLAP_RATE_LIMIT);
+        assert (gpx_info->history);
 
         // Test the 2nd sensor
         gpx_info = (_gpx_info_t *)zlistx_next (test_gpx_list);
@@ -979,6 +1488,15 @@ fty_sensor_gpio_assets_test (bool verbose)
         assert (streq (gpx_info->type, "water-leak-detector"));
         assert (gpx_info->normal_state == GPIO_STATE_OPENED);
         assert (gpx_info->gpx_direction == GPIO_DIRECTION_IN);
+        // Polling settings, from the template file
+        assert (gpx_info->poll_interval == 1000);
+        assert (gpx_info->burst_interval == 250);
+        assert (gpx_info->burst_duration == 10000);
+        // Not debounced
+        assert (gpx_info->filter == NULL);
+        assert (gpx_info->oversample == 1);
+        // No flapping detection, from the template file
+        assert (gpx_info->flap == NULL);
 
         // Test the GPO
         gpx_info = (_gpx_info_t *)zlistx_next (test_gpx_list);
@@ -1168,11 +1686,109 @@ fty_sensor_gpio_assets_test (bool verbose)
 
         pthread_mutex_unlock (&gpx_list_mutex);
     }
+    zactor_destroy (&assets);
+
+    // Test #6: the names index is kept up to date upon each addition and
+    // deletion, asset names taking precedence over ext names, and the first
+    // sensor added winning among those sharing an ext name
+    {
+        my_zsys_debug (verbose, "fty-sensor-gpio-assets-test: Test #6");
+        // The GPx numbers are checked against the count of GPIs of the
+        // process, which a libgpio sets
+        libgpio_t *gpio_lib = libgpio_new ();
+        libgpio_set_gpi_count (gpio_lib, 10);
+        libgpio_destroy (&gpio_lib);
+        fty_sensor_gpio_assets_t *assets_self = fty_sensor_gpio_assets_new ("gpio-assets-index");
+        assert (assets_self);
+        const char *sensors[][3] = {
+            { "sensorgpio-30", "sensorgpio-31", "1" },
+            { "sensorgpio-31", "GPIO-Sensor-Door31", "2" },
+            { "sensorgpio-32", "GPIO-Sensor-Door31", "3" } };
+        for (int i = 0; i < 3; i++) {
+            int rv = add_sensor (assets_self, "create",
+                "Eaton", sensors [i][0], sensors [i][1],
+                "DCS001", "door-contact-sensor",
+                "closed", sensors [i][2],
+                "GPI", "IPC1", "Rack1", "",
+                "Door has been $status", "WARNING");
+            assert (rv == 0);
+        }
+        pthread_mutex_lock (&gpx_list_mutex);
+        assert (streq (get_gpx_info ("sensorgpio-30")->asset_name, "sensorgpio-30"));
+        assert (streq (get_gpx_info ("sensorgpio-31")->asset_name, "sensorgpio-31"));
+        assert (streq (get_gpx_info ("GPIO-Sensor-Door31")->asset_name, "sensorgpio-31"));
+        pthread_mutex_unlock (&gpx_list_mutex);
+
+        // The names of a deleted sensor go to the sensors they now designate
+        assert (delete_sensor (assets_self, "sensorgpio-31") == 0);
+        pthread_mutex_lock (&gpx_list_mutex);
+        assert (streq (get_gpx_info ("sensorgpio-31")->asset_name, "sensorgpio-30"));
+        assert (streq (get_gpx_info ("GPIO-Sensor-Door31")->asset_name, "sensorgpio-32"));
+        pthread_mutex_unlock (&gpx_list_mutex);
+
+        assert (delete_sensor (assets_self, "sensorgpio-30") == 0);
+        pthread_mutex_lock (&gpx_list_mutex);
+        assert (get_gpx_info ("sensorgpio-30") == NULL);
+        assert (get_gpx_info ("sensorgpio-31") == NULL);
+        assert (streq (get_gpx_info ("sensorgpio-32")->asset_name, "sensorgpio-32"));
+        pthread_mutex_unlock (&gpx_list_mutex);
+        fty_sensor_gpio_assets_destroy (&assets_self);
+    }
+
+    // Test #7: an asset update keeps the state of the sensor gathered so far
+    {
+        my_zsys_debug (verbose, "fty-sensor-gpio-assets-test: Test #7");
+        fty_sensor_gpio_assets_t *assets_self = fty_sensor_gpio_assets_new ("gpio-assets-update");
+        assert (assets_self);
+        zhash_t *aux = zhash_new ();
+        zhash_t *ext = zhash_new ();
+        zhash_autofree (aux);
+        zhash_autofree (ext);
+        zhash_update (ext, "history_size", (void *) "4");
+        zhash_update (ext, "counter_edge", (void *) "rising");
+        zhash_update (ext, "debounce_samples", (void *) "3");
+        zmsg_t *msg = fty_proto_encode_asset (aux, "sensorgpio-40", FTY_PROTO_ASSET_OP_UPDATE, ext);
+        fty_proto_t *options = fty_proto_decode (&msg);
+        assert (options);
+        zhash_destroy (&aux);
+        zhash_destroy (&ext);
+        const char *operations[] = { "create", "update" };
+        for (int i = 0; i < 2; i++) {
+            int rv = add_sensor (assets_self, operations [i],
+                "Eaton", "sensorgpio-40", "GPIO-Sensor-Door40",
+                "DCS001", "door-contact-sensor",
+                "closed", "4",
+                "GPI", "IPC1", "Rack1", "",
+                "Door has been $status", "WARNING");
+            assert (rv == 0);
+            s_apply_sensor_options (assets_self, "sensorgpio-40", NULL, options);
+            pthread_mutex_lock (&gpx_list_mutex);
+            _gpx_info_t *gpx_info = get_gpx_info ("sensorgpio-40");
+            assert (gpx_info && gpx_info->history);
+            assert (gpx_info->counter && gpx_info->filter && gpx_info->flap);
+            if (i == 0) {
+                gpio_history_add (gpx_info->history, 1000, GPIO_STATE_CLOSED);
+                gpio_history_add (gpx_info->history, 2000, GPIO_STATE_OPENED);
+                gpio_counter_add (gpx_info->counter, 5, zclock_mono ());
+                gpio_filter_sample (gpx_info->filter, GPIO_STATE_CLOSED, zclock_mono ());
+                gpio_flap_transition (gpx_info->flap, zclock_mono ());
+            }
+            // The history, pulses counted, debounce and flapping states
+            // survive the update
+            assert (gpio_history_size (gpx_info->history) == 4);
+            assert (gpio_history_count (gpx_info->history) == 2);
+            assert (gpio_counter_total (gpx_info->counter) == 5);
+            assert (gpio_filter_state (gpx_info->filter) == GPIO_STATE_CLOSED);
+            assert (gpio_flap_transitions (gpx_info->flap) == 1);
+            pthread_mutex_unlock (&gpx_list_mutex);
+        }
+        fty_proto_destroy (&options);
+        fty_sensor_gpio_assets_destroy (&assets_self);
+    }
 
     //  @end
     zstr_free (&test_data_dir);
     mlm_client_destroy (&asset_generator);
-    zactor_destroy (&assets);
     zactor_destroy (&server);
     printf ("OK\n");
 }
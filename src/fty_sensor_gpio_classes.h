@@ -35,9 +35,50 @@
 //  Extra headers
 
 //  Opaque class structures to allow forward references
+#ifndef GPIO_FILTER_T_DEFINED
+typedef struct _gpio_filter_t gpio_filter_t;
+#define GPIO_FILTER_T_DEFINED
+#endif
+#ifndef GPIO_FLAP_T_DEFINED
+typedef struct _gpio_flap_t gpio_flap_t;
+#define GPIO_FLAP_T_DEFINED
+#endif
+#ifndef GPIO_INDEX_T_DEFINED
+typedef struct _gpio_index_t gpio_index_t;
+#define GPIO_INDEX_T_DEFINED
+#endif
+#ifndef GPIO_HISTORY_T_DEFINED
+typedef struct _gpio_history_t gpio_history_t;
+#define GPIO_HISTORY_T_DEFINED
+#endif
+#ifndef GPIO_COUNTER_T_DEFINED
+typedef struct _gpio_counter_t gpio_counter_t;
+#define GPIO_COUNTER_T_DEFINED
+#endif
+#ifndef GPIO_EXPR_T_DEFINED
+typedef struct _gpio_expr_t gpio_expr_t;
+#define GPIO_EXPR_T_DEFINED
+#endif
+#ifndef GPIO_LATENCY_T_DEFINED
+typedef struct _gpio_latency_t gpio_latency_t;
+#define GPIO_LATENCY_T_DEFINED
+#endif
+#ifndef GPIO_PROM_T_DEFINED
+typedef struct _gpio_prom_t gpio_prom_t;
+#define GPIO_PROM_T_DEFINED
+#endif
 
 //  Internal API
 
+#include "gpio_filter.h"
+#include "gpio_flap.h"
+#include "gpio_index.h"
+#include "gpio_history.h"
+#include "gpio_counter.h"
+#include "gpio_expr.h"
+#include "gpio_latency.h"
+#include "gpio_prom.h"
+
 
 //  *** To avoid double-definitions, only define if building without draft ***
 #ifndef FTY_SENSOR_GPIO_BUILD_DRAFT_API
@@ -37,6 +37,17 @@
 void
 fty_sensor_gpio_private_selftest (bool verbose)
 {
+// Tests for draft private classes:
+#ifdef FTY_SENSOR_GPIO_BUILD_DRAFT_API
+    gpio_filter_test (verbose);
+    gpio_flap_test (verbose);
+    gpio_index_test (verbose);
+    gpio_history_test (verbose);
+    gpio_counter_test (verbose);
+    gpio_expr_test (verbose);
+    gpio_latency_test (verbose);
+    gpio_prom_test (verbose);
+#endif // FTY_SENSOR_GPIO_BUILD_DRAFT_API
 }
 /*
 ################################################################################
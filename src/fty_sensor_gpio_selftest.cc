@@ -41,6 +41,8 @@ all_tests [] = {
     { "libgpio", libgpio_test },
     { "fty_sensor_gpio_assets", fty_sensor_gpio_assets_test },
     { "fty_sensor_gpio_server", fty_sensor_gpio_server_test },
+    { "fty_sensor_gpio_alerts", fty_sensor_gpio_alerts_test },
+    { "fty_sensor_gpio_shm", fty_sensor_gpio_shm_test },
 #endif // FTY_SENSOR_GPIO_BUILD_DRAFT_API
 #ifdef FTY_SENSOR_GPIO_BUILD_DRAFT_API
     { "private_classes", fty_sensor_gpio_private_selftest },
@@ -102,7 +104,7 @@ main (int argc, char **argv)
         else
         if (streq (argv [argn], "--number")
         ||  streq (argv [argn], "-n")) {
-            puts ("3");
+            puts ("5");
             return 0;
         }
         else
@@ -112,6 +114,8 @@ main (int argc, char **argv)
             puts ("    libgpio\t\t- draft");
             puts ("    fty_sensor_gpio_assets\t\t- draft");
             puts ("    fty_sensor_gpio_server\t\t- draft");
+            puts ("    fty_sensor_gpio_alerts\t\t- draft");
+            puts ("    fty_sensor_gpio_shm\t\t- draft");
             puts ("    private_classes\t- draft");
             return 0;
         }
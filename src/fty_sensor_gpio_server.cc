@@ -35,6 +35,20 @@
         <zuuid>/sensor/action              - apply action (open | close) on sensor (asset or ext name)
                                       beside from open and close, enable | enabled |opened | high
                                       and disable | disabled | closed | low are also supported
+        <zuuid>/sensor/action/duration     - apply action for 'duration' msec, then restore the
+                                      previous state (timed revert)
+        <zuuid>/sensor/pulse/duration      - toggle the sensor for 'duration' msec
+        <zuuid>/sensor/blink/period[/count]
+                                    - toggle the sensor every half 'period' msec, 'count'
+                                      times (default: 0, until cancelled)
+        <zuuid>/sensor/cancel              - stop the timed action in progress, and restore
+                                      the previous state
+
+        A timed action identical to the one in progress re-arms a pulse or a timed
+        revert, and leaves a blink untouched, while another timed action replaces it.
+        A plain action stops the timed action in progress. Timed actions are saved
+        in the state file, so that they are resumed, or reverted when they have
+        expired, upon restart.
 
     REP:
         subject: "GPO_INTERACTION"
@@ -47,6 +61,28 @@
             <zuuid> = info for REST API so it could match response to request
             <reason>          = ASSET_NOT_FOUND / SET_VALUE_FAILED / UNKNOWN_VALUE / BAD_COMMAND / ACTION_NOT_APPLICABLE
 
+     ------------------------------------------------------------------------
+    ## GPO_INTERACTION_BATCH
+
+    REQ:
+        subject: "GPO_INTERACTION_BATCH"
+        Message is a multipart string message
+
+        <zuuid>/<sensor 1>/<action 1>/.../<sensor N>/<action N>
+                                    - apply actions on several sensors at once,
+                                      with the same values as GPO_INTERACTION
+
+    REP:
+        subject: "GPO_INTERACTION_BATCH"
+        Message is a multipart message:
+
+        * <zuuid>/OK|ERROR/<sensor 1>/<result 1>/.../<sensor N>/<result N>
+
+        where:
+            <zuuid> = info for REST API so it could match response to request
+            OK|ERROR = OK if all the actions have been applied successfully
+            <result x> = OK or <reason> as for GPO_INTERACTION
+
      ------------------------------------------------------------------------
     ## GPIO_MANIFEST
 
@@ -129,12 +165,162 @@
 
     REP:
         none
+
+     ------------------------------------------------------------------------
+    ## GPIO_STATUS
+
+    REQ:
+        subject: "GPIO_STATUS"
+        Message is a multipart string message
+
+        <zuuid>                             - get the status of all the sensors
+        <zuuid>/<sensor 1>/.../<sensor N>   - get the status of these sensors (asset or ext name)
+
+        The status is served from the agent cache, without any hardware access.
+
+    REP:
+        subject: "GPIO_STATUS"
+        Message is a multipart message:
+
+        * <zuuid>/OK/<sensor 1>/<state 1>/<last change 1>/<age 1>/.../<sensor N>/<state N>/<last change N>/<age N>
+        * <zuuid>/ERROR/<reason>
+
+        where:
+            <zuuid> = info for REST API so it could match response to request
+            <sensor x>      = sensor asset name
+            <state x>       = opened / closed / unknown
+            <last change x> = time of the last state change, msec since the epoch (0: unknown)
+            <age x>         = time since the last sample, msec (-1: not sampled yet)
+            <reason>        = ASSET_NOT_FOUND
+
+     ------------------------------------------------------------------------
+    ## GPIO_HISTORY
+
+    REQ:
+        subject: "GPIO_HISTORY"
+        Message is a multipart string message
+
+        <zuuid>/<sensor>[/<from>[/<to>]]   - get the recent states of a sensor (asset or
+                                      ext name), between 'from' and 'to' (msec since
+                                      the epoch, default: the whole history)
+
+    REP:
+        subject: "GPIO_HISTORY"
+        Message is a multipart message:
+
+        * <zuuid>/OK/<sensor>/<state 1>/<first 1>/<last 1>/<samples 1>/.../<state N>/<first N>/<last N>/<samples N>
+        * <zuuid>/ERROR/<reason>
+
+        where:
+            <zuuid> = info for REST API so it could match response to request
+            <sensor>        = sensor asset name
+            <state x>       = state of a run of identical samples, oldest first
+            <first x>       = time of the first sample of the run, msec since the epoch
+            <last x>        = time of the last sample of the run, msec since the epoch
+            <samples x>     = number of samples of the run
+            <reason>        = ASSET_NOT_FOUND
+
+     ------------------------------------------------------------------------
+    ## GPIO_QUERY
+
+    REQ:
+        subject: "GPIO_QUERY"
+        Message is a multipart string message
+
+        <zuuid>/<attribute 1>/<value 1>/.../<attribute N>/<value N>
+                                    - get the sensors matching all these criteria,
+                                      or all the sensors if there is none
+
+        where:
+            <attribute x>   = location / type / parent / state
+            <value x>       = value of the attribute, i.e. the logical asset, the
+                              sensor type, the parent asset, or a state name as
+                              for GPO_INTERACTION
+
+    REP:
+        subject: "GPIO_QUERY"
+        Message is a multipart message:
+
+        * <zuuid>/OK/<sensor 1>/.../<sensor N>
+        * <zuuid>/ERROR/<reason>
+
+        where:
+            <zuuid> = info for REST API so it could match response to request
+            <sensor x>      = sensor asset name
+            <reason>        = BAD_COMMAND
+
+     ------------------------------------------------------------------------
+    ## GPIO_STATS
+
+    REQ:
+        subject: "GPIO_STATS"
+        Message is a multipart string message: <zuuid>
+
+              - get the agent statistics
+
+    REP:
+        subject: "GPIO_STATS"
+        Message is a multipart message:
+
+        * <zuuid>/OK/<key 1>/<value 1>/.../<key N>/<value N>
+
+        where:
+            <zuuid> = info for REST API so it could match response to request
+            <key x>  = poll.cycles / poll.overruns / poll.dropped / poll.deferred
+                       poll.duration_p50_us / p99_us / max_us = duration of
+                       the check cycles, usec
+                       flap.suppressed = number of publications suppressed
+                       rules.actions = number of GPO actions applied by rules
+                       rules.latency_us = last rule action latency, usec
+                       timed.steps = number of timed GPO action steps applied
+                       abnormal.published = number of abnormal counts published
+                       counter.pulses = number of pulses counted on all the GPIs
+                       dwell.published = number of times in state published
+                       virtual.propagations = number of virtual sensors checked
+                       upon a change of their inputs
+                       metrics.published / failed = number of metrics sent,
+                       and which failed to be sent
+                       prometheus.written / failed = number of Prometheus text
+                       files written, and which failed to be written
+                       gpio.reads / writes / syscalls / failures / retries =
+                       accesses to the GPIO sysfs interface
+                       gpio.replay_remaining = number of events of the GPIO
+                       trace replayed still to come
+                       latency.<stage>.count / p50_us / p99_us / max_us = number
+                       of state changes published, and percentiles of their
+                       latency per stage, usec (stages: filter = from the first
+                       sample in the new state to its acceptance, enqueue = to
+                       the publication request, send = to its completion,
+                       total = from the sample to the completion)
+                       mailbox.<class>.depth / depth_max = current / highest queue depth
+                       mailbox.<class>.served = number of requests served
+                       mailbox.<class>.latency_p50_us / latency_p99_us /
+                       latency_max_us = queueing latency, usec
+                       (classes: control, query, bulk, served in this order)
+                       sampling.<asset name>.count = number of samples read
+                       sampling.<asset name>.rate = achieved sampling rate, Hz
+                       filter.<asset name>.glitches = number of rejected glitches
+                       flap.<asset name>.episodes = number of flapping episodes
+                       counter.<asset name>.pulses / rate = pulses counted, and
+                       their rate over the counter window, Hz
+                       virtual.<asset name>.updates = number of expression nodes
+                       recomputed for this virtual sensor
 @end
 */
 
 #include "fty_sensor_gpio_classes.h"
 #include <regex>
+#include <vector>
+#include <algorithm>
 #include <stdio.h>
+#include <poll.h>
+
+// Kinds of timed GPO actions
+
+#define GPO_TIMED_NONE   0  // No timed action
+#define GPO_TIMED_PULSE  1  // Toggle the GPO, and restore it after a duration
+#define GPO_TIMED_BLINK  2  // Toggle the GPO periodically, a number of times
+#define GPO_TIMED_REVERT 3  // Set the GPO, and restore it after a duration
 
 // Structure for GPO state
 
@@ -143,8 +329,111 @@ struct gpo_state_t {
     int default_state;
     int last_action;
     int in_alert;
+    // Timed action in progress, if any
+    int     timed_kind;    // GPO_TIMED_*
+    int     restore_state; // State to restore at the end of the action
+    int     period;        // Pulse / revert duration, or blink half period, msec
+    int     remaining;     // Blink toggles left before the restore (-1: until cancelled)
+    int64_t deadline;      // Monotonic deadline of the next step, msec
+};
+
+// Structure for local GPI -> GPO automation rules
+
+struct gpio_rule_t {
+    char    *name;        // rule name
+    char    *gpi;         // GPI asset or ext name
+    int     gpi_state;    // GPI state matching the condition
+    int     delay;        // Time the condition must hold before acting, msec
+    char    *gpo;         // GPO asset or ext name
+    int     gpo_state;    // GPO state to apply when the condition is matched
+    bool    revert;       // Apply the opposite GPO state when the condition clears
+    bool    matched;      // Condition is matched, and the action has been applied
+    int64_t pending;      // Monotonic deadline of a delayed action, msec (0: none)
+};
+
+static void
+gpio_rule_free (void **item)
+{
+    if (!item || !*item)
+        return;
+    gpio_rule_t *rule = (gpio_rule_t *) *item;
+    zstr_free (&rule->name);
+    zstr_free (&rule->gpi);
+    zstr_free (&rule->gpo);
+    free (rule);
+    *item = NULL;
+}
+
+// Structure for GPIs watched for counting their pulses
+
+struct gpi_watch_t {
+    int     gpx_number;   // GPI number
+    char    *edge;        // Edge(s) counted
+    bool    watching;     // Is the edge watcher waiting for its edges?
+    int64_t retry;        // Monotonic deadline of the next attempt to watch it, msec
+};
+
+static void
+gpi_watch_free (void **item)
+{
+    if (!item || !*item)
+        return;
+    gpi_watch_t *watch = (gpi_watch_t *) *item;
+    zstr_free (&watch->edge);
+    free (watch);
+    *item = NULL;
+}
+
+// Interval between two reports of the pulses counted by the edge watcher, msec
+#define EDGE_WATCHER_REPORT_INTERVAL 100
+// Delay before another attempt to watch a GPI which could not be, msec
+#define EDGE_WATCHER_RETRY_DELAY 60000
+
+// Classes of mailbox requests, served by decreasing priority
+
+#define MAILBOX_CLASS_CONTROL 0  // GPO actions and states
+#define MAILBOX_CLASS_QUERY   1  // Statistics, and any other request
+#define MAILBOX_CLASS_BULK    2  // Manifests and templates
+#define MAILBOX_CLASSES       3
+
+static const char *mailbox_class_names[MAILBOX_CLASSES] = { "control", "query", "bulk" };
+
+// Stages of the latency of a state change, from its sample to its publication
+
+#define LATENCY_FILTER  0  // From the first sample in the new state to its acceptance
+#define LATENCY_ENQUEUE 1  // From the acceptance to the publication request
+#define LATENCY_SEND    2  // From the publication request to its completion
+#define LATENCY_TOTAL   3  // From the first sample in the new state to the completion
+#define LATENCY_STAGES  4
+
+static const char *latency_stage_names[LATENCY_STAGES] = { "filter", "enqueue", "send", "total" };
+
+// Names of the statistics of the accesses to the GPIOs (GPIO_STAT_*)
+
+static const char *gpio_stat_names[GPIO_STATS] = { "reads", "writes", "syscalls", "failures", "retries" };
+
+// Structure for mailbox requests waiting to be served
+
+struct mailbox_request_t {
+    char    *subject;
+    char    *sender;
+    zmsg_t  *message;
+    int64_t received;     // Monotonic reception time, usec
 };
 
+static void
+mailbox_request_free (void **item)
+{
+    if (!item || !*item)
+        return;
+    mailbox_request_t *request = (mailbox_request_t *) *item;
+    zstr_free (&request->subject);
+    zstr_free (&request->sender);
+    zmsg_destroy (&request->message);
+    free (request);
+    *item = NULL;
+}
+
 //  Structure of our class
 
 struct _fty_sensor_gpio_server_t {
@@ -155,8 +444,57 @@ struct _fty_sensor_gpio_server_t {
     bool               test_mode;     // true if we are in test mode, false otherwise
     char               *template_dir; // Location of the template files
     zhashx_t           *gpo_states;
+    int                poll_interval; // Default interval between GPIO status checks, msec (0: disabled)
+    int64_t            next_poll;     // Monotonic deadline of the next check cycle, msec
+    uint64_t           poll_cycles;   // Number of check cycles run
+    uint64_t           poll_overruns; // Number of cycles which overran their interval
+    uint64_t           poll_dropped;  // Number of ticks dropped because of overruns
+    uint64_t           poll_deferred; // Number of checks deferred to the next tick
+    int                tick_budget;   // Maximum time spent checking sensors per tick, msec (0: unbounded)
+    int                mailbox_budget; // Maximum number of mailbox requests served per pass (0: unbounded)
+    uint64_t           phase_count;   // Number of sensors which got a scheduling phase
+    uint64_t           flap_suppressed; // Number of publications suppressed by flapping sensors
+    zlistx_t           *rules;        // Local GPI -> GPO automation rules (gpio_rule_t)
+    int64_t            abnormal_refresh; // Monotonic deadline of the next abnormal counts refresh, msec
+    uint64_t           abnormal_published; // Number of abnormal counts published
+    int64_t            timed_next;    // Monotonic deadline of the next timed GPO action step, msec (0: none)
+    uint64_t           timed_steps;   // Number of timed GPO action steps applied
+    zlistx_t           *mailbox_queues [MAILBOX_CLASSES];      // Pending requests per class (mailbox_request_t)
+    size_t             mailbox_depth_max [MAILBOX_CLASSES];    // Highest queue depth per class
+    uint64_t           mailbox_served [MAILBOX_CLASSES];       // Number of requests served per class
+    uint64_t           rule_actions;  // Number of GPO actions applied by rules
+    int64_t            rule_latency;  // Latency of the last rule action, from the GPI read, usec
+    zactor_t           *edge_watcher; // Waits for the edges of the GPIs in counter mode
+    zhashx_t           *watches;      // GPIs watched by the edge watcher, per asset name (gpi_watch_t)
+    zlistx_t           *releasing;    // GPIs unwatched, until the edge watcher closed their descriptor (gpi_watch_t)
+    uint64_t           pulses;        // Number of pulses counted
+    int                dwell_interval; // Interval between publications of the times in state, msec (0: disabled)
+    int64_t            dwell_next;    // Monotonic deadline of the next publication of the times in state, msec
+    uint64_t           dwell_published; // Number of times in state published
+    zhashx_t           *dwell_restore; // Times in state loaded from the state file, per asset name, until applied
+    char               *state_file;   // Path of the state file (NULL: none)
+    uint64_t           propagations;  // Number of virtual sensors re-checked upon a change of their inputs
+    gpio_latency_t     *latency [LATENCY_STAGES]; // Latencies of the state changes per stage, usec
+    gpio_latency_t     *poll_duration; // Durations of the check cycles, usec
+    gpio_latency_t     *mailbox_latency [MAILBOX_CLASSES]; // Queueing latencies per class, usec
+    uint64_t           published;     // Number of metrics published
+    uint64_t           publish_failures; // Number of metrics which failed to be published
+    int                stats_interval; // Interval between publications of the agent statistics, msec (0: disabled)
+    int64_t            stats_next;    // Monotonic deadline of the next publication of the agent statistics, msec
+    char               *prometheus_file; // Path of the Prometheus text file (NULL: none)
+    int                prometheus_interval; // Interval between writes of the Prometheus text file, msec
+    int64_t            prometheus_next; // Monotonic deadline of the next write of the Prometheus text file, msec
+    uint64_t           prometheus_written; // Number of Prometheus text files written
+    uint64_t           prometheus_failed; // Number of Prometheus text files which failed to be written
+    fty_sensor_gpio_shm_t *shm;       // Shared memory table of the sensors states (NULL: none)
+    fty_sensor_gpio_alerts_t *alerts;  // Local alerts generation (NULL: disabled)
+    char               *endpoint;     // Malamute endpoint, for the alerts client
 };
 
+static void s_save_state_file (fty_sensor_gpio_server_t *self, const char *state_file);
+static void s_publish_stats (fty_sensor_gpio_server_t *self);
+static void s_write_prometheus (fty_sensor_gpio_server_t *self);
+
 // Flag to share if HW capabilities were successfully received
 bool hw_cap_inited = false;
 
@@ -213,6 +551,90 @@ my_mlm_client_recv (mlm_client_t *client, int timeout)
     }
     return NULL;
 }
+//  --------------------------------------------------------------------------
+//  Read a clock, in nanoseconds
+
+static int64_t
+s_clock_ns (clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime (clock, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//  --------------------------------------------------------------------------
+//  Record the time of a sample of a sensor, on both the monotonic clock (for
+//  latencies) and the wall clock (for the metrics)
+
+static void
+s_stamp_sample (_gpx_info_t *sensor)
+{
+    sensor->sample_mono_ns = s_clock_ns (CLOCK_MONOTONIC);
+    sensor->sample_time_ns = s_clock_ns (CLOCK_REALTIME);
+}
+
+//  --------------------------------------------------------------------------
+//  Add the time of the last sample of a sensor to the aux of its metric, as
+//  'sample_time_ns' (wall clock) and 'sample_age_ns' (time elapsed from the
+//  sample to the publication), and return the time of the metric: the one
+//  of the sample when there is one, rather than the one of the publication
+
+static time_t
+s_sample_time (zhash_t *aux, _gpx_info_t *sensor)
+{
+    if (sensor->sample_mono_ns <= 0)
+        return time (NULL);
+    zhash_insert (aux, "sample_time_ns", (void*) std::to_string (sensor->sample_time_ns).c_str ());
+    zhash_insert (aux, "sample_age_ns",
+        (void*) std::to_string (s_clock_ns (CLOCK_MONOTONIC) - sensor->sample_mono_ns).c_str ());
+    return (time_t) (sensor->sample_time_ns / 1000000000);
+}
+
+//  --------------------------------------------------------------------------
+//  Count the result (mlm_client_send return code) of a metric publication
+
+static void
+s_count_publish (fty_sensor_gpio_server_t *self, int r)
+{
+    if (r == 0)
+        self->published++;
+    else
+        self->publish_failures++;
+}
+
+//  --------------------------------------------------------------------------
+//  Record the latencies of the publication of a state change, per stage:
+//  from the first sample in the new state (or the sample which revealed it)
+//  to its acceptance, then to the publication request ('enqueue_ns'), and
+//  to its completion ('sent_ns'). Times are monotonic, nsec
+
+static void
+s_record_latency (fty_sensor_gpio_server_t *self, _gpx_info_t *sensor, int64_t enqueue_ns, int64_t sent_ns)
+{
+    int64_t start_ns = (sensor->raw_change_ns > 0)? sensor->raw_change_ns : sensor->sample_mono_ns;
+    if (start_ns <= 0)
+        start_ns = sensor->accept_mono_ns;
+    gpio_latency_record (self->latency [LATENCY_FILTER], (sensor->accept_mono_ns - start_ns) / 1000);
+    gpio_latency_record (self->latency [LATENCY_ENQUEUE], (enqueue_ns - sensor->accept_mono_ns) / 1000);
+    gpio_latency_record (self->latency [LATENCY_SEND], (sent_ns - enqueue_ns) / 1000);
+    gpio_latency_record (self->latency [LATENCY_TOTAL], (sent_ns - start_ns) / 1000);
+}
+
+//  --------------------------------------------------------------------------
+//  Format the port of a sensor: 'GPIn' or 'GPOn', or 'VGIn' for a virtual
+//  sensor
+
+static void
+s_port_name (_gpx_info_t *sensor, char *port, size_t size)
+{
+    if (sensor->expr)
+        snprintf (port, size, "VGI%i", sensor->gpx_number);
+    else
+        snprintf (port, size, "GP%c%i",
+            ((sensor->gpx_direction == GPIO_DIRECTION_IN)?'I':'O'),
+            sensor->gpx_number);
+}
+
 //  --------------------------------------------------------------------------
 //  Publish status of the pointed GPIO sensor
 
@@ -223,18 +645,19 @@ void publish_status (fty_sensor_gpio_server_t *self, _gpx_info_t *sensor, int tt
 
         zhash_t *aux = zhash_new ();
         zhash_autofree (aux);
-        char port[6];  // "GPI" + "xx" + '\0'
-        memset(&port[0], 0, 6);
-        snprintf(&port[0], 6, "GP%c%i",
-            ((sensor->gpx_direction == GPIO_DIRECTION_IN)?'I':'O'),
-            sensor->gpx_number);
+        char port[16];  // "GPI" + up to 10 digits + '\0'
+        s_port_name (sensor, port, sizeof (port));
         zhash_insert (aux, FTY_PROTO_METRICS_SENSOR_AUX_PORT, (void*) &port[0]);
         zhash_insert (aux, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, (void*) sensor->asset_name);
+        if (sensor->flap && gpio_flap_flapping (sensor->flap)) {
+            zhash_insert (aux, "flapping", (void*) "true");
+            zhash_insert (aux, "transitions", (void*) std::to_string (gpio_flap_transitions (sensor->flap)).c_str ());
+        }
         string msg_type = string("status.") + &port[0];
 
         zmsg_t *msg = fty_proto_encode_metric (
             aux,
-            time (NULL),
+            s_sample_time (aux, sensor),
             ttl,
             msg_type.c_str (),
             sensor->parent, // sensor->asset_name
@@ -249,131 +672,1801 @@ void publish_status (fty_sensor_gpio_server_t *self, _gpx_info_t *sensor, int tt
                 &port[0], msg_type.c_str(),
                 libgpio_get_status_string(sensor->current_state).c_str());
 
+            int64_t enqueue_ns = s_clock_ns (CLOCK_MONOTONIC);
             int r = mlm_client_send (self->mlm, topic.c_str (), &msg);
+            s_count_publish (self, r);
             if( r != 0 )
-                my_zsys_debug(self->verbose, "failed to send measurement %s result %", topic.c_str(), r);
+                my_zsys_debug(self->verbose, "failed to send measurement %s result %d", topic.c_str(), r);
+            if ((r == 0) && (sensor->accept_mono_ns > 0))
+                s_record_latency (self, sensor, enqueue_ns, s_clock_ns (CLOCK_MONOTONIC));
             zmsg_destroy (&msg);
         }
+        // The change is published
+        if (sensor->accept_mono_ns > 0) {
+            sensor->accept_mono_ns = 0;
+            sensor->raw_change_ns = 0;
+        }
 }
 
 //  --------------------------------------------------------------------------
-//  Check GPIO status and generate alarms if needed
+//  Publish the pulses count and rate of the pointed GPI in counter mode, as
+//  'pulses.GPIn' and 'pulse_rate.GPIn' (pulses per second) metrics
 
 static void
-s_check_gpio_status(fty_sensor_gpio_server_t *self)
+s_publish_counter (fty_sensor_gpio_server_t *self, _gpx_info_t *sensor, int ttl)
 {
-    my_zsys_debug (self->verbose, "%s_server: %s", self->name, __func__);
+    char port[16];  // "GPI" + up to 10 digits + '\0'
+    snprintf (port, sizeof (port), "GPI%i", sensor->gpx_number);
+    std::string values[] = {
+        std::to_string (gpio_counter_total (sensor->counter)),
+        std::to_string (gpio_counter_rate (sensor->counter, zclock_mono ()))
+    };
+    const char *types[] = { "pulses.", "pulse_rate." };
+    const char *units[] = { "", "Hz" };
+
+    for (int i = 0; i < 2; i++) {
+        zhash_t *aux = zhash_new ();
+        zhash_autofree (aux);
+        zhash_insert (aux, FTY_PROTO_METRICS_SENSOR_AUX_PORT, (void*) port);
+        zhash_insert (aux, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, (void*) sensor->asset_name);
+        std::string msg_type = string (types [i]) + port;
+        zmsg_t *msg = fty_proto_encode_metric (
+            aux,
+            s_sample_time (aux, sensor),
+            ttl,
+            msg_type.c_str (),
+            sensor->parent,
+            values [i].c_str (),
+            units [i]);
+        zhash_destroy (&aux);
+        if (msg) {
+            std::string topic = msg_type + string("@") + sensor->parent;
+            my_zsys_debug (self->verbose, "\tPort: %s, type: %s, value: %s",
+                port, msg_type.c_str (), values [i].c_str ());
+            int r = mlm_client_send (self->mlm, topic.c_str (), &msg);
+            s_count_publish (self, r);
+            if( r != 0 )
+                my_zsys_debug(self->verbose, "failed to send measurement %s result %d", topic.c_str(), r);
+            zmsg_destroy (&msg);
+        }
+    }
+}
 
-    pthread_mutex_lock (&gpx_list_mutex);
+//  --------------------------------------------------------------------------
+//  Edge watcher actor: wait for the edges of the GPIs in counter mode, which
+//  the sampling of their level would miss, and report the pulses counted to
+//  the server every EDGE_WATCHER_REPORT_INTERVAL, so that bursts of pulses
+//  don't flood it.
+//  Commands: WATCH/<asset>/<descriptor>, UNWATCH/<asset>/<GPI number>
+//  Reports:  PULSES/<asset>/<count>/<monotonic time>/<wall clock time>,
+//            with the times of the last edge, in nanoseconds
+//            UNWATCHED/<GPI number>, once the descriptor of a GPI unwatched
+//            is closed, for the server to release the GPI
+//  The only GPIO library call of the edge watcher is libgpio_watch_ack: all
+//  the others are made by the server.
+
+struct edge_watch_t {
+    std::string asset_name;
+    int         fd;       // Value descriptor of the GPI, as from libgpio_watch
+    uint64_t    pending;  // Pulses counted since the last report
+    int64_t     edge_mono_ns; // Monotonic time of the last edge, nsec
+    int64_t     edge_time_ns; // Wall clock time of the last edge, nsec
+};
 
-    // number of sensors monitored in gpx_list
-    zlistx_t *gpx_list = get_gpx_list(self->verbose);
-    if (!gpx_list) {
-        my_zsys_debug (self->verbose, "GPx list not initialized, skipping");
-        pthread_mutex_unlock (&gpx_list_mutex);
-        return;
-    }
-    int sensors_count = zlistx_size (gpx_list);
-    _gpx_info_t *gpx_info = NULL;
+static void
+s_edge_watcher (zsock_t *pipe, void *args)
+{
+    libgpio_t *gpio_lib = (libgpio_t *) args;
+    std::vector<edge_watch_t> watches;
+    std::vector<struct pollfd> items;
+    int64_t next_report = 0;
+    bool terminated = false;
 
-    if (sensors_count == 0) {
-        my_zsys_debug (self->verbose, "No sensors monitored");
-        pthread_mutex_unlock (&gpx_list_mutex);
-        return;
+    zsock_signal (pipe, 0);
+    while (!terminated && !zsys_interrupted) {
+        // The pipe descriptor is edge triggered, so serve all the pending
+        // commands before waiting again
+        while (zsock_events (pipe) & ZMQ_POLLIN) {
+            zmsg_t *message = zmsg_recv (pipe);
+            if (!message) {
+                terminated = true;
+                break;
+            }
+            char *cmd = zmsg_popstr (message);
+            char *asset_name = zmsg_popstr (message);
+            if (!cmd || streq (cmd, "$TERM"))
+                terminated = true;
+            else if (asset_name && streq (cmd, "WATCH")) {
+                char *fd = zmsg_popstr (message);
+                if (fd)
+                    watches.push_back ({ asset_name, atoi (fd), 0, 0, 0 });
+                zstr_free (&fd);
+            }
+            else if (asset_name && streq (cmd, "UNWATCH")) {
+                char *gpx_number = zmsg_popstr (message);
+                for (auto it = watches.begin (); it != watches.end (); ++it) {
+                    if (it->asset_name == asset_name) {
+                        if (it->fd >= 0)
+                            close (it->fd);
+                        watches.erase (it);
+                        break;
+                    }
+                }
+                // No more polled, the GPI can be released
+                if (gpx_number)
+                    zstr_sendx (pipe, "UNWATCHED", gpx_number, NULL);
+                zstr_free (&gpx_number);
+            }
+            zstr_free (&cmd);
+            zstr_free (&asset_name);
+            zmsg_destroy (&message);
+        }
+        if (terminated)
+            break;
+
+        items.clear ();
+        items.push_back ({ zsock_fd (pipe), POLLIN, 0 });
+        for (edge_watch_t &watch : watches)
+            items.push_back ({ watch.fd, POLLPRI, 0 });
+        int timeout = -1;
+        if (next_report > 0) {
+            int64_t remaining = next_report - zclock_mono ();
+            timeout = (remaining > 0)? (int) remaining : 0;
+        }
+        if ((poll (items.data (), items.size (), timeout) == -1) && (errno != EINTR)) {
+            zsys_error ("%s: poll failed (errno %i)", __func__, errno);
+            break;
+        }
+        // Edges are stamped as soon as they wake us up
+        int64_t wake_mono_ns = s_clock_ns (CLOCK_MONOTONIC);
+        int64_t wake_time_ns = s_clock_ns (CLOCK_REALTIME);
+        for (size_t i = 1; i < items.size (); i++) {
+            if (items [i].revents & POLLNVAL) {
+                // Closed behind our back, ignore it until unwatched
+                watches [i - 1].fd = -1;
+            }
+            else
+            if (items [i].revents & POLLPRI) {
+                libgpio_watch_ack (gpio_lib, items [i].fd);
+                watches [i - 1].pending++;
+                watches [i - 1].edge_mono_ns = wake_mono_ns;
+                watches [i - 1].edge_time_ns = wake_time_ns;
+                if (next_report == 0)
+                    next_report = zclock_mono () + EDGE_WATCHER_REPORT_INTERVAL;
+            }
+        }
+        if ((next_report > 0) && (zclock_mono () >= next_report)) {
+            for (edge_watch_t &watch : watches) {
+                if (watch.pending > 0) {
+                    zstr_sendx (pipe, "PULSES", watch.asset_name.c_str (),
+                        std::to_string (watch.pending).c_str (),
+                        std::to_string (watch.edge_mono_ns).c_str (),
+                        std::to_string (watch.edge_time_ns).c_str (), NULL);
+                    watch.pending = 0;
+                }
+            }
+            next_report = 0;
+        }
     }
-    else
-        my_zsys_debug (self->verbose, "%i sensor(s) monitored", sensors_count);
+    for (edge_watch_t &watch : watches) {
+        if (watch.fd >= 0)
+            close (watch.fd);
+    }
+}
 
-    if(!mlm_client_connected(self->mlm)) {
-        pthread_mutex_unlock (&gpx_list_mutex);
+//  --------------------------------------------------------------------------
+//  Stop watching the edges of a GPI
+
+static void
+s_unwatch (fty_sensor_gpio_server_t *self, const char *asset_name)
+{
+    gpi_watch_t *watch = (gpi_watch_t *) zhashx_lookup (self->watches, asset_name);
+    if (!watch)
         return;
+    my_zsys_debug (self->verbose, "%s: no more counting the pulses of '%s'", self->name, asset_name);
+    if (watch->watching) {
+        // The edge watcher owns the descriptor, and closes it: the GPI is
+        // released once it is no more polled
+        zstr_sendx (self->edge_watcher, "UNWATCH", asset_name,
+            std::to_string (watch->gpx_number).c_str (), NULL);
+        gpi_watch_t *release = (gpi_watch_t *) zmalloc (sizeof (gpi_watch_t));
+        release->gpx_number = watch->gpx_number;
+        zlistx_add_end (self->releasing, release);
     }
+    zhashx_delete (self->watches, asset_name);
+}
 
-    // Acquire the current sensor
-    gpx_info = (_gpx_info_t *)zlistx_first (gpx_list);
+//  --------------------------------------------------------------------------
+//  Release a GPI unwatched, once the edge watcher closed its descriptor, from
+//  an UNWATCHED report
 
-    // Loop on all sensors
-    for (int cur_sensor_num = 0; cur_sensor_num < sensors_count; cur_sensor_num++) {
+static void
+s_release_watch (fty_sensor_gpio_server_t *self, zmsg_t *message)
+{
+    char *gpx_number = zmsg_popstr (message);
+    gpi_watch_t *release = (gpi_watch_t *) zlistx_first (self->releasing);
+    while (gpx_number && release) {
+        if (release->gpx_number == atoi (gpx_number)) {
+            libgpio_unwatch (self->gpio_lib, release->gpx_number, -1);
+            zlistx_delete (self->releasing, zlistx_cursor (self->releasing));
+            break;
+        }
+        release = (gpi_watch_t *) zlistx_next (self->releasing);
+    }
+    zstr_free (&gpx_number);
+}
 
-        // No processing if not yet init'ed
-        if (gpx_info) {
+//  --------------------------------------------------------------------------
+//  Is this GPI unwatched, and not released yet?
 
-            my_zsys_debug (self->verbose, "Checking status of GPx sensor '%s'",
-                gpx_info->asset_name);
+static bool
+s_releasing (fty_sensor_gpio_server_t *self, int gpx_number)
+{
+    gpi_watch_t *release = (gpi_watch_t *) zlistx_first (self->releasing);
+    while (release) {
+        if (release->gpx_number == gpx_number)
+            return true;
+        release = (gpi_watch_t *) zlistx_next (self->releasing);
+    }
+    return false;
+}
 
-            // If there is a GPO power source, then activate it prior to
-            // accessing the GPI!
-            if ( gpx_info->power_source && (!streq(gpx_info->power_source, "")) ) {
-                my_zsys_debug (self->verbose, "Activating GPO power source %s",
-                    gpx_info->power_source);
+//  --------------------------------------------------------------------------
+//  Align the GPIs watched by the edge watcher with the sensors in counter
+//  mode (gpx_list_mutex held by the caller)
 
-                if (libgpio_write ( self->gpio_lib,
-                                    atoi(gpx_info->power_source),
-                                    GPIO_STATE_OPENED) != 0) {
-                    zsys_error ("Failed to activate GPO power source!");
+static void
+s_update_watches (fty_sensor_gpio_server_t *self, zlistx_t *gpx_list)
+{
+    // Drop the sensors which are gone, or which changed
+    std::vector<std::string> stale;
+    gpi_watch_t *watch = (gpi_watch_t *) zhashx_first (self->watches);
+    while (watch) {
+        const char *asset_name = (const char *) zhashx_cursor (self->watches);
+        _gpx_info_t *gpx_info = get_gpx_info (asset_name);
+        if (!gpx_info || !streq (gpx_info->asset_name, asset_name) || !gpx_info->counter
+            || (gpx_info->gpx_number != watch->gpx_number) || !streq (gpx_info->counter_edge, watch->edge))
+            stale.push_back (asset_name);
+        watch = (gpi_watch_t *) zhashx_next (self->watches);
+    }
+    for (const std::string &asset_name : stale)
+        s_unwatch (self, asset_name.c_str ());
+
+    // And watch the new ones, or retry those which failed
+    int64_t now = zclock_mono ();
+    _gpx_info_t *gpx_info = (_gpx_info_t *) zlistx_first (gpx_list);
+    while (gpx_info) {
+        if (gpx_info->counter) {
+            watch = (gpi_watch_t *) zhashx_lookup (self->watches, gpx_info->asset_name);
+            if (!watch) {
+                watch = (gpi_watch_t *) zmalloc (sizeof (gpi_watch_t));
+                watch->gpx_number = gpx_info->gpx_number;
+                watch->edge = strdup (gpx_info->counter_edge);
+                zhashx_insert (self->watches, gpx_info->asset_name, watch);
+            }
+            // A GPI is watched again only once released
+            if (!watch->watching && (now >= watch->retry) && !s_releasing (self, watch->gpx_number)) {
+                int fd = libgpio_watch (self->gpio_lib, watch->gpx_number, watch->edge);
+                if (fd >= 0) {
+                    my_zsys_debug (self->verbose, "%s: counting the %s edges of '%s'",
+                        self->name, watch->edge, gpx_info->asset_name);
+                    zstr_sendx (self->edge_watcher, "WATCH", gpx_info->asset_name,
+                        std::to_string (fd).c_str (), NULL);
+                    watch->watching = true;
                 }
                 else {
-                    my_zsys_debug (self->verbose, "GPO power source successfully activated.");
-                    // Save the current state
-                    gpx_info->current_state = gpx_info->normal_state;
-                    // Sleep for a second to have the GPx sensor powered and running
-                    zclock_sleep (1000);
+                    zsys_error ("%s: can't watch the edges of GPI #%i (%s), retrying later",
+                        self->name, watch->gpx_number, gpx_info->asset_name);
+                    watch->retry = now + EDGE_WATCHER_RETRY_DELAY;
                 }
             }
+        }
+        gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+    }
+}
 
-            // get the correct GPO status if applicable
-            gpo_state_t *state = (gpo_state_t *) zhashx_lookup (self->gpo_states, (void *) gpx_info->asset_name);
-            if ((state && (gpx_info->current_state == GPIO_STATE_UNKNOWN))) {
-                gpx_info->current_state = state->last_action;
-                my_zsys_debug (self->verbose, "changed GPO state from GPIO_STATE_UNKNOWN to %s", libgpio_get_status_string (gpx_info->current_state).c_str ());
-            }
-
-            // Get the current sensor status, only for GPIs, or when no status
-            // have been set to GPOs. Otherwise, that reinit GPOs!
-            if ( (gpx_info->gpx_direction != GPIO_DIRECTION_OUT)
-                || (gpx_info->current_state == GPIO_STATE_UNKNOWN) ) {
-                gpx_info->current_state = libgpio_read( self->gpio_lib,
-                                                        gpx_info->gpx_number,
-                                                        gpx_info->gpx_direction);
-                if (state)
-                    state->last_action = gpx_info->current_state;
-            }
-            if (gpx_info->current_state == GPIO_STATE_UNKNOWN) {
-                zsys_error ("Can't read GPx sensor #%i status", gpx_info->gpx_number);
-            }
-            else {
-                my_zsys_debug (self->verbose, "Read '%s' (value: %i) on GPx sensor #%i (%s/%s)",
-                    libgpio_get_status_string(gpx_info->current_state).c_str(),
-                    gpx_info->current_state, gpx_info->gpx_number,
-                    gpx_info->ext_name, gpx_info->asset_name);
+//  --------------------------------------------------------------------------
+//  Account for the pulses counted on a GPI in counter mode, from a PULSES
+//  report: <asset>/<count>[/<monotonic time>/<wall clock time>]
 
-                publish_status (self, gpx_info, 300);
-            }
+static void
+s_count_pulses (fty_sensor_gpio_server_t *self, zmsg_t *message)
+{
+    char *asset_name = zmsg_popstr (message);
+    char *count = zmsg_popstr (message);
+    char *edge_mono_ns = zmsg_popstr (message);
+    char *edge_time_ns = zmsg_popstr (message);
+    pthread_mutex_lock (&gpx_list_mutex);
+    _gpx_info_t *gpx_info = (asset_name && count)? get_gpx_info (asset_name) : NULL;
+    if (gpx_info && streq (gpx_info->asset_name, asset_name) && gpx_info->counter) {
+        uint64_t pulses = strtoull (count, NULL, 10);
+        gpio_counter_add (gpx_info->counter, pulses, zclock_mono ());
+        self->pulses += pulses;
+        if (edge_mono_ns && edge_time_ns) {
+            gpx_info->sample_mono_ns = strtoll (edge_mono_ns, NULL, 10);
+            gpx_info->sample_time_ns = strtoll (edge_time_ns, NULL, 10);
         }
-        gpx_info = (_gpx_info_t *)zlistx_next (gpx_list);
     }
     pthread_mutex_unlock (&gpx_list_mutex);
+    zstr_free (&asset_name);
+    zstr_free (&count);
+    zstr_free (&edge_mono_ns);
+    zstr_free (&edge_time_ns);
 }
 
 //  --------------------------------------------------------------------------
-//  process message from MAILBOX DELIVER
-void static
-s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
+//  Account the time elapsed since the previous accounting to the state the
+//  sensor was in (gpx_list_mutex held by the caller)
+
+static void
+s_account_time (_gpx_info_t *gpx_info, int64_t now)
 {
-    std::string subject = mlm_client_subject (self->mlm);
-/*    std::string command = zmsg_popstr (message);
-    if (command == "") {
-        zmsg_destroy (&message);
-        zsys_warning ("Empty subject.");
-        return;
-    }
+    int state = gpx_info->change_state;
+    if ((gpx_info->state_since > 0) && ((state == GPIO_STATE_CLOSED) || (state == GPIO_STATE_OPENED)))
+        gpx_info->state_time [state] += now - gpx_info->state_since;
+    gpx_info->state_since = now;
+}
 
-    if (command != "GET") {
+//  --------------------------------------------------------------------------
+//  Write the state of a sensor to the shared memory table, if any. Nothing
+//  is written unless the sensor is new or its state changed.
+
+static void
+s_shm_update (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info)
+{
+    if (!self->shm)
+        return;
+    fty_sensor_gpio_shm_entry_t entry;
+    memset (&entry, 0, sizeof (entry));
+    snprintf (entry.asset_name, sizeof (entry.asset_name), "%s", gpx_info->asset_name);
+    s_port_name (gpx_info, entry.port, sizeof (entry.port));
+    entry.direction = gpx_info->gpx_direction;
+    entry.number = gpx_info->gpx_number;
+    entry.state = gpx_info->current_state;
+    entry.time_ns = gpx_info->last_change * 1000000;
+    if (fty_sensor_gpio_shm_update (self->shm, &entry) < 0)
+        my_zsys_debug (self->verbose, "%s: no room left for '%s' in the shared memory table",
+            self->name, gpx_info->asset_name);
+}
+
+//  --------------------------------------------------------------------------
+//  Bring the shared memory table, if any, in line with the list of sensors:
+//  add the new ones, and free the slots of those which are gone
+//  (gpx_list_mutex held by the caller)
+
+static void
+s_shm_sync (fty_sensor_gpio_server_t *self, zlistx_t *gpx_list)
+{
+    if (!self->shm)
+        return;
+    fty_sensor_gpio_shm_sweep_begin (self->shm);
+    _gpx_info_t *gpx_info = (_gpx_info_t *) zlistx_first (gpx_list);
+    while (gpx_info) {
+        s_shm_update (self, gpx_info);
+        gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+    }
+    fty_sensor_gpio_shm_sweep_end (self->shm);
+}
+
+//  --------------------------------------------------------------------------
+//  Record a sample of the state of a sensor in its history, and the time
+//  of its state changes, whatever their origin, write them in place in
+//  the shared memory table, and evaluate the alerts right away
+//  (gpx_list_mutex held by the caller)
+
+static void
+s_track_change (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info)
+{
+    s_account_time (gpx_info, zclock_mono ());
+    if (gpx_info->history)
+        gpio_history_add (gpx_info->history, zclock_time (), gpx_info->current_state);
+    if (gpx_info->current_state != gpx_info->change_state) {
+        int previous_state = gpx_info->change_state;
+        gpx_info->change_state = gpx_info->current_state;
+        gpx_info->last_change = zclock_time ();
+        update_gpx_state_index (gpx_info, previous_state);
+        update_gpx_abnormal (gpx_info, previous_state);
+        s_shm_update (self, gpx_info);
+    }
+    if (self->alerts)
+        fty_sensor_gpio_alerts_check (self->alerts, gpx_info);
+}
+
+//  --------------------------------------------------------------------------
+//  Publish the count of GPI in abnormal state for a sensor type and a
+//  location, as 'abnormal_count.<type>' on the location
+
+static void
+s_publish_abnormal_count (fty_sensor_gpio_server_t *self, _gpx_abnormal_t *abnormal, int64_t now)
+{
+    std::string msg_type = std::string ("abnormal_count.") + abnormal->type;
+    zmsg_t *msg = fty_proto_encode_metric (
+        NULL,
+        time (NULL),
+        GPIO_ABNORMAL_COUNT_TTL,
+        msg_type.c_str (),
+        abnormal->location,
+        std::to_string (abnormal->count).c_str (),
+        "");
+    if (msg) {
+        std::string topic = msg_type + "@" + abnormal->location;
+        my_zsys_debug (self->verbose, "Publishing %s = %d", topic.c_str (), abnormal->count);
+        int r = mlm_client_send (self->mlm, topic.c_str (), &msg);
+        s_count_publish (self, r);
+        if (r != 0)
+            my_zsys_debug (self->verbose, "failed to send measurement %s result %d", topic.c_str (), r);
+        zmsg_destroy (&msg);
+    }
+    abnormal->last_publish = now;
+    self->abnormal_published++;
+}
+
+//  --------------------------------------------------------------------------
+//  Publish the abnormal state counts which changed, and refresh all of
+//  them before their TTL expires (gpx_list_mutex held by the caller)
+
+static void
+s_publish_abnormal_counts (fty_sensor_gpio_server_t *self)
+{
+    int64_t now = zclock_mono ();
+    _gpx_abnormal_t *abnormal = pop_gpx_abnormal_change ();
+    while (abnormal) {
+        s_publish_abnormal_count (self, abnormal, now);
+        abnormal = pop_gpx_abnormal_change ();
+    }
+    if (now < self->abnormal_refresh)
+        return;
+    zhashx_t *counts = get_gpx_abnormal ();
+    abnormal = counts? (_gpx_abnormal_t *) zhashx_first (counts) : NULL;
+    while (abnormal) {
+        if (now - abnormal->last_publish >= GPIO_ABNORMAL_COUNT_TTL * 1000 / 2)
+            s_publish_abnormal_count (self, abnormal, now);
+        abnormal = (_gpx_abnormal_t *) zhashx_next (counts);
+    }
+    self->abnormal_refresh = now + GPIO_ABNORMAL_COUNT_TTL * 1000 / 4;
+}
+
+//  --------------------------------------------------------------------------
+//  Publish the times in state of a GPI: its cumulative time opened since it
+//  is monitored, as 'open_time.GPIn' (seconds), and the share of time it
+//  has been opened since the previous publication, as 'duty_cycle.GPIn' (%)
+
+static void
+s_publish_dwell_time (fty_sensor_gpio_server_t *self, _gpx_info_t *sensor, int ttl)
+{
+    int64_t opened = sensor->state_time [GPIO_STATE_OPENED] - sensor->dwell_published [GPIO_STATE_OPENED];
+    int64_t closed = sensor->state_time [GPIO_STATE_CLOSED] - sensor->dwell_published [GPIO_STATE_CLOSED];
+    char port[16];  // "GPI" + up to 10 digits + '\0'
+    s_port_name (sensor, port, sizeof (port));
+    std::string values[] = {
+        std::to_string (sensor->state_time [GPIO_STATE_OPENED] / 1000.0),
+        std::to_string ((opened + closed > 0)? opened * 100.0 / (opened + closed) : 0.0)
+    };
+    const char *types[] = { "open_time.", "duty_cycle." };
+    const char *units[] = { "s", "%" };
+
+    for (int i = 0; i < 2; i++) {
+        // No duty cycle without any time accounted since the previous one
+        if ((i == 1) && (opened + closed <= 0))
+            break;
+        zhash_t *aux = zhash_new ();
+        zhash_autofree (aux);
+        zhash_insert (aux, FTY_PROTO_METRICS_SENSOR_AUX_PORT, (void*) port);
+        zhash_insert (aux, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, (void*) sensor->asset_name);
+        std::string msg_type = string (types [i]) + port;
+        zmsg_t *msg = fty_proto_encode_metric (
+            aux,
+            time (NULL),
+            ttl,
+            msg_type.c_str (),
+            sensor->parent,
+            values [i].c_str (),
+            units [i]);
+        zhash_destroy (&aux);
+        if (msg) {
+            std::string topic = msg_type + string("@") + sensor->parent;
+            my_zsys_debug (self->verbose, "\tPort: %s, type: %s, value: %s",
+                port, msg_type.c_str (), values [i].c_str ());
+            int r = mlm_client_send (self->mlm, topic.c_str (), &msg);
+            s_count_publish (self, r);
+            if( r != 0 )
+                my_zsys_debug(self->verbose, "failed to send measurement %s result %d", topic.c_str(), r);
+            zmsg_destroy (&msg);
+            self->dwell_published++;
+        }
+    }
+    sensor->dwell_published [GPIO_STATE_OPENED] = sensor->state_time [GPIO_STATE_OPENED];
+    sensor->dwell_published [GPIO_STATE_CLOSED] = sensor->state_time [GPIO_STATE_CLOSED];
+}
+
+//  --------------------------------------------------------------------------
+//  Publish the times in state of all the GPIs, once per dwell interval, and
+//  save them along with the state file (gpx_list_mutex held by the caller)
+
+static void
+s_publish_dwell_times (fty_sensor_gpio_server_t *self, zlistx_t *gpx_list)
+{
+    int64_t now = zclock_mono ();
+    if ((self->dwell_interval <= 0) || (now < self->dwell_next))
+        return;
+    self->dwell_next = now + self->dwell_interval;
+
+    _gpx_info_t *gpx_info = (_gpx_info_t *) zlistx_first (gpx_list);
+    while (gpx_info) {
+        if ((gpx_info->gpx_direction == GPIO_DIRECTION_IN) && !gpx_info->counter
+            && (gpx_info->state_since > 0)) {
+            // Account for the time spent in the current state so far
+            s_account_time (gpx_info, now);
+            s_publish_dwell_time (self, gpx_info, 2 * self->dwell_interval / 1000);
+        }
+        gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+    }
+    if (!self->test_mode && self->state_file)
+        s_save_state_file (self, self->state_file);
+}
+
+//  --------------------------------------------------------------------------
+//  Restore the times in state loaded from the state file to the sensors
+//  which are now monitored (gpx_list_mutex held by the caller)
+
+static void
+s_restore_dwell_times (fty_sensor_gpio_server_t *self, zlistx_t *gpx_list)
+{
+    _gpx_info_t *gpx_info = (_gpx_info_t *) zlistx_first (gpx_list);
+    while (gpx_info) {
+        int64_t *times = (int64_t *) zhashx_lookup (self->dwell_restore, gpx_info->asset_name);
+        if (times) {
+            my_zsys_debug (self->verbose, "%s: restoring the times in state of '%s'",
+                self->name, gpx_info->asset_name);
+            for (int state = GPIO_STATE_CLOSED; state <= GPIO_STATE_OPENED; state++) {
+                gpx_info->state_time [state] += times [state];
+                gpx_info->dwell_published [state] += times [state];
+            }
+            zhashx_delete (self->dwell_restore, gpx_info->asset_name);
+        }
+        gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Return the check interval currently applicable to a sensor, msec:
+//  the burst interval after a state change, the sensor specific interval
+//  (from its template or asset), or the agent one
+
+static int
+s_sensor_interval (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info, int64_t now)
+{
+    if ((gpx_info->burst_interval > 0) && (now < gpx_info->burst_until))
+        return gpx_info->burst_interval;
+    if (gpx_info->poll_interval > 0)
+        return gpx_info->poll_interval;
+    return self->poll_interval;
+}
+
+//  --------------------------------------------------------------------------
+//  Apply the action of an automation rule on its GPO, directly through
+//  libgpio (gpx_list_mutex held by the caller)
+
+static void
+s_apply_rule (fty_sensor_gpio_server_t *self, gpio_rule_t *rule, int gpo_state, int64_t read_time)
+{
+    _gpx_info_t *gpo_info = get_gpx_info (rule->gpo);
+    if (!gpo_info || (gpo_info->gpx_direction != GPIO_DIRECTION_OUT)) {
+        zsys_warning ("%s: rule '%s': can't find GPO '%s'", self->name, rule->name, rule->gpo);
+        return;
+    }
+    if (gpo_info->current_state == gpo_state)
+        return;
+    if (libgpio_write (self->gpio_lib, gpo_info->gpx_number, gpo_state) != 0) {
+        zsys_error ("%s: rule '%s': failed to set GPO '%s' to %s", self->name, rule->name,
+            rule->gpo, libgpio_get_status_string (gpo_state).c_str ());
+        return;
+    }
+    self->rule_actions++;
+    self->rule_latency = (s_clock_ns (CLOCK_MONOTONIC) - read_time) / 1000;
+    gpo_info->current_state = gpo_state;
+    s_track_change (self, gpo_info);
+    gpo_state_t *last_state = (gpo_state_t *) zhashx_lookup (self->gpo_states, gpo_info->asset_name);
+    if (last_state) {
+        last_state->last_action = gpo_state;
+        last_state->in_alert = 1;
+    }
+    zsys_info ("%s: rule '%s': GPO '%s' set to %s, %" PRIi64 " us after the GPI read",
+        self->name, rule->name, rule->gpo, libgpio_get_status_string (gpo_state).c_str (),
+        self->rule_latency);
+    publish_status (self, gpo_info, 300);
+}
+
+//  --------------------------------------------------------------------------
+//  Evaluate the automation rules depending on a GPI which has just been
+//  read at 'read_time' (monotonic, nsec). Actions are only applied on edges
+//  of the rule condition, possibly delayed (gpx_list_mutex held by the
+//  caller).
+
+static void
+s_evaluate_rules (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info, int64_t read_time)
+{
+    int64_t now = zclock_mono ();
+    gpio_rule_t *rule = (gpio_rule_t *) zlistx_first (self->rules);
+    while (rule) {
+        if (streq (rule->gpi, gpx_info->asset_name)
+            || (gpx_info->ext_name && streq (rule->gpi, gpx_info->ext_name))) {
+            bool condition = (gpx_info->current_state == rule->gpi_state);
+            if (condition && !rule->matched) {
+                if ((rule->delay > 0) && (rule->pending == 0))
+                    rule->pending = now + rule->delay;
+                if ((rule->delay == 0) || (now >= rule->pending)) {
+                    rule->matched = true;
+                    rule->pending = 0;
+                    s_apply_rule (self, rule, rule->gpo_state, read_time);
+                }
+            }
+            else
+            if (!condition) {
+                rule->pending = 0;
+                if (rule->matched) {
+                    rule->matched = false;
+                    if (rule->revert)
+                        s_apply_rule (self, rule,
+                            (rule->gpo_state == GPIO_STATE_OPENED)? GPIO_STATE_CLOSED : GPIO_STATE_OPENED,
+                            read_time);
+                }
+            }
+        }
+        rule = (gpio_rule_t *) zlistx_next (self->rules);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Return the earliest deadline of the delayed rule actions depending on a
+//  GPI, or 0 if none
+
+static int64_t
+s_rules_deadline (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info)
+{
+    int64_t deadline = 0;
+    gpio_rule_t *rule = (gpio_rule_t *) zlistx_first (self->rules);
+    while (rule) {
+        if ((rule->pending > 0) && ((deadline == 0) || (rule->pending < deadline))
+            && (streq (rule->gpi, gpx_info->asset_name)
+                || (gpx_info->ext_name && streq (rule->gpi, gpx_info->ext_name))))
+            deadline = rule->pending;
+        rule = (gpio_rule_t *) zlistx_next (self->rules);
+    }
+    return deadline;
+}
+
+//  --------------------------------------------------------------------------
+//  Feed the flapping detector of a sensor, and tell whether its status can
+//  be published. While flapping, the status is published at most once per
+//  rate limit period (flagged as flapping), instead of at every toggle.
+
+static bool
+s_flap_check (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info, bool changed, int64_t now)
+{
+    if (!gpx_info->flap)
+        return true;
+
+    bool was_flapping = gpio_flap_flapping (gpx_info->flap);
+    if (changed)
+        gpio_flap_transition (gpx_info->flap, now);
+    bool flapping = gpio_flap_update (gpx_info->flap, now);
+    if (flapping && !was_flapping) {
+        zsys_warning ("%s: GPx sensor '%s' is flapping (%d transitions), publishing at most every %d ms",
+            self->name, gpx_info->asset_name, gpio_flap_transitions (gpx_info->flap), gpx_info->flap_rate_limit);
+        return true;
+    }
+    if (!flapping) {
+        if (was_flapping)
+            zsys_info ("%s: GPx sensor '%s' is stable again", self->name, gpx_info->asset_name);
+        return true;
+    }
+    if (now - gpx_info->last_publish >= gpx_info->flap_rate_limit)
+        return true;
+    self->flap_suppressed++;
+    return false;
+}
+
+//  --------------------------------------------------------------------------
+//  Compute the state of a virtual sensor (opened when its expression is
+//  true) from the states of its inputs. Only the inputs which have changed
+//  update its evaluation graph (gpx_list_mutex held by the caller)
+
+static int
+s_read_expression (_gpx_info_t *gpx_info)
+{
+    gpio_expr_t *expr = gpx_info->expr;
+    for (int i = 0; i < gpio_expr_inputs (expr); i++) {
+        _gpx_info_t *input = get_gpx_info (gpio_expr_input (expr, i));
+        if (input && (input != gpx_info)
+            && ((input->current_state == GPIO_STATE_OPENED) || (input->current_state == GPIO_STATE_CLOSED))) {
+            gpio_expr_set (expr, i, input->current_state == GPIO_STATE_OPENED);
+            // Its sample is the newest one of its inputs
+            if (input->sample_mono_ns > gpx_info->sample_mono_ns) {
+                gpx_info->sample_mono_ns = input->sample_mono_ns;
+                gpx_info->sample_time_ns = input->sample_time_ns;
+            }
+        }
+    }
+    switch (gpio_expr_value (expr)) {
+        case 1:
+            return GPIO_STATE_OPENED;
+        case 0:
+            return GPIO_STATE_CLOSED;
+        default:
+            return GPIO_STATE_UNKNOWN;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Check the status of one GPIO sensor and publish it.
+//  Return true if the status has changed since the previous check
+
+static bool
+s_check_sensor (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info)
+{
+    my_zsys_debug (self->verbose, "Checking status of GPx sensor '%s'",
+        gpx_info->asset_name);
+
+    // The pulses of a GPI in counter mode are counted from its edges: only
+    // publish them, as reading its level would stop watching the edges
+    if (gpx_info->counter) {
+        s_publish_counter (self, gpx_info, 300);
+        gpx_info->last_publish = zclock_mono ();
+        return false;
+    }
+
+    int previous_state = gpx_info->current_state;
+    int64_t read_time = 0;
+
+    // If there is a GPO power source, then activate it prior to
+    // accessing the GPI!
+    if ( gpx_info->power_source && (!streq(gpx_info->power_source, "")) ) {
+        my_zsys_debug (self->verbose, "Activating GPO power source %s",
+            gpx_info->power_source);
+
+        if (libgpio_write ( self->gpio_lib,
+                            atoi(gpx_info->power_source),
+                            GPIO_STATE_OPENED) != 0) {
+            zsys_error ("Failed to activate GPO power source!");
+        }
+        else {
+            my_zsys_debug (self->verbose, "GPO power source successfully activated.");
+            // Save the current state
+            gpx_info->current_state = gpx_info->normal_state;
+            // Sleep for a second to have the GPx sensor powered and running
+            zclock_sleep (1000);
+        }
+    }
+
+    // get the correct GPO status if applicable
+    gpo_state_t *state = (gpo_state_t *) zhashx_lookup (self->gpo_states, (void *) gpx_info->asset_name);
+    if ((state && (gpx_info->current_state == GPIO_STATE_UNKNOWN))) {
+        gpx_info->current_state = state->last_action;
+        my_zsys_debug (self->verbose, "changed GPO state from GPIO_STATE_UNKNOWN to %s", libgpio_get_status_string (gpx_info->current_state).c_str ());
+    }
+
+    // Get the current sensor status, from its inputs for virtual sensors,
+    // only for GPIs, or when no status have been set to GPOs. Otherwise,
+    // that reinit GPOs!
+    if (gpx_info->expr) {
+        read_time = s_clock_ns (CLOCK_MONOTONIC);
+        gpx_info->current_state = s_read_expression (gpx_info);
+    }
+    else if ( (gpx_info->gpx_direction != GPIO_DIRECTION_OUT)
+        || (gpx_info->current_state == GPIO_STATE_UNKNOWN) ) {
+        read_time = s_clock_ns (CLOCK_MONOTONIC);
+        s_stamp_sample (gpx_info);
+        int read_state = libgpio_read( self->gpio_lib,
+                                       gpx_info->gpx_number,
+                                       gpx_info->gpx_direction);
+        // Remember when the raw samples started to differ from the state,
+        // which the debounce filter may only accept later on
+        if (read_state == gpx_info->current_state)
+            gpx_info->raw_change_ns = 0;
+        else
+        if (gpx_info->raw_change_ns == 0)
+            gpx_info->raw_change_ns = gpx_info->sample_mono_ns;
+        // Debounce GPI samples, possibly oversampled, and publish the
+        // filtered state instead of the raw one
+        if (gpx_info->filter && (read_state != GPIO_STATE_UNKNOWN)) {
+            gpio_filter_sample (gpx_info->filter, read_state, zclock_mono ());
+            for (int i = 1; i < gpx_info->oversample; i++) {
+                s_stamp_sample (gpx_info);
+                gpio_filter_sample (gpx_info->filter,
+                    libgpio_read (self->gpio_lib, gpx_info->gpx_number, gpx_info->gpx_direction),
+                    zclock_mono ());
+            }
+            read_state = gpio_filter_state (gpx_info->filter);
+        }
+        gpx_info->current_state = read_state;
+        if (state)
+            state->last_action = gpx_info->current_state;
+    }
+    if ((gpx_info->current_state == GPIO_STATE_UNKNOWN) && gpx_info->expr) {
+        my_zsys_debug (self->verbose, "Inputs of virtual sensor '%s' not all known yet",
+            gpx_info->asset_name);
+    }
+    else if (gpx_info->current_state == GPIO_STATE_UNKNOWN) {
+        zsys_error ("Can't read GPx sensor #%i status", gpx_info->gpx_number);
+    }
+    else {
+        my_zsys_debug (self->verbose, "Read '%s' (value: %i) on GPx sensor #%i (%s/%s)",
+            libgpio_get_status_string(gpx_info->current_state).c_str(),
+            gpx_info->current_state, gpx_info->gpx_number,
+            gpx_info->ext_name, gpx_info->asset_name);
+
+        // Track the achieved sampling period (moving average)
+        int64_t now = zclock_mono ();
+        if (gpx_info->last_sample > 0) {
+            double period = (double) (now - gpx_info->last_sample);
+            if (gpx_info->sample_period > 0)
+                gpx_info->sample_period += (period - gpx_info->sample_period) / 8;
+            else
+                gpx_info->sample_period = period;
+        }
+        gpx_info->last_sample = now;
+        gpx_info->samples++;
+        s_track_change (self, gpx_info);
+
+        // React locally first, before any publication
+        if (read_time && (gpx_info->gpx_direction == GPIO_DIRECTION_IN) && zlistx_size (self->rules))
+            s_evaluate_rules (self, gpx_info, read_time);
+
+        bool changed = ((previous_state != GPIO_STATE_UNKNOWN)
+            && (gpx_info->current_state != previous_state));
+        if (s_flap_check (self, gpx_info, changed, now)) {
+            if (changed)
+                gpx_info->accept_mono_ns = s_clock_ns (CLOCK_MONOTONIC);
+            publish_status (self, gpx_info, 300);
+            gpx_info->last_publish = now;
+        }
+    }
+    return ((previous_state != GPIO_STATE_UNKNOWN)
+        && (gpx_info->current_state != previous_state));
+}
+
+//  --------------------------------------------------------------------------
+//  Compute the deadline of the next check of a sensor.
+//  Deadlines are kept on a fixed grid of the monotonic clock, so there is no
+//  drift. Each sensor has its own phase on this grid, so that the checks of
+//  sensors sharing the same interval are spread over it instead of being
+//  bunched at the same tick. When a check comes late (power source sleeps,
+//  sysfs retries, ...), the missed ticks are dropped instead of being queued,
+//  and the overrun is accounted for. Return the number of dropped ticks.
+
+static int64_t
+s_schedule_sensor (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info, bool changed, bool realign)
+{
+    int64_t now = zclock_mono ();
+
+    // Enter (or extend) the burst mode upon state change
+    if (changed && (gpx_info->burst_interval > 0)) {
+        gpx_info->burst_until = now + gpx_info->burst_duration;
+        gpx_info->next_poll = now + gpx_info->burst_interval;
+        return 0;
+    }
+    int interval = s_sensor_interval (self, gpx_info, now);
+    if (interval <= 0) {
+        // Scheduler disabled, only explicit checks apply
+        gpx_info->next_poll = 0;
+        return 0;
+    }
+    // Give newly scheduled sensors a phase, using a low discrepancy sequence
+    // (golden ratio) so that phases stay evenly spread whatever the number
+    // of sensors
+    if (gpx_info->poll_phase < 0) {
+        double phase = self->phase_count++ * 0.6180339887498949;
+        gpx_info->poll_phase = phase - (int64_t) phase;
+    }
+    int64_t offset = (int64_t) (gpx_info->poll_phase * interval);
+    int64_t next = offset + ((now - offset) / interval + 1) * interval;
+
+    int64_t dropped = 0;
+    if (realign) {
+        // Don't check again too soon after an explicit check
+        if (next - now < interval / 2)
+            next += interval;
+    }
+    else if ((gpx_info->next_poll > 0) && (next - gpx_info->next_poll > interval))
+        dropped = (next - gpx_info->next_poll) / interval - 1;
+
+    // Don't delay the acceptance of a debounced change, nor a delayed rule
+    // action, until the next tick
+    int64_t pending = gpx_info->filter? gpio_filter_deadline (gpx_info->filter) : 0;
+    if ((pending > 0) && (pending < next))
+        next = (pending > now)? pending : now;
+    pending = s_rules_deadline (self, gpx_info);
+    if ((pending > 0) && (pending < next))
+        next = (pending > now)? pending : now;
+    gpx_info->next_poll = next;
+    return dropped;
+}
+
+//  --------------------------------------------------------------------------
+//  Propagate the change of state of a sensor to the virtual sensors which
+//  depend on it, and check right away the ones whose value has changed, so
+//  that they don't wait for their next check. Chains of virtual sensors are
+//  followed up to GPIO_EXPR_MAX_DEPTH levels, which also breaks cycles
+//  (gpx_list_mutex held by the caller)
+
+#define GPIO_EXPR_MAX_DEPTH 8
+
+static void
+s_propagate_change (fty_sensor_gpio_server_t *self, zlistx_t *gpx_list, _gpx_info_t *gpx_info, int depth)
+{
+    if ((gpx_info->current_state != GPIO_STATE_OPENED) && (gpx_info->current_state != GPIO_STATE_CLOSED))
+        return;
+    if (depth >= GPIO_EXPR_MAX_DEPTH) {
+        zsys_warning ("%s: virtual sensors nested too deeply from '%s', stopping the propagation",
+            self->name, gpx_info->asset_name);
+        return;
+    }
+    // Collect the dependents first, as checking them walks the list again
+    std::vector<_gpx_info_t *> changed;
+    _gpx_info_t *sensor = (_gpx_info_t *)zlistx_first (gpx_list);
+    while (sensor) {
+        if (sensor->expr && (sensor != gpx_info)) {
+            int index = gpio_expr_find (sensor->expr, gpx_info->asset_name);
+            if (index < 0)
+                index = gpio_expr_find (sensor->expr, gpx_info->ext_name);
+            if ((index >= 0)
+                && gpio_expr_set (sensor->expr, index, gpx_info->current_state == GPIO_STATE_OPENED))
+                changed.push_back (sensor);
+        }
+        sensor = (_gpx_info_t *)zlistx_next (gpx_list);
+    }
+    for (_gpx_info_t *dependent : changed) {
+        self->propagations++;
+        bool dependent_changed = s_check_sensor (self, dependent);
+        s_schedule_sensor (self, dependent, dependent_changed, true);
+        if (dependent_changed)
+            s_propagate_change (self, gpx_list, dependent, depth + 1);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Check GPIO status and generate alarms if needed.
+//  When 'all' is true, every sensor is checked. Otherwise, only the sensors
+//  which have reached their deadline are, most overdue first.
+
+static void
+s_check_gpio_status(fty_sensor_gpio_server_t *self, bool all)
+{
+    my_zsys_debug (self->verbose, "%s_server: %s", self->name, __func__);
+
+    int64_t now = zclock_mono ();
+    // By default, wake up again after the agent interval, to catch newly
+    // added sensors
+    self->next_poll = now + self->poll_interval;
+
+    pthread_mutex_lock (&gpx_list_mutex);
+
+    // number of sensors monitored in gpx_list
+    zlistx_t *gpx_list = get_gpx_list(self->verbose);
+    if (!gpx_list) {
+        my_zsys_debug (self->verbose, "GPx list not initialized, skipping");
+        pthread_mutex_unlock (&gpx_list_mutex);
+        return;
+    }
+    s_update_watches (self, gpx_list);
+    s_shm_sync (self, gpx_list);
+    if (zhashx_size (self->dwell_restore) > 0)
+        s_restore_dwell_times (self, gpx_list);
+    int sensors_count = zlistx_size (gpx_list);
+
+    if (sensors_count == 0) {
+        my_zsys_debug (self->verbose, "No sensors monitored");
+        pthread_mutex_unlock (&gpx_list_mutex);
+        return;
+    }
+    else
+        my_zsys_debug (self->verbose, "%i sensor(s) monitored", sensors_count);
+
+    if(!mlm_client_connected(self->mlm)) {
+        pthread_mutex_unlock (&gpx_list_mutex);
+        return;
+    }
+
+    // Collect the sensors to check, ordered by deadline
+    std::vector<_gpx_info_t *> due;
+    _gpx_info_t *gpx_info = (_gpx_info_t *)zlistx_first (gpx_list);
+    while (gpx_info) {
+        if (all || (gpx_info->next_poll <= now))
+            due.push_back (gpx_info);
+        gpx_info = (_gpx_info_t *)zlistx_next (gpx_list);
+    }
+    std::stable_sort (due.begin (), due.end (),
+        [](const _gpx_info_t *a, const _gpx_info_t *b) { return a->next_poll < b->next_poll; });
+
+    // Bound the work done per tick: the sensors which don't fit in the time
+    // budget remain due, and are checked at the next loop iteration, after
+    // pending messages have been served
+    int64_t dropped = 0;
+    size_t checked = 0;
+    for (_gpx_info_t *sensor : due) {
+        if (!all && (self->tick_budget > 0) && (checked > 0)
+            && (zclock_mono () - now >= self->tick_budget)) {
+            self->poll_deferred += due.size () - checked;
+            my_zsys_debug (self->verbose, "%s: tick budget of %d ms exhausted, %zu check(s) deferred",
+                self->name, self->tick_budget, due.size () - checked);
+            break;
+        }
+        bool changed = s_check_sensor (self, sensor);
+        dropped += s_schedule_sensor (self, sensor, changed, all);
+        if (changed)
+            s_propagate_change (self, gpx_list, sensor, 0);
+        checked++;
+    }
+    if (dropped > 0) {
+        self->poll_overruns++;
+        self->poll_dropped += dropped;
+        zsys_warning ("%s: check cycle overran, %" PRIi64 " tick(s) dropped "
+            "(%" PRIu64 " overrun(s) / %" PRIu64 " cycle(s), %" PRIu64 " tick(s) dropped so far)",
+            self->name, dropped, self->poll_overruns, self->poll_cycles + 1, self->poll_dropped);
+    }
+
+    // Publish the aggregates which changed with these checks
+    s_publish_abnormal_counts (self);
+    s_publish_dwell_times (self, gpx_list);
+
+    // Wake up at the earliest sensor deadline
+    gpx_info = (_gpx_info_t *)zlistx_first (gpx_list);
+    while (gpx_info) {
+        if ((gpx_info->next_poll > 0) && (gpx_info->next_poll < self->next_poll))
+            self->next_poll = gpx_info->next_poll;
+        gpx_info = (_gpx_info_t *)zlistx_next (gpx_list);
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+    s_write_prometheus (self);
+}
+
+//  --------------------------------------------------------------------------
+//  Recompute the earliest deadline of the timed GPO actions
+
+static void
+s_timed_reschedule (fty_sensor_gpio_server_t *self)
+{
+    self->timed_next = 0;
+    gpo_state_t *state = (gpo_state_t *) zhashx_first (self->gpo_states);
+    while (state) {
+        if ((state->timed_kind != GPO_TIMED_NONE)
+            && ((self->timed_next == 0) || (state->deadline < self->timed_next)))
+            self->timed_next = state->deadline;
+        state = (gpo_state_t *) zhashx_next (self->gpo_states);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Set a GPO on behalf of a timed action, and reflect it on its sensor,
+//  optionally publishing its status (gpx_list_mutex held by the caller).
+//  Return 0 on success, -1 otherwise
+
+static int
+s_timed_write (fty_sensor_gpio_server_t *self, const char *asset_name, gpo_state_t *state,
+    int value, bool publish)
+{
+    if (libgpio_write (self->gpio_lib, state->gpo_number, value) != 0) {
+        zsys_error ("%s: failed to set GPO '%s' to %s", self->name, asset_name,
+            libgpio_get_status_string (value).c_str ());
+        return -1;
+    }
+    state->last_action = value;
+    _gpx_info_t *gpx_info = get_gpx_info (asset_name);
+    if (gpx_info) {
+        gpx_info->current_state = value;
+        s_track_change (self, gpx_info);
+        if (publish)
+            publish_status (self, gpx_info, 300);
+    }
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  End the timed action of a GPO, restoring its state if requested
+//  (gpx_list_mutex held by the caller)
+
+static void
+s_timed_end (fty_sensor_gpio_server_t *self, const char *asset_name, gpo_state_t *state, bool restore)
+{
+    if (state->timed_kind == GPO_TIMED_NONE)
+        return;
+    my_zsys_debug (self->verbose, "%s: timed action on GPO '%s' ended%s", self->name,
+        asset_name, restore? ", restoring it" : "");
+    state->timed_kind = GPO_TIMED_NONE;
+    state->deadline = 0;
+    if (restore && (state->last_action != state->restore_state))
+        s_timed_write (self, asset_name, state, state->restore_state, true);
+}
+
+//  --------------------------------------------------------------------------
+//  Start a timed action on a GPO (gpx_list_mutex held by the caller).
+//  A request identical to the action in progress only re-arms a pulse or a
+//  timed revert, and leaves a blink untouched. Another timed action replaces
+//  the one in progress, and restores the same state at its end.
+//  Return NULL on success, or the reason of the failure
+
+static const char *
+s_timed_start (fty_sensor_gpio_server_t *self, const char *asset_name, gpo_state_t *state,
+    int kind, int value, int period, int count)
+{
+    int64_t now = zclock_mono ();
+    bool running = (state->timed_kind != GPO_TIMED_NONE);
+    int restore_state = running? state->restore_state : state->last_action;
+    if (restore_state == GPIO_STATE_UNKNOWN)
+        restore_state = state->default_state;
+    int remaining = (kind == GPO_TIMED_BLINK)? ((count > 0)? 2 * count - 2 : -1) : 0;
+    if (kind == GPO_TIMED_PULSE || kind == GPO_TIMED_BLINK)
+        value = (restore_state == GPIO_STATE_OPENED)? GPIO_STATE_CLOSED : GPIO_STATE_OPENED;
+
+    if (running && (state->timed_kind == kind) && (state->period == period)) {
+        if (kind == GPO_TIMED_BLINK) {
+            my_zsys_debug (self->verbose, "%s: GPO '%s' is already blinking", self->name, asset_name);
+            return NULL;
+        }
+        if ((kind == GPO_TIMED_PULSE) || (state->last_action == value)) {
+            state->deadline = now + period;
+            s_timed_reschedule (self);
+            return NULL;
+        }
+    }
+    if (!running && (value == restore_state))
+        return "ACTION_NOT_APPLICABLE";
+    if ((state->last_action != value) && (s_timed_write (self, asset_name, state, value, true) != 0))
+        return "SET_VALUE_FAILED";
+    state->timed_kind = kind;
+    state->restore_state = restore_state;
+    state->period = period;
+    state->remaining = remaining;
+    state->deadline = now + period;
+    state->in_alert = 1;
+    s_timed_reschedule (self);
+    return NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Apply the steps of the timed GPO actions which have reached their
+//  deadline, and schedule the next ones
+
+static void
+s_timed_run (fty_sensor_gpio_server_t *self)
+{
+    int64_t now = zclock_mono ();
+    pthread_mutex_lock (&gpx_list_mutex);
+    gpo_state_t *state = (gpo_state_t *) zhashx_first (self->gpo_states);
+    while (state) {
+        if ((state->timed_kind != GPO_TIMED_NONE) && (state->deadline <= now)) {
+            const char *asset_name = (const char *) zhashx_cursor (self->gpo_states);
+            self->timed_steps++;
+            if (state->remaining == 0)
+                s_timed_end (self, asset_name, state, true);
+            else {
+                // Blink: toggle without publishing, and keep the grid
+                s_timed_write (self, asset_name, state,
+                    (state->last_action == GPIO_STATE_OPENED)? GPIO_STATE_CLOSED : GPIO_STATE_OPENED,
+                    false);
+                if (state->remaining > 0)
+                    state->remaining--;
+                state->deadline += state->period;
+                if (state->deadline <= now)
+                    state->deadline = now + state->period;
+            }
+        }
+        state = (gpo_state_t *) zhashx_next (self->gpo_states);
+    }
+    s_timed_reschedule (self);
+    pthread_mutex_unlock (&gpx_list_mutex);
+}
+
+//  --------------------------------------------------------------------------
+//  Handle a timed GPO_INTERACTION action: pulse/<duration>,
+//  blink/<period>[/<count>], <state>/<duration> or cancel
+//  (gpx_list_mutex held by the caller).
+//  Return NULL on success, or the reason of the failure
+
+static const char *
+s_gpo_timed_interaction (fty_sensor_gpio_server_t *self, _gpx_info_t *gpx_info,
+    const char *action, const char *arg, const char *count)
+{
+    gpo_state_t *state = (gpo_state_t *) zhashx_lookup (self->gpo_states, gpx_info->asset_name);
+    if (!state)
+        return "ASSET_NOT_FOUND";
+    if (streq (action, "cancel")) {
+        if (state->timed_kind == GPO_TIMED_NONE)
+            return "ACTION_NOT_APPLICABLE";
+        s_timed_end (self, gpx_info->asset_name, state, true);
+        s_timed_reschedule (self);
+        return NULL;
+    }
+    int period = arg? atoi (arg) : 0;
+    if (period <= 0)
+        return "BAD_COMMAND";
+    if (streq (action, "pulse"))
+        return s_timed_start (self, gpx_info->asset_name, state, GPO_TIMED_PULSE,
+            GPIO_STATE_UNKNOWN, period, 0);
+    if (streq (action, "blink")) {
+        // 'period' is a full cycle, the GPO toggles every half period
+        if (period < 2)
+            return "BAD_COMMAND";
+        return s_timed_start (self, gpx_info->asset_name, state, GPO_TIMED_BLINK,
+            GPIO_STATE_UNKNOWN, period / 2, count? atoi (count) : 0);
+    }
+    int value = libgpio_get_status_value (action);
+    if (value == GPIO_STATE_UNKNOWN)
+        return "UNKNOWN_VALUE";
+    return s_timed_start (self, gpx_info->asset_name, state, GPO_TIMED_REVERT,
+        value, period, 0);
+}
+
+//  --------------------------------------------------------------------------
+//  Run a scheduled check cycle. Only the sensors which have reached their
+//  deadline are checked, and the next wake up is set to the earliest
+//  deadline.
+
+static void
+s_poll_tick (fty_sensor_gpio_server_t *self)
+{
+    int64_t start_ns = s_clock_ns (CLOCK_MONOTONIC);
+    s_check_gpio_status (self, false);
+    self->poll_cycles++;
+    gpio_latency_record (self->poll_duration, (s_clock_ns (CLOCK_MONOTONIC) - start_ns) / 1000);
+    s_publish_stats (self);
+}
+
+//  --------------------------------------------------------------------------
+//  Return the time to wait until the next scheduled check, msec
+
+static int
+s_poll_timeout (fty_sensor_gpio_server_t *self)
+{
+    int64_t deadline = (self->poll_interval > 0)? self->next_poll : 0;
+    if ((self->timed_next > 0) && ((deadline == 0) || (self->timed_next < deadline)))
+        deadline = self->timed_next;
+    if (deadline == 0)
+        return TIMEOUT_MS;
+    int64_t timeout = deadline - zclock_mono ();
+    return (timeout > 0)? (int) timeout : 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Append the agent statistics to a GPIO_STATS reply, as key/value pairs.
+//  The per sensor statistics are only added if per_sensor is true.
+
+static void
+s_add_stats (fty_sensor_gpio_server_t *self, zmsg_t *reply, bool per_sensor)
+{
+    zmsg_addstr (reply, "poll.cycles");
+    zmsg_addstrf (reply, "%" PRIu64, self->poll_cycles);
+    zmsg_addstr (reply, "poll.duration_p50_us");
+    zmsg_addstrf (reply, "%" PRIi64, gpio_latency_percentile (self->poll_duration, 50));
+    zmsg_addstr (reply, "poll.duration_p99_us");
+    zmsg_addstrf (reply, "%" PRIi64, gpio_latency_percentile (self->poll_duration, 99));
+    zmsg_addstr (reply, "poll.duration_max_us");
+    zmsg_addstrf (reply, "%" PRIi64, gpio_latency_max (self->poll_duration));
+    zmsg_addstr (reply, "poll.overruns");
+    zmsg_addstrf (reply, "%" PRIu64, self->poll_overruns);
+    zmsg_addstr (reply, "poll.dropped");
+    zmsg_addstrf (reply, "%" PRIu64, self->poll_dropped);
+    zmsg_addstr (reply, "poll.deferred");
+    zmsg_addstrf (reply, "%" PRIu64, self->poll_deferred);
+    zmsg_addstr (reply, "flap.suppressed");
+    zmsg_addstrf (reply, "%" PRIu64, self->flap_suppressed);
+    zmsg_addstr (reply, "rules.actions");
+    zmsg_addstrf (reply, "%" PRIu64, self->rule_actions);
+    zmsg_addstr (reply, "rules.latency_us");
+    zmsg_addstrf (reply, "%" PRIi64, self->rule_latency);
+    zmsg_addstr (reply, "timed.steps");
+    zmsg_addstrf (reply, "%" PRIu64, self->timed_steps);
+    zmsg_addstr (reply, "abnormal.published");
+    zmsg_addstrf (reply, "%" PRIu64, self->abnormal_published);
+    zmsg_addstr (reply, "counter.pulses");
+    zmsg_addstrf (reply, "%" PRIu64, self->pulses);
+    zmsg_addstr (reply, "dwell.published");
+    zmsg_addstrf (reply, "%" PRIu64, self->dwell_published);
+    zmsg_addstr (reply, "virtual.propagations");
+    zmsg_addstrf (reply, "%" PRIu64, self->propagations);
+    zmsg_addstr (reply, "metrics.published");
+    zmsg_addstrf (reply, "%" PRIu64, self->published);
+    zmsg_addstr (reply, "metrics.failed");
+    zmsg_addstrf (reply, "%" PRIu64, self->publish_failures);
+    zmsg_addstr (reply, "prometheus.written");
+    zmsg_addstrf (reply, "%" PRIu64, self->prometheus_written);
+    zmsg_addstr (reply, "prometheus.failed");
+    zmsg_addstrf (reply, "%" PRIu64, self->prometheus_failed);
+
+    // Accesses to the GPIO sysfs interface
+    for (int i = 0; i < GPIO_STATS; i++) {
+        zmsg_addstrf (reply, "gpio.%s", gpio_stat_names [i]);
+        zmsg_addstrf (reply, "%" PRIu64, libgpio_get_stat (self->gpio_lib, i));
+    }
+    zmsg_addstr (reply, "gpio.replay_remaining");
+    zmsg_addstrf (reply, "%zu", libgpio_replay_remaining (self->gpio_lib));
+
+    // Latencies of the state changes, per stage
+    for (int i = 0; i < LATENCY_STAGES; i++) {
+        zmsg_addstrf (reply, "latency.%s.count", latency_stage_names [i]);
+        zmsg_addstrf (reply, "%" PRIu64, gpio_latency_count (self->latency [i]));
+        zmsg_addstrf (reply, "latency.%s.p50_us", latency_stage_names [i]);
+        zmsg_addstrf (reply, "%" PRIi64, gpio_latency_percentile (self->latency [i], 50));
+        zmsg_addstrf (reply, "latency.%s.p99_us", latency_stage_names [i]);
+        zmsg_addstrf (reply, "%" PRIi64, gpio_latency_percentile (self->latency [i], 99));
+        zmsg_addstrf (reply, "latency.%s.max_us", latency_stage_names [i]);
+        zmsg_addstrf (reply, "%" PRIi64, gpio_latency_max (self->latency [i]));
+    }
+
+    // Mailbox queues, per class of requests
+    for (int i = 0; i < MAILBOX_CLASSES; i++) {
+        zmsg_addstrf (reply, "mailbox.%s.depth", mailbox_class_names [i]);
+        zmsg_addstrf (reply, "%zu", zlistx_size (self->mailbox_queues [i]));
+        zmsg_addstrf (reply, "mailbox.%s.depth_max", mailbox_class_names [i]);
+        zmsg_addstrf (reply, "%zu", self->mailbox_depth_max [i]);
+        zmsg_addstrf (reply, "mailbox.%s.served", mailbox_class_names [i]);
+        zmsg_addstrf (reply, "%" PRIu64, self->mailbox_served [i]);
+        zmsg_addstrf (reply, "mailbox.%s.latency_p50_us", mailbox_class_names [i]);
+        zmsg_addstrf (reply, "%" PRIi64, gpio_latency_percentile (self->mailbox_latency [i], 50));
+        zmsg_addstrf (reply, "mailbox.%s.latency_p99_us", mailbox_class_names [i]);
+        zmsg_addstrf (reply, "%" PRIi64, gpio_latency_percentile (self->mailbox_latency [i], 99));
+        zmsg_addstrf (reply, "mailbox.%s.latency_max_us", mailbox_class_names [i]);
+        zmsg_addstrf (reply, "%" PRIi64, gpio_latency_max (self->mailbox_latency [i]));
+    }
+    if (!per_sensor)
+        return;
+
+    // Achieved sampling count and rate (Hz) per sensor
+    pthread_mutex_lock (&gpx_list_mutex);
+    zlistx_t *gpx_list = get_gpx_list(self->verbose);
+    _gpx_info_t *gpx_info = gpx_list? (_gpx_info_t *)zlistx_first (gpx_list) : NULL;
+    while (gpx_info) {
+        zmsg_addstrf (reply, "sampling.%s.count", gpx_info->asset_name);
+        zmsg_addstrf (reply, "%" PRIu64, gpx_info->samples);
+        zmsg_addstrf (reply, "sampling.%s.rate", gpx_info->asset_name);
+        zmsg_addstrf (reply, "%.3f", (gpx_info->sample_period > 0)? 1000.0 / gpx_info->sample_period : 0.0);
+        if (gpx_info->filter) {
+            zmsg_addstrf (reply, "filter.%s.glitches", gpx_info->asset_name);
+            zmsg_addstrf (reply, "%" PRIu64, gpio_filter_glitches (gpx_info->filter));
+        }
+        if (gpx_info->flap) {
+            zmsg_addstrf (reply, "flap.%s.episodes", gpx_info->asset_name);
+            zmsg_addstrf (reply, "%" PRIu64, gpio_flap_episodes (gpx_info->flap));
+        }
+        if (gpx_info->counter) {
+            zmsg_addstrf (reply, "counter.%s.pulses", gpx_info->asset_name);
+            zmsg_addstrf (reply, "%" PRIu64, gpio_counter_total (gpx_info->counter));
+            zmsg_addstrf (reply, "counter.%s.rate", gpx_info->asset_name);
+            zmsg_addstrf (reply, "%.3f", gpio_counter_rate (gpx_info->counter, zclock_mono ()));
+        }
+        if (gpx_info->expr) {
+            zmsg_addstrf (reply, "virtual.%s.updates", gpx_info->asset_name);
+            zmsg_addstrf (reply, "%" PRIu64, gpio_expr_updates (gpx_info->expr));
+        }
+        gpx_info = (_gpx_info_t *)zlistx_next (gpx_list);
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+}
+
+//  --------------------------------------------------------------------------
+//  Publish the agent statistics (as GPIO_STATS, without the per sensor ones)
+//  as 'gpio_stats.<key>' metrics of the agent, once per stats interval
+
+static void
+s_publish_stats (fty_sensor_gpio_server_t *self)
+{
+    int64_t now = zclock_mono ();
+    if ((self->stats_interval <= 0) || (now < self->stats_next))
+        return;
+    self->stats_next = now + self->stats_interval;
+
+    zmsg_t *stats = zmsg_new ();
+    s_add_stats (self, stats, false);
+    char *key = zmsg_popstr (stats);
+    char *value = zmsg_popstr (stats);
+    while (key && value) {
+        std::string msg_type = string ("gpio_stats.") + key;
+        zmsg_t *msg = fty_proto_encode_metric (
+            NULL,
+            time (NULL),
+            2 * self->stats_interval / 1000,
+            msg_type.c_str (),
+            self->name,
+            value,
+            "");
+        if (msg) {
+            std::string topic = msg_type + string("@") + self->name;
+            int r = mlm_client_send (self->mlm, topic.c_str (), &msg);
+            s_count_publish (self, r);
+            if( r != 0 )
+                my_zsys_debug(self->verbose, "failed to send measurement %s result %d", topic.c_str(), r);
+            zmsg_destroy (&msg);
+        }
+        zstr_free (&key);
+        zstr_free (&value);
+        key = zmsg_popstr (stats);
+        value = zmsg_popstr (stats);
+    }
+    zstr_free (&key);
+    zmsg_destroy (&stats);
+}
+
+//  --------------------------------------------------------------------------
+//  Add a sample of a sensor to a Prometheus text, with the sensor labels
+
+static void
+s_prom_add_sensor (gpio_prom_t *prom, const char *name, const std::string &value, _gpx_info_t *sensor)
+{
+    char port[16];  // "VGI" + up to 10 digits + '\0'
+    s_port_name (sensor, port, sizeof (port));
+    gpio_prom_add (prom, name, value.c_str (),
+        "asset", sensor->asset_name,
+        "name", sensor->ext_name,
+        "type", sensor->type,
+        "port", port,
+        "parent", sensor->parent,
+        NULL);
+}
+
+//  --------------------------------------------------------------------------
+//  Write the states of the sensors and the agent statistics (as GPIO_STATS,
+//  without the per sensor ones) to the Prometheus text file, once per
+//  Prometheus interval. Only the states cached by the checks are used, so
+//  that the GPIOs are never read for this.
+
+static void
+s_write_prometheus (fty_sensor_gpio_server_t *self)
+{
+    int64_t now = zclock_mono ();
+    if (!self->prometheus_file || (self->prometheus_interval <= 0) || (now < self->prometheus_next))
+        return;
+    self->prometheus_next = now + self->prometheus_interval;
+
+    gpio_prom_t *prom = gpio_prom_new ("fty_sensor_gpio_");
+    pthread_mutex_lock (&gpx_list_mutex);
+    zlistx_t *gpx_list = get_gpx_list (self->verbose);
+    if (gpx_list) {
+        gpio_prom_family (prom, "state", "gauge", "State of the sensor (0: closed, 1: opened, -1: unknown)");
+        _gpx_info_t *gpx_info = (_gpx_info_t *) zlistx_first (gpx_list);
+        while (gpx_info) {
+            s_prom_add_sensor (prom, "state", std::to_string (gpx_info->current_state), gpx_info);
+            gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+        }
+        gpio_prom_family (prom, "open_seconds_total", "counter", "Cumulative time the GPI has been opened");
+        gpx_info = (_gpx_info_t *) zlistx_first (gpx_list);
+        while (gpx_info) {
+            if ((gpx_info->gpx_direction == GPIO_DIRECTION_IN) && !gpx_info->counter)
+                s_prom_add_sensor (prom, "open_seconds_total",
+                    std::to_string (gpx_info->state_time [GPIO_STATE_OPENED] / 1000.0), gpx_info);
+            gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+        }
+        gpio_prom_family (prom, "pulses_total", "counter", "Pulses counted on the GPI in counter mode");
+        gpx_info = (_gpx_info_t *) zlistx_first (gpx_list);
+        while (gpx_info) {
+            if (gpx_info->counter)
+                s_prom_add_sensor (prom, "pulses_total",
+                    std::to_string (gpio_counter_total (gpx_info->counter)), gpx_info);
+            gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+        }
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+
+    // Agent statistics, named after their GPIO_STATS key
+    zmsg_t *stats = zmsg_new ();
+    s_add_stats (self, stats, false);
+    char *key = zmsg_popstr (stats);
+    char *value = zmsg_popstr (stats);
+    while (key && value) {
+        gpio_prom_add (prom, key, value, NULL);
+        zstr_free (&key);
+        zstr_free (&value);
+        key = zmsg_popstr (stats);
+        value = zmsg_popstr (stats);
+    }
+    zstr_free (&key);
+    zmsg_destroy (&stats);
+
+    if (gpio_prom_save (prom, self->prometheus_file) == 0) {
+        self->prometheus_written++;
+    }
+    else {
+        // Only reported once, as the file is retried at each interval
+        if (self->prometheus_failed == 0)
+            zsys_error ("%s: could not write Prometheus file %s", self->name, self->prometheus_file);
+        self->prometheus_failed++;
+    }
+    gpio_prom_destroy (&prom);
+}
+
+//  --------------------------------------------------------------------------
+//  Apply a batch of GPO actions (<sensor>/<action> pairs), with a single
+//  bulk write, and append the global status (OK if all the actions
+//  succeeded) and the per-item results to the reply
+
+static void
+s_gpo_interaction_batch (fty_sensor_gpio_server_t *self, zmsg_t *message, zmsg_t *reply)
+{
+    struct batch_item_t {
+        std::string name;
+        const char  *reason;
+        _gpx_info_t *gpx_info;
+        int         value;
+    };
+    std::vector<batch_item_t> items;
+    std::vector<int> gpo_numbers, values, results;
+    std::vector<size_t> written;
+
+    pthread_mutex_lock (&gpx_list_mutex);
+    char *sensor_name = zmsg_popstr (message);
+    while (sensor_name) {
+        char *action_name = zmsg_popstr (message);
+        batch_item_t item;
+        item.name = sensor_name;
+        item.reason = NULL;
+        item.gpx_info = get_gpx_info (sensor_name);
+        item.value = action_name? libgpio_get_status_value (action_name) : GPIO_STATE_UNKNOWN;
+        if (!item.gpx_info || (item.gpx_info->gpx_direction != GPIO_DIRECTION_OUT))
+            item.reason = "ASSET_NOT_FOUND";
+        else if (item.value == GPIO_STATE_UNKNOWN)
+            item.reason = "UNKNOWN_VALUE";
+        else if (item.value == item.gpx_info->current_state)
+            item.reason = "ACTION_NOT_APPLICABLE";
+        else {
+            // A GPO can only be acted upon once per batch
+            for (const batch_item_t &other : items) {
+                if ((other.gpx_info == item.gpx_info) && !other.reason)
+                    item.reason = "ACTION_NOT_APPLICABLE";
+            }
+        }
+        if (!item.reason) {
+            gpo_numbers.push_back (item.gpx_info->gpx_number);
+            values.push_back (item.value);
+            written.push_back (items.size ());
+        }
+        items.push_back (item);
+        zstr_free (&action_name);
+        zstr_free (&sensor_name);
+        sensor_name = zmsg_popstr (message);
+    }
+
+    if (!gpo_numbers.empty ()) {
+        results.resize (gpo_numbers.size ());
+        libgpio_write_bulk (self->gpio_lib, gpo_numbers.size (), gpo_numbers.data (), values.data (), results.data ());
+        for (size_t i = 0; i < written.size (); i++) {
+            batch_item_t &item = items [written [i]];
+            if (results [i] != 0) {
+                zsys_error ("GPO_INTERACTION_BATCH: failed to set value of '%s'!", item.name.c_str ());
+                item.reason = "SET_VALUE_FAILED";
+                continue;
+            }
+            // Update the GPO state
+            item.gpx_info->current_state = item.value;
+            s_track_change (self, item.gpx_info);
+            gpo_state_t *last_state = (gpo_state_t *) zhashx_lookup (self->gpo_states, item.gpx_info->asset_name);
+            if (last_state) {
+                s_timed_end (self, item.gpx_info->asset_name, last_state, false);
+                last_state->last_action = item.value;
+                last_state->in_alert = 1;
+            }
+        }
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+
+    bool success = !items.empty ();
+    for (const batch_item_t &item : items) {
+        if (item.reason)
+            success = false;
+    }
+    zmsg_addstr (reply, success? "OK" : "ERROR");
+    for (const batch_item_t &item : items) {
+        zmsg_addstr (reply, item.name.c_str ());
+        zmsg_addstr (reply, item.reason? item.reason : "OK");
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Append the cached status of a sensor to a GPIO_STATUS reply
+
+static void
+s_add_status (zmsg_t *reply, _gpx_info_t *gpx_info, int64_t now)
+{
+    zmsg_addstr (reply, gpx_info->asset_name);
+    // Published empty in the metrics, but named in GPIO_STATUS replies
+    if (gpx_info->current_state == GPIO_STATE_UNKNOWN)
+        zmsg_addstr (reply, "unknown");
+    else
+        zmsg_addstr (reply, libgpio_get_status_string (gpx_info->current_state).c_str ());
+    zmsg_addstrf (reply, "%" PRIi64, gpx_info->last_change);
+    zmsg_addstrf (reply, "%" PRIi64, (gpx_info->last_sample > 0)? now - gpx_info->last_sample : -1);
+}
+
+//  --------------------------------------------------------------------------
+//  Append the status of all the sensors, or of the requested ones (by asset
+//  or ext name), to a GPIO_STATUS reply. This only uses the cached states,
+//  without any hardware access.
+
+static void
+s_gpio_status (fty_sensor_gpio_server_t *self, zmsg_t *message, zmsg_t *reply)
+{
+    int64_t now = zclock_mono ();
+    zmsg_t *items = zmsg_new ();
+    const char *reason = NULL;
+
+    pthread_mutex_lock (&gpx_list_mutex);
+    char *sensor_name = zmsg_popstr (message);
+    if (!sensor_name) {
+        zlistx_t *gpx_list = get_gpx_list (self->verbose);
+        _gpx_info_t *gpx_info = gpx_list? (_gpx_info_t *) zlistx_first (gpx_list) : NULL;
+        while (gpx_info) {
+            s_add_status (items, gpx_info, now);
+            gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+        }
+    }
+    while (sensor_name) {
+        _gpx_info_t *gpx_info = get_gpx_info (sensor_name);
+        if (gpx_info)
+            s_add_status (items, gpx_info, now);
+        else {
+            my_zsys_debug (self->verbose, "GPIO_STATUS: can't find sensor '%s'!", sensor_name);
+            reason = "ASSET_NOT_FOUND";
+        }
+        zstr_free (&sensor_name);
+        sensor_name = zmsg_popstr (message);
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+
+    if (reason) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, reason);
+    }
+    else {
+        zmsg_addstr (reply, "OK");
+        char *item = zmsg_popstr (items);
+        while (item) {
+            zmsg_addstr (reply, item);
+            zstr_free (&item);
+            item = zmsg_popstr (items);
+        }
+    }
+    zmsg_destroy (&items);
+}
+
+//  --------------------------------------------------------------------------
+//  Append the history of a sensor within a time range to a GPIO_HISTORY
+//  reply, as runs of identical samples
+
+static void
+s_gpio_history (fty_sensor_gpio_server_t *self, zmsg_t *message, zmsg_t *reply)
+{
+    char *sensor_name = zmsg_popstr (message);
+    char *from_str = zmsg_popstr (message);
+    char *to_str = zmsg_popstr (message);
+    int64_t from = from_str? atoll (from_str) : 0;
+    int64_t to = (to_str && (atoll (to_str) > 0))? atoll (to_str) : INT64_MAX;
+
+    pthread_mutex_lock (&gpx_list_mutex);
+    _gpx_info_t *gpx_info = get_gpx_info (sensor_name);
+    if (!gpx_info || !gpx_info->history) {
+        my_zsys_debug (self->verbose, "GPIO_HISTORY: no history for sensor '%s'!", sensor_name);
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "ASSET_NOT_FOUND");
+    }
+    else {
+        zmsg_addstr (reply, "OK");
+        zmsg_addstr (reply, gpx_info->asset_name);
+        int count = gpio_history_count (gpx_info->history);
+        for (int i = gpio_history_find (gpx_info->history, from); i < count; i++) {
+            int state;
+            int64_t first, last;
+            uint32_t samples;
+            gpio_history_run (gpx_info->history, i, &state, &first, &last, &samples);
+            if (first > to)
+                break;
+            zmsg_addstr (reply, libgpio_get_status_string (state).c_str ());
+            zmsg_addstrf (reply, "%" PRIi64, first);
+            zmsg_addstrf (reply, "%" PRIi64, last);
+            zmsg_addstrf (reply, "%" PRIu32, samples);
+        }
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+    zstr_free (&sensor_name);
+    zstr_free (&from_str);
+    zstr_free (&to_str);
+}
+
+//  --------------------------------------------------------------------------
+//  Return the value of a queried attribute of a sensor
+
+static std::string
+s_query_attribute (_gpx_info_t *gpx_info, const std::string &attribute)
+{
+    const char *value = NULL;
+    if (attribute == "location")
+        value = gpx_info->location;
+    else if (attribute == "type")
+        value = gpx_info->type;
+    else if (attribute == "parent")
+        value = gpx_info->parent;
+    else if (attribute == "state")
+        return libgpio_get_status_string (gpx_info->change_state);
+    return value? value : "";
+}
+
+//  --------------------------------------------------------------------------
+//  Append the asset names of the sensors matching all the criteria of a
+//  GPIO_QUERY request (<attribute>/<value> pairs) to its reply. Candidates
+//  are taken from the smallest set of the secondary indexes, and checked
+//  against the other criteria, so that the cost follows the result rather
+//  than the inventory.
+
+static void
+s_gpio_query (fty_sensor_gpio_server_t *self, zmsg_t *message, zmsg_t *reply)
+{
+    std::vector<std::pair<std::string, std::string>> criteria;
+    bool valid = true;
+    char *attribute = zmsg_popstr (message);
+    while (attribute) {
+        char *value = zmsg_popstr (message);
+        if (!value || !get_gpx_attribute_index (attribute))
+            valid = false;
+        else if (streq (attribute, "state"))
+            // Accept the same state names as GPO_INTERACTION
+            criteria.push_back (std::make_pair (std::string (attribute),
+                libgpio_get_status_string (libgpio_get_status_value (value))));
+        else
+            criteria.push_back (std::make_pair (std::string (attribute), std::string (value)));
+        zstr_free (&value);
+        zstr_free (&attribute);
+        attribute = zmsg_popstr (message);
+    }
+    if (!valid) {
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "BAD_COMMAND");
+        return;
+    }
+    zmsg_addstr (reply, "OK");
+
+    pthread_mutex_lock (&gpx_list_mutex);
+    zlistx_t *candidates = get_gpx_list (self->verbose);
+    for (const auto &criterion : criteria) {
+        zlistx_t *set = gpio_index_lookup (get_gpx_attribute_index (criterion.first.c_str ()),
+            criterion.second.c_str ());
+        if (!set || !candidates || (zlistx_size (set) < zlistx_size (candidates)))
+            candidates = set;
+        if (!candidates)
+            break;
+    }
+    _gpx_info_t *gpx_info = candidates? (_gpx_info_t *) zlistx_first (candidates) : NULL;
+    while (gpx_info) {
+        bool match = true;
+        for (const auto &criterion : criteria) {
+            if (s_query_attribute (gpx_info, criterion.first) != criterion.second) {
+                match = false;
+                break;
+            }
+        }
+        if (match)
+            zmsg_addstr (reply, gpx_info->asset_name);
+        gpx_info = (_gpx_info_t *) zlistx_next (candidates);
+    }
+    pthread_mutex_unlock (&gpx_list_mutex);
+}
+
+//  --------------------------------------------------------------------------
+//  process message from MAILBOX DELIVER
+void static
+s_handle_mailbox(fty_sensor_gpio_server_t* self, const char *subject_str, const char *sender, zmsg_t *message)
+{
+    std::string subject = subject_str? subject_str : "";
+/*    std::string command = zmsg_popstr (message);
+    if (command == "") {
+        zmsg_destroy (&message);
+        zsys_warning ("Empty subject.");
+        return;
+    }
+
+    if (command != "GET") {
         zsys_warning ("%s: Received unexpected command '%s'", self->name, command.c_str());
         zmsg_t *reply = zmsg_new ();
         zmsg_addstr(reply, "ERROR");
         zmsg_addstr (reply, "BAD_COMMAND");
-        mlm_client_sendto (self->mlm, mlm_client_sender (self->mlm), subject.c_str(), NULL, 1000, &reply);
+        mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 1000, &reply);
         zmsg_destroy (&reply);
         return;
     }
@@ -381,12 +2474,15 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
     //we assume all request command are MAILBOX DELIVER, and subject="gpio"
     if ( (subject != "") && (subject != "GPO_INTERACTION") && (subject != "GPIO_TEMPLATE_ADD")
          && (subject != "GPIO_MANIFEST") && (subject != "GPIO_MANIFEST_SUMMARY")
-         && (subject != "GPIO_TEST") && (subject != "GPOSTATE")) {
+         && (subject != "GPIO_TEST") && (subject != "GPOSTATE")
+         && (subject != "GPIO_STATS") && (subject != "GPO_INTERACTION_BATCH")
+         && (subject != "GPIO_STATUS") && (subject != "GPIO_QUERY")
+         && (subject != "GPIO_HISTORY")) {
         zsys_warning ("%s: Received unexpected subject '%s'", self->name, subject.c_str());
         zmsg_t *reply = zmsg_new ();
         zmsg_addstr(reply, "ERROR");
         zmsg_addstr (reply, "BAD_COMMAND");
-        mlm_client_sendto (self->mlm, mlm_client_sender (self->mlm), subject.c_str(), NULL, 1000, &reply);
+        mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 1000, &reply);
         zmsg_destroy (&reply);
         return;
     }
@@ -399,29 +2495,32 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
             zmsg_addstr (reply, zuuid);
             char *sensor_name = zmsg_popstr (message);
             char *action_name = zmsg_popstr (message);
+            // Optional duration (or blink period) and blink count
+            char *action_arg = zmsg_popstr (message);
+            char *action_count = zmsg_popstr (message);
             my_zsys_debug (self->verbose, "GPO_INTERACTION: do '%s' on '%s'",
                 action_name, sensor_name);
-            // Get the GPO entry for details
+            // Get the GPO entry for details, by asset or ext name
             pthread_mutex_lock (&gpx_list_mutex);
             zlistx_t *gpx_list = get_gpx_list(self->verbose);
             if (gpx_list) {
-                int sensors_count = zlistx_size (gpx_list);
-                _gpx_info_t *gpx_info = (_gpx_info_t *)zlistx_first (gpx_list);
-                gpx_info = (_gpx_info_t *)zlistx_next (gpx_list);
-                for (int cur_sensor_num = 0; cur_sensor_num < sensors_count; cur_sensor_num++) {
-                    // Check both asset and ext name
-                    if (gpx_info && gpx_info->asset_name && gpx_info->ext_name) {
-                        my_zsys_debug (self->verbose, "GPO_INTERACTION: checking sensor %s/%s",
-                            gpx_info->asset_name, gpx_info->ext_name);
-                        if ( streq(gpx_info->asset_name, sensor_name)
-                            || streq(gpx_info->ext_name, sensor_name) ) {
-                                break;
-                        }
+                _gpx_info_t *gpx_info = sensor_name? get_gpx_info (sensor_name) : NULL;
+                if ( (gpx_info) && (gpx_info->gpx_direction == GPIO_DIRECTION_OUT) && action_name
+                    && (action_arg || streq (action_name, "pulse") || streq (action_name, "blink")
+                        || streq (action_name, "cancel")) ) {
+                    // Timed action, scheduled on our loop
+                    const char *reason = s_gpo_timed_interaction (self, gpx_info,
+                        action_name, action_arg, action_count);
+                    if (reason) {
+                        zsys_error ("GPO_INTERACTION: can't %s '%s': %s", action_name, sensor_name, reason);
+                        zmsg_addstr (reply, "ERROR");
+                        zmsg_addstr (reply, reason);
                     }
-                    gpx_info = (_gpx_info_t *)zlistx_next (gpx_list);
+                    else
+                        zmsg_addstr (reply, "OK");
                 }
-                if ( (gpx_info) && (gpx_info->gpx_direction == GPIO_DIRECTION_OUT)
-                    && ((streq(gpx_info->asset_name, sensor_name)) || streq(gpx_info->ext_name, sensor_name)) ) {
+                else
+                if ( (gpx_info) && (gpx_info->gpx_direction == GPIO_DIRECTION_OUT) && action_name ) {
                     int status_value = libgpio_get_status_value (action_name);
                     int current_state = gpx_info->current_state;
 
@@ -444,6 +2543,7 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
                                 zmsg_addstr (reply, "OK");
                                 // Update the GPO state
                                 gpx_info->current_state = status_value;
+                                s_track_change (self, gpx_info);
 
                                 gpo_state_t *last_state = (gpo_state_t *) zhashx_lookup (self->gpo_states, gpx_info->asset_name);
                                 if (last_state == NULL) {
@@ -453,6 +2553,8 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
                                 }
                                 else {
                                     my_zsys_debug (self->verbose, "last action = %d on port ", last_state->last_action, last_state->gpo_number);
+                                    // An explicit action overrides any timed one
+                                    s_timed_end (self, gpx_info->asset_name, last_state, false);
                                     last_state->last_action = status_value;
                                     last_state->in_alert = 1;
                                 }
@@ -471,13 +2573,15 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
                     zmsg_addstr (reply, "ASSET_NOT_FOUND");
                 }
                 // send the reply
-                int rv = mlm_client_sendto (self->mlm, mlm_client_sender (self->mlm), subject.c_str(), NULL, 5000, &reply);
+                int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
                 if (rv == -1)
                     zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
             }
             pthread_mutex_unlock (&gpx_list_mutex);
             zstr_free(&sensor_name);
             zstr_free(&action_name);
+            zstr_free (&action_arg);
+            zstr_free (&action_count);
             zstr_free (&zuuid);
         }
         else if ( (subject == "GPIO_MANIFEST") || (subject == "GPIO_MANIFEST_SUMMARY") ) {
@@ -585,7 +2689,7 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
                 zdir_destroy (&dir);
             }
             // send the reply
-            int rv = mlm_client_sendto (self->mlm, mlm_client_sender (self->mlm), subject.c_str(), NULL, 5000, &reply);
+            int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
             if (rv == -1)
                 zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
             zstr_free (&zuuid);
@@ -666,7 +2770,7 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
                 zmsg_addstr (reply, "MISSING_PARAM");
             }
             // send the reply
-            int rv = mlm_client_sendto (self->mlm, mlm_client_sender (self->mlm), subject.c_str(), NULL, 5000, &reply);
+            int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
             if (rv == -1)
                 zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
 
@@ -726,6 +2830,7 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
                     state->gpo_number = num_gpo_number;
                     state->last_action = num_default_state;
                     state->in_alert = 0;
+                    state->timed_kind = GPO_TIMED_NONE;
                 }
             }
             else {
@@ -752,6 +2857,52 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
             zstr_free (&default_state);
         }
 
+        else if (subject == "GPO_INTERACTION_BATCH") {
+            char *zuuid = zmsg_popstr (message);
+            zmsg_addstr (reply, zuuid);
+            s_gpo_interaction_batch (self, message, reply);
+            int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
+            if (rv == -1)
+                zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
+            zstr_free (&zuuid);
+        }
+        else if (subject == "GPIO_STATS") {
+            char *zuuid = zmsg_popstr (message);
+            zmsg_addstr (reply, zuuid);
+            zmsg_addstr (reply, "OK");
+            s_add_stats (self, reply, true);
+            int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
+            if (rv == -1)
+                zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
+            zstr_free (&zuuid);
+        }
+        else if (subject == "GPIO_HISTORY") {
+            char *zuuid = zmsg_popstr (message);
+            zmsg_addstr (reply, zuuid);
+            s_gpio_history (self, message, reply);
+            int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
+            if (rv == -1)
+                zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
+            zstr_free (&zuuid);
+        }
+        else if (subject == "GPIO_QUERY") {
+            char *zuuid = zmsg_popstr (message);
+            zmsg_addstr (reply, zuuid);
+            s_gpio_query (self, message, reply);
+            int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
+            if (rv == -1)
+                zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
+            zstr_free (&zuuid);
+        }
+        else if (subject == "GPIO_STATUS") {
+            char *zuuid = zmsg_popstr (message);
+            zmsg_addstr (reply, zuuid);
+            s_gpio_status (self, message, reply);
+            int rv = mlm_client_sendto (self->mlm, sender, subject.c_str(), NULL, 5000, &reply);
+            if (rv == -1)
+                zsys_error ("%s:\tgpio: mlm_client_sendto failed", self->name);
+            zstr_free (&zuuid);
+        }
         else if (subject == "GPIO_TEST") {
             ;
         }
@@ -759,6 +2910,101 @@ s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t *message)
     }
 }
 
+//  --------------------------------------------------------------------------
+//  Return the class of a mailbox request, from its subject
+
+static int
+s_mailbox_class (const char *subject)
+{
+    if (streq (subject, "GPO_INTERACTION") || streq (subject, "GPO_INTERACTION_BATCH")
+        || streq (subject, "GPOSTATE"))
+        return MAILBOX_CLASS_CONTROL;
+    if (streq (subject, "GPIO_MANIFEST") || streq (subject, "GPIO_MANIFEST_SUMMARY")
+        || streq (subject, "GPIO_TEMPLATE_ADD"))
+        return MAILBOX_CLASS_BULK;
+    return MAILBOX_CLASS_QUERY;
+}
+
+//  --------------------------------------------------------------------------
+//  Receive all the pending mailbox requests, without waiting, and queue
+//  them according to their class
+
+static void
+s_mailbox_drain (fty_sensor_gpio_server_t *self)
+{
+    while (zsock_events (mlm_client_msgpipe (self->mlm)) & ZMQ_POLLIN) {
+        zmsg_t *message = mlm_client_recv (self->mlm);
+        if (!message)
+            break;
+        if (!streq (mlm_client_command (self->mlm), "MAILBOX DELIVER")) {
+            zmsg_destroy (&message);
+            continue;
+        }
+        mailbox_request_t *request = (mailbox_request_t *) zmalloc (sizeof (mailbox_request_t));
+        request->subject = strdup (mlm_client_subject (self->mlm));
+        request->sender = strdup (mlm_client_sender (self->mlm));
+        request->message = message;
+        request->received = s_clock_ns (CLOCK_MONOTONIC) / 1000;
+        int mailbox_class = s_mailbox_class (request->subject);
+        zlistx_t *queue = self->mailbox_queues [mailbox_class];
+        zlistx_add_end (queue, request);
+        if (zlistx_size (queue) > self->mailbox_depth_max [mailbox_class])
+            self->mailbox_depth_max [mailbox_class] = zlistx_size (queue);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Serve the pending mailbox requests, GPO actions first, then queries,
+//  then manifests and templates. Newly arrived requests are queued between
+//  each request served, so that a GPO action overtakes a burst of manifest
+//  requests instead of waiting behind it.
+
+static void
+s_mailbox_dispatch (fty_sensor_gpio_server_t *self)
+{
+    s_mailbox_drain (self);
+    int served = 0;
+    while (!zsys_interrupted) {
+        // Give the timers a chance under a flood of requests, the next pass
+        // serving the requests left
+        if ((self->mailbox_budget > 0) && (served >= self->mailbox_budget)) {
+            my_zsys_debug (self->verbose, "%s: mailbox budget of %d requests reached",
+                self->name, self->mailbox_budget);
+            break;
+        }
+        int mailbox_class = 0;
+        while ((mailbox_class < MAILBOX_CLASSES) && (zlistx_size (self->mailbox_queues [mailbox_class]) == 0))
+            mailbox_class++;
+        if (mailbox_class == MAILBOX_CLASSES)
+            break;
+
+        mailbox_request_t *request = (mailbox_request_t *) zlistx_detach (self->mailbox_queues [mailbox_class], NULL);
+        int64_t latency = s_clock_ns (CLOCK_MONOTONIC) / 1000 - request->received;
+        self->mailbox_served [mailbox_class]++;
+        gpio_latency_record (self->mailbox_latency [mailbox_class], latency);
+        my_zsys_debug (self->verbose, "%s: serving '%s' (%s) after %" PRIi64 " us", self->name,
+            request->subject, mailbox_class_names [mailbox_class], latency);
+
+        s_handle_mailbox (self, request->subject, request->sender, request->message);
+        mailbox_request_free ((void **) &request);
+        served++;
+        s_mailbox_drain (self);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Are there mailbox requests queued, left by the budget of the last pass?
+
+static bool
+s_mailbox_pending (fty_sensor_gpio_server_t *self)
+{
+    for (int i = 0; i < MAILBOX_CLASSES; i++) {
+        if (zlistx_size (self->mailbox_queues [i]) > 0)
+            return true;
+    }
+    return false;
+}
+
 //  --------------------------------------------------------------------------
 //  Create a new fty_sensor_gpio_server
 
@@ -780,6 +3026,61 @@ fty_sensor_gpio_server_new (const char* name)
     assert (self->gpio_lib);
     self->gpo_states   = zhashx_new ();
     zhashx_set_destructor (self->gpo_states, free_fn);
+    self->poll_interval = 0;
+    self->next_poll     = 0;
+    self->poll_cycles   = 0;
+    self->poll_overruns = 0;
+    self->poll_dropped  = 0;
+    self->poll_deferred = 0;
+    self->tick_budget   = DEFAULT_TICK_BUDGET;
+    self->mailbox_budget = DEFAULT_MAILBOX_BUDGET;
+    self->phase_count   = 0;
+    self->flap_suppressed = 0;
+    self->rules         = zlistx_new ();
+    zlistx_set_destructor (self->rules, gpio_rule_free);
+    self->rule_actions  = 0;
+    self->rule_latency  = 0;
+    self->timed_next    = 0;
+    self->timed_steps   = 0;
+    self->abnormal_refresh = 0;
+    self->abnormal_published = 0;
+    for (int i = 0; i < MAILBOX_CLASSES; i++) {
+        self->mailbox_queues [i] = zlistx_new ();
+        zlistx_set_destructor (self->mailbox_queues [i], mailbox_request_free);
+        self->mailbox_depth_max [i] = 0;
+        self->mailbox_served [i] = 0;
+    }
+    self->watches       = zhashx_new ();
+    zhashx_set_destructor (self->watches, gpi_watch_free);
+    self->releasing     = zlistx_new ();
+    zlistx_set_destructor (self->releasing, gpi_watch_free);
+    self->pulses        = 0;
+    self->edge_watcher  = zactor_new (s_edge_watcher, self->gpio_lib);
+    assert (self->edge_watcher);
+    self->dwell_interval = 0;
+    self->dwell_next    = 0;
+    self->dwell_published = 0;
+    self->propagations = 0;
+    for (int i = 0; i < LATENCY_STAGES; i++)
+        self->latency [i] = gpio_latency_new ();
+    self->poll_duration = gpio_latency_new ();
+    for (int i = 0; i < MAILBOX_CLASSES; i++)
+        self->mailbox_latency [i] = gpio_latency_new ();
+    self->published     = 0;
+    self->publish_failures = 0;
+    self->stats_interval = 0;
+    self->stats_next    = 0;
+    self->prometheus_file = NULL;
+    self->prometheus_interval = DEFAULT_PROMETHEUS_INTERVAL;
+    self->prometheus_next = 0;
+    self->prometheus_written = 0;
+    self->prometheus_failed = 0;
+    self->shm           = NULL;
+    self->alerts        = NULL;
+    self->endpoint      = NULL;
+    self->dwell_restore = zhashx_new ();
+    zhashx_set_destructor (self->dwell_restore, free_fn);
+    self->state_file    = NULL;
     return self;
 }
 
@@ -795,18 +3096,92 @@ fty_sensor_gpio_server_destroy (fty_sensor_gpio_server_t **self_p)
         fty_sensor_gpio_server_t *self = *self_p;
 
         //  Free class properties
+        // Stop the edge watcher first, as it uses the GPIO library
+        zactor_destroy (&self->edge_watcher);
+        gpi_watch_t *watch = (gpi_watch_t *) zhashx_first (self->watches);
+        while (watch) {
+            if (watch->watching)
+                libgpio_unwatch (self->gpio_lib, watch->gpx_number, -1);
+            watch = (gpi_watch_t *) zhashx_next (self->watches);
+        }
+        zhashx_destroy (&self->watches);
+        watch = (gpi_watch_t *) zlistx_first (self->releasing);
+        while (watch) {
+            libgpio_unwatch (self->gpio_lib, watch->gpx_number, -1);
+            watch = (gpi_watch_t *) zlistx_next (self->releasing);
+        }
+        zlistx_destroy (&self->releasing);
+        zhashx_destroy (&self->dwell_restore);
+        zstr_free (&self->state_file);
+        zstr_free (&self->prometheus_file);
+        fty_sensor_gpio_shm_destroy (&self->shm);
+        fty_sensor_gpio_alerts_destroy (&self->alerts);
+        zstr_free (&self->endpoint);
+        for (int i = 0; i < LATENCY_STAGES; i++)
+            gpio_latency_destroy (&self->latency [i]);
+        gpio_latency_destroy (&self->poll_duration);
+        for (int i = 0; i < MAILBOX_CLASSES; i++)
+            gpio_latency_destroy (&self->mailbox_latency [i]);
         libgpio_destroy (&self->gpio_lib);
         zstr_free(&self->name);
         mlm_client_destroy (&self->mlm);
         if (self->template_dir)
             zstr_free(&self->template_dir);
         zhashx_destroy (&self->gpo_states);
+        zlistx_destroy (&self->rules);
+        for (int i = 0; i < MAILBOX_CLASSES; i++)
+            zlistx_destroy (&self->mailbox_queues [i]);
         //  Free object itself
         free (self);
         *self_p = NULL;
     }
 }
 
+//  --------------------------------------------------------------------------
+//  Resume the timed action saved on a state file line, if any: a pulse or a
+//  timed revert which is still running gets its state back until its
+//  deadline, while an expired one is reverted. A blink skips the steps
+//  elapsed while the agent was stopped.
+
+static void
+s_timed_resume (fty_sensor_gpio_server_t *self, const char *asset_name, gpo_state_t *state,
+    const char *line, int last_action)
+{
+    int kind = GPO_TIMED_NONE, restore_state, period, remaining;
+    int64_t deadline;
+    if ((sscanf (line, "%*s %*d %*d %*d %d %d %d %d %" SCNi64, &kind, &restore_state,
+        &period, &remaining, &deadline) != 5) || (kind == GPO_TIMED_NONE) || (period <= 0))
+        return;
+
+    int64_t late = zclock_time () - deadline;
+    int value = last_action;
+    if (late >= 0) {
+        int64_t steps = late / period + 1;
+        if ((remaining >= 0) && (steps > remaining)) {
+            // Expired while we were stopped
+            zsys_info ("%s: timed action on GPO '%s' expired, reverting it", self->name, asset_name);
+            if (state->last_action != restore_state)
+                s_timed_write (self, asset_name, state, restore_state, false);
+            return;
+        }
+        if (steps % 2)
+            value = (value == GPIO_STATE_OPENED)? GPIO_STATE_CLOSED : GPIO_STATE_OPENED;
+        if (remaining > 0)
+            remaining -= steps;
+        late -= (steps - 1) * period;
+        deadline = zclock_time () + period - late;
+    }
+    zsys_info ("%s: resuming timed action on GPO '%s'", self->name, asset_name);
+    if ((state->last_action != value) && (s_timed_write (self, asset_name, state, value, false) != 0))
+        return;
+    state->timed_kind = kind;
+    state->restore_state = restore_state;
+    state->period = period;
+    state->remaining = remaining;
+    state->deadline = zclock_mono () + (deadline - zclock_time ());
+    state->in_alert = 1;
+}
+
 static void
 s_load_state_file (fty_sensor_gpio_server_t *self, const char *state_file)
 {
@@ -823,8 +3198,21 @@ s_load_state_file (fty_sensor_gpio_server_t *self, const char *state_file)
     int gpo_number = -1;
     int default_state = -1;
     int last_action = -1;
-    // line read successfully - all 4 items are there
-    while (fscanf (f_state, "%14s %3d %d %d", asset_name, &gpo_number, &default_state, &last_action) == 4) {
+    char line[256];
+    while (fgets (line, sizeof (line), f_state)) {
+        // Times in state of a sensor, applied once it is monitored
+        char sensor_name[256];
+        int64_t closed_time, opened_time;
+        if (sscanf (line, "dwell %255s %" SCNi64 " %" SCNi64, sensor_name, &closed_time, &opened_time) == 3) {
+            int64_t *times = (int64_t *) zmalloc (2 * sizeof (int64_t));
+            times [GPIO_STATE_CLOSED] = closed_time;
+            times [GPIO_STATE_OPENED] = opened_time;
+            zhashx_update (self->dwell_restore, sensor_name, times);
+            continue;
+        }
+        // GPO line read successfully - at least the first 4 items are there
+        if (sscanf (line, "%14s %3d %d %d", asset_name, &gpo_number, &default_state, &last_action) != 4)
+            break;
         // existing GPO entry came from fty-sensor-gpio-assets, which takes precendence
         gpo_state_t *state = (gpo_state_t *) zhashx_lookup (self->gpo_states, (void *)asset_name);
 
@@ -857,24 +3245,76 @@ s_load_state_file (fty_sensor_gpio_server_t *self, const char *state_file)
                 char *asset_name_key = strdup (asset_name);
                 zhashx_update (self->gpo_states, (void *) asset_name_key, (void *) state);
             }
+        // Resume or revert the timed action saved, whether the GPO came from
+        // fty-sensor-gpio-assets or from the file
+        pthread_mutex_lock (&gpx_list_mutex);
+        s_timed_resume (self, asset_name, state, line, last_action);
+        pthread_mutex_unlock (&gpx_list_mutex);
     }
+    s_timed_reschedule (self);
 
     fclose (f_state);
 }
 
+//  --------------------------------------------------------------------------
+//  Save the GPO states, and the times in state of the sensors
+//  (gpx_list_mutex held by the caller)
+
 static void
 s_save_state_file (fty_sensor_gpio_server_t *self, const char *state_file)
 {
-    FILE *f_state = fopen (state_file, "w");
+    if (!state_file)
+        return;
+    // Written aside then renamed, so that a crash or a power loss while
+    // writing leaves the previous state file intact
+    size_t tmp_length = strlen (state_file) + 5;
+    char *tmp_file = (char *) zmalloc (tmp_length);
+    assert (tmp_file);
+    snprintf (tmp_file, tmp_length, "%s.tmp", state_file);
+    FILE *f_state = fopen (tmp_file, "w");
+    if (!f_state) {
+        zsys_error ("%s: could not save state file %s", self->name, state_file);
+        zstr_free (&tmp_file);
+        return;
+    }
 
+    int64_t mono = zclock_mono ();
+    int64_t wall = zclock_time ();
     gpo_state_t *state = (gpo_state_t *) zhashx_first (self->gpo_states);
     while (state != NULL) {
         const char *asset_name = (const char *) zhashx_cursor (self->gpo_states);
-        fprintf (f_state, "%s %d %d %d\n", asset_name, state->gpo_number, state->default_state, state->last_action);
+        fprintf (f_state, "%s %d %d %d", asset_name, state->gpo_number, state->default_state, state->last_action);
+        // Timed action in progress, with its wall clock deadline
+        if (state->timed_kind != GPO_TIMED_NONE)
+            fprintf (f_state, " %d %d %d %d %" PRIi64, state->timed_kind, state->restore_state,
+                state->period, state->remaining, wall + (state->deadline - mono));
+        fprintf (f_state, "\n");
         state = (gpo_state_t *) zhashx_next (self->gpo_states);
     }
+    // Times in state, after the GPO states, as older versions stop at the
+    // first line which is not a GPO state
+    zlistx_t *gpx_list = get_gpx_list (self->verbose);
+    _gpx_info_t *gpx_info = gpx_list? (_gpx_info_t *) zlistx_first (gpx_list) : NULL;
+    while (gpx_info) {
+        if (gpx_info->state_time [GPIO_STATE_CLOSED] || gpx_info->state_time [GPIO_STATE_OPENED])
+            fprintf (f_state, "dwell %s %" PRIi64 " %" PRIi64 "\n", gpx_info->asset_name,
+                gpx_info->state_time [GPIO_STATE_CLOSED], gpx_info->state_time [GPIO_STATE_OPENED]);
+        gpx_info = (_gpx_info_t *) zlistx_next (gpx_list);
+    }
+    // Including those of the sensors which are not monitored yet
+    int64_t *times = (int64_t *) zhashx_first (self->dwell_restore);
+    while (times) {
+        fprintf (f_state, "dwell %s %" PRIi64 " %" PRIi64 "\n", (const char *) zhashx_cursor (self->dwell_restore),
+            times [GPIO_STATE_CLOSED], times [GPIO_STATE_OPENED]);
+        times = (int64_t *) zhashx_next (self->dwell_restore);
+    }
 
-    fclose (f_state);
+    bool written = !ferror (f_state) && (fflush (f_state) == 0) && (fsync (fileno (f_state)) == 0);
+    if ((fclose (f_state) != 0) || !written || (rename (tmp_file, state_file) != 0)) {
+        zsys_error ("%s: could not save state file %s", self->name, state_file);
+        unlink (tmp_file);
+    }
+    zstr_free (&tmp_file);
 }
 
 //  --------------------------------------------------------------------------
@@ -989,18 +3429,37 @@ request_capabilities_info(fty_sensor_gpio_server_t *self, const char *type)
     while (value) {
         // GPx pin name
         // drop the port descriptor because zconfig is stupid and
-        // doesn't allow number as a key
-        const std::string port_str (value+1, 1);
-        // convert to int
-        int port_num = (int) strtol (port_str.c_str (), NULL, 10);
+        // doesn't allow number as a key, and convert the whole
+        // remaining string to int (ports can have several digits)
+        char *end = NULL;
+        int port_num = -1;
+        if (value[0] != '\0')
+            port_num = (int) strtol (value+1, &end, 10);
+        bool port_valid = (end && (end != value+1) && (*end == '\0'));
+        if (!port_valid)
+            zsys_error ("%s: invalid %s port name '%s' in mapping, skipping", self->name, type, value);
         zstr_free (&value);
         // GPx pin number
         value = zmsg_popstr (reply);
-        int pin_num = (int) strtol (value, NULL, 10);
-        if (streq (type, "gpi"))
-            libgpio_add_gpi_mapping (self->gpio_lib, port_num, pin_num);
-        else
-            libgpio_add_gpo_mapping (self->gpio_lib, port_num, pin_num);
+        if (!value) {
+            zsys_error ("%s: missing pin number for %s port %d in mapping", self->name, type, port_num);
+            break;
+        }
+        int pin_num = (int) strtol (value, &end, 10);
+        if (port_valid && ((end == value) || (*end != '\0'))) {
+            zsys_error ("%s: invalid pin number '%s' for %s port %d in mapping, skipping",
+                self->name, value, type, port_num);
+            port_valid = false;
+        }
+        if (port_valid) {
+            // libgpio validates the port against gpi_count / gpo_count
+            int rv = streq (type, "gpi")?
+                libgpio_add_gpi_mapping (self->gpio_lib, port_num, pin_num) :
+                libgpio_add_gpo_mapping (self->gpio_lib, port_num, pin_num);
+            if (rv != 0)
+                zsys_warning ("%s: refused %s mapping of port p%d to pin %d, skipping",
+                    self->name, type, port_num, pin_num);
+        }
         zstr_free (&value);
         // Pop the next pin name
         value = zmsg_popstr (reply);
@@ -1020,12 +3479,11 @@ fty_sensor_gpio_server (zsock_t *pipe, void *args)
         zsys_error ("Adress for fty-sensor-gpio actor is NULL");
         return;
     }
-    char *state_file_path = NULL;
 
     fty_sensor_gpio_server_t *self = fty_sensor_gpio_server_new(name);
     assert (self);
 
-    zpoller_t *poller = zpoller_new (pipe, mlm_client_msgpipe (self->mlm), NULL);
+    zpoller_t *poller = zpoller_new (pipe, mlm_client_msgpipe (self->mlm), self->edge_watcher, NULL);
     assert (poller);
 
     zsock_signal (pipe, 0);
@@ -1033,12 +3491,19 @@ fty_sensor_gpio_server (zsock_t *pipe, void *args)
 
     while (!zsys_interrupted)
     {
-        void *which = zpoller_wait (poller, TIMEOUT_MS);
+        // Don't wait while mailbox requests are left queued
+        void *which = zpoller_wait (poller, s_mailbox_pending (self)? 0 : s_poll_timeout (self));
         if (which == NULL) {
             if (zpoller_terminated (poller) || zsys_interrupted) {
                 break;
             }
         }
+        if ((self->timed_next > 0) && (zclock_mono () >= self->timed_next))
+            s_timed_run (self);
+        if ((self->poll_interval > 0) && (zclock_mono () >= self->next_poll))
+            s_poll_tick (self);
+        if ((which != mlm_client_msgpipe (self->mlm)) && s_mailbox_pending (self))
+            s_mailbox_dispatch (self);
         if (which == pipe) {
             zmsg_t *message = zmsg_recv (pipe);
             char *cmd = zmsg_popstr (message);
@@ -1058,7 +3523,8 @@ fty_sensor_gpio_server (zsock_t *pipe, void *args)
                     if (r == -1)
                         zsys_error ("%s:\tConnection to endpoint '%s' failed", self->name, endpoint);
                     my_zsys_debug(self->verbose, "fty-gpio-sensor-server: CONNECT %s/%s", endpoint, self->name);
-                    zstr_free (&endpoint);
+                    zstr_free (&self->endpoint);
+                    self->endpoint = endpoint;
                 }
                 else if (streq (cmd, "PRODUCER")) {
                     char *stream = zmsg_popstr (message);
@@ -1087,7 +3553,60 @@ fty_sensor_gpio_server (zsock_t *pipe, void *args)
                     my_zsys_debug (self->verbose, "fty_sensor_gpio: TEST=true");
                 }
                 else if (streq (cmd, "UPDATE")) {
-                    s_check_gpio_status(self);
+                    // Check all sensors, merging their pending scheduled
+                    // ticks with this check
+                    s_check_gpio_status(self, true);
+                }
+                else if (streq (cmd, "RULE")) {
+                    // RULE/name/gpi/gpi_state/delay/gpo/gpo_state/revert
+                    gpio_rule_t *rule = (gpio_rule_t *) zmalloc (sizeof (gpio_rule_t));
+                    rule->name = zmsg_popstr (message);
+                    rule->gpi = zmsg_popstr (message);
+                    char *gpi_state = zmsg_popstr (message);
+                    char *delay = zmsg_popstr (message);
+                    rule->gpo = zmsg_popstr (message);
+                    char *gpo_state = zmsg_popstr (message);
+                    char *revert = zmsg_popstr (message);
+                    rule->gpi_state = gpi_state? libgpio_get_status_value (gpi_state) : GPIO_STATE_UNKNOWN;
+                    rule->delay = delay? atoi (delay) : 0;
+                    rule->gpo_state = gpo_state? libgpio_get_status_value (gpo_state) : GPIO_STATE_UNKNOWN;
+                    rule->revert = revert && streq (revert, "true");
+                    if (!rule->name || !rule->gpi || !rule->gpo
+                        || (rule->gpi_state == GPIO_STATE_UNKNOWN) || (rule->gpo_state == GPIO_STATE_UNKNOWN)) {
+                        zsys_error ("%s: invalid automation rule '%s', ignoring", self->name,
+                            rule->name? rule->name : "");
+                        gpio_rule_free ((void **) &rule);
+                    }
+                    else {
+                        my_zsys_debug (self->verbose, "fty_sensor_gpio: RULE %s: %s %s -> %s %s",
+                            rule->name, rule->gpi, gpi_state, rule->gpo, gpo_state);
+                        zlistx_add_end (self->rules, rule);
+                    }
+                    zstr_free (&gpi_state);
+                    zstr_free (&delay);
+                    zstr_free (&gpo_state);
+                    zstr_free (&revert);
+                }
+                else if (streq (cmd, "TICK_BUDGET")) {
+                    char *budget = zmsg_popstr (message);
+                    self->tick_budget = budget? atoi (budget) : 0;
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: TICK_BUDGET=%d", self->tick_budget);
+                    zstr_free (&budget);
+                }
+                else if (streq (cmd, "MAILBOX_BUDGET")) {
+                    char *budget = zmsg_popstr (message);
+                    self->mailbox_budget = budget? atoi (budget) : 0;
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: MAILBOX_BUDGET=%d", self->mailbox_budget);
+                    zstr_free (&budget);
+                }
+                else if (streq (cmd, "POLL_INTERVAL")) {
+                    char *interval = zmsg_popstr (message);
+                    self->poll_interval = interval? atoi (interval) : 0;
+                    if (self->poll_interval < 0)
+                        self->poll_interval = 0;
+                    self->next_poll = zclock_mono () + self->poll_interval;
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: POLL_INTERVAL=%d", self->poll_interval);
+                    zstr_free (&interval);
                 }
                 else if (streq (cmd, "TEMPLATE_DIR")) {
                     self->template_dir = zmsg_popstr (message);
@@ -1097,16 +3616,114 @@ fty_sensor_gpio_server (zsock_t *pipe, void *args)
                     // Request our config
                     int rvi = request_capabilities_info(self, "gpi");
                     int rvo = request_capabilities_info(self, "gpo");
-                    // We can now stop the reschedule loop
+                    // Notify the caller, so that it can enable the assets
+                    // actor or schedule a retry
                     if (!rvi && !rvo) {
                         my_zsys_debug (self->verbose, "HW_CAP request succeeded");
                         hw_cap_inited = true;
+                        zstr_sendx (pipe, "HW_CAP", "OK", NULL);
                     }
+                    else
+                        zstr_sendx (pipe, "HW_CAP", "ERROR", NULL);
+                }
+                else if (streq (cmd, "PULSES")) {
+                    // PULSES/asset/count[/mono ns/time ns], as reported by
+                    // the edge watcher
+                    s_count_pulses (self, message);
                 }
                 else if (streq (cmd, "STATEFILE")) {
                     char *state_file = zmsg_popstr (message);
                     s_load_state_file (self, state_file);
-                    state_file_path = state_file;
+                    zstr_free (&self->state_file);
+                    self->state_file = state_file;
+                }
+                else if (streq (cmd, "ALERTS")) {
+                    // Publish the alerts on state transitions, with a
+                    // dedicated client producing on _ALERTS_SYS
+                    char *active_count = zmsg_popstr (message);
+                    char *resolve_count = zmsg_popstr (message);
+                    if (!self->alerts && self->endpoint) {
+                        std::string alerts_name = std::string (self->name) + "-alerts";
+                        self->alerts = fty_sensor_gpio_alerts_new (alerts_name.c_str ());
+                        fty_sensor_gpio_alerts_set_verbose (self->alerts, self->verbose);
+                        if (fty_sensor_gpio_alerts_connect (self->alerts, self->endpoint) != 0)
+                            fty_sensor_gpio_alerts_destroy (&self->alerts);
+                    }
+                    if (self->alerts)
+                        fty_sensor_gpio_alerts_set_hysteresis (self->alerts,
+                            active_count? atoi (active_count) : 1, resolve_count? atoi (resolve_count) : 1);
+                    else
+                        zsys_error ("%s: could not enable the alerts, CONNECT first", self->name);
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: ALERTS=%s/%s",
+                        active_count? active_count : "1", resolve_count? resolve_count : "1");
+                    zstr_free (&active_count);
+                    zstr_free (&resolve_count);
+                }
+                else if (streq (cmd, "SHM")) {
+                    // An empty path disables the shared memory table
+                    char *shm_file = zmsg_popstr (message);
+                    fty_sensor_gpio_shm_destroy (&self->shm);
+                    if (shm_file && !streq (shm_file, "")) {
+                        self->shm = fty_sensor_gpio_shm_new (shm_file, DEFAULT_SHM_CAPACITY);
+                        if (!self->shm)
+                            zsys_error ("%s: could not create the shared memory table %s", self->name, shm_file);
+                    }
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: SHM=%s", shm_file? shm_file : "");
+                    zstr_free (&shm_file);
+                }
+                else if (streq (cmd, "PROMETHEUS_FILE")) {
+                    char *prometheus_file = zmsg_popstr (message);
+                    zstr_free (&self->prometheus_file);
+                    // An empty path disables the Prometheus text file
+                    if (prometheus_file && !streq (prometheus_file, ""))
+                        self->prometheus_file = prometheus_file;
+                    else
+                        zstr_free (&prometheus_file);
+                    self->prometheus_next = 0;
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: PROMETHEUS_FILE=%s",
+                        self->prometheus_file? self->prometheus_file : "");
+                }
+                else if (streq (cmd, "PROMETHEUS_INTERVAL")) {
+                    char *interval = zmsg_popstr (message);
+                    self->prometheus_interval = interval? atoi (interval) : 0;
+                    self->prometheus_next = 0;
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: PROMETHEUS_INTERVAL=%d", self->prometheus_interval);
+                    zstr_free (&interval);
+                }
+                else if (streq (cmd, "GPIO_RECORD")) {
+                    // An empty path stops the recording
+                    char *trace_file = zmsg_popstr (message);
+                    bool enable = trace_file && !streq (trace_file, "");
+                    if (libgpio_record (self->gpio_lib, enable? trace_file : NULL) != 0)
+                        zsys_error ("%s: could not record the GPIO trace %s", self->name, trace_file);
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: GPIO_RECORD=%s", enable? trace_file : "");
+                    zstr_free (&trace_file);
+                }
+                else if (streq (cmd, "GPIO_REPLAY")) {
+                    // An empty path stops the replay
+                    char *trace_file = zmsg_popstr (message);
+                    char *speed = zmsg_popstr (message);
+                    bool enable = trace_file && !streq (trace_file, "");
+                    if (libgpio_replay (self->gpio_lib, enable? trace_file : NULL, speed? atof (speed) : 1) != 0)
+                        zsys_error ("%s: could not replay the GPIO trace %s", self->name, trace_file);
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: GPIO_REPLAY=%s at speed %s",
+                        enable? trace_file : "", speed? speed : "1");
+                    zstr_free (&trace_file);
+                    zstr_free (&speed);
+                }
+                else if (streq (cmd, "STATS_INTERVAL")) {
+                    char *interval = zmsg_popstr (message);
+                    self->stats_interval = interval? atoi (interval) : 0;
+                    self->stats_next = zclock_mono () + self->stats_interval;
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: STATS_INTERVAL=%d", self->stats_interval);
+                    zstr_free (&interval);
+                }
+                else if (streq (cmd, "DWELL_INTERVAL")) {
+                    char *interval = zmsg_popstr (message);
+                    self->dwell_interval = interval? atoi (interval) : 0;
+                    self->dwell_next = zclock_mono () + self->dwell_interval;
+                    my_zsys_debug (self->verbose, "fty_sensor_gpio: DWELL_INTERVAL=%d", self->dwell_interval);
+                    zstr_free (&interval);
                 }
                 else {
                     zsys_warning ("%s:\tUnknown API command=%s, ignoring", __func__, cmd);
@@ -1116,18 +3733,26 @@ fty_sensor_gpio_server (zsock_t *pipe, void *args)
             zmsg_destroy (&message);
         }
         else if (which == mlm_client_msgpipe (self->mlm)) {
-            zmsg_t *message = mlm_client_recv (self->mlm);
-            if (streq (mlm_client_command (self->mlm), "MAILBOX DELIVER")) {
-                // someone is addressing us directly
-                s_handle_mailbox(self, message);
-            }
+            // someone is addressing us directly
+            s_mailbox_dispatch (self);
+        }
+        else if (which == self->edge_watcher) {
+            zmsg_t *message = zmsg_recv (self->edge_watcher);
+            char *cmd = zmsg_popstr (message);
+            if (cmd && streq (cmd, "PULSES"))
+                s_count_pulses (self, message);
+            else if (cmd && streq (cmd, "UNWATCHED"))
+                s_release_watch (self, message);
+            zstr_free (&cmd);
             zmsg_destroy (&message);
         }
     }
 exit:
-    if (!self->test_mode)
-        s_save_state_file (self, state_file_path);
-    zstr_free (&state_file_path);
+    if (!self->test_mode) {
+        pthread_mutex_lock (&gpx_list_mutex);
+        s_save_state_file (self, self->state_file);
+        pthread_mutex_unlock (&gpx_list_mutex);
+    }
     zpoller_destroy (&poller);
     fty_sensor_gpio_server_destroy(&self);
 }
@@ -1175,139 +3800,802 @@ fty_sensor_gpio_server_test (bool verbose)
     if (verbose)
         zstr_send (server, "VERBOSE");
 
-    zactor_t *self = zactor_new (fty_sensor_gpio_server, (void*)FTY_SENSOR_GPIO_AGENT);
-    assert (self);
+    zactor_t *self = zactor_new (fty_sensor_gpio_server, (void*)FTY_SENSOR_GPIO_AGENT);
+    assert (self);
+
+    // Test #0: Process a HW_CAP reply with invalid mappings
+    {
+        fty_sensor_gpio_server_t *hw_cap_self = fty_sensor_gpio_server_new ("hw-cap-test");
+        assert (hw_cap_self);
+        hw_cap_self->test_mode = true;
+        hw_cap_test_reply_gpo = zmsg_new ();
+        zmsg_addstr (hw_cap_test_reply_gpo, "gpo");
+        zmsg_addstr (hw_cap_test_reply_gpo, "5");
+        zmsg_addstr (hw_cap_test_reply_gpo, "488");
+        zmsg_addstr (hw_cap_test_reply_gpo, "0");
+        // A port number beyond single digit must be refused when higher
+        // than the GPO count, and not truncated to 'p1'
+        zmsg_addstr (hw_cap_test_reply_gpo, "p12");
+        zmsg_addstr (hw_cap_test_reply_gpo, "499");
+        // Ports are numbered from 1
+        zmsg_addstr (hw_cap_test_reply_gpo, "p0");
+        zmsg_addstr (hw_cap_test_reply_gpo, "498");
+        zmsg_addstr (hw_cap_test_reply_gpo, "p4");
+        zmsg_addstr (hw_cap_test_reply_gpo, "502");
+        assert (request_capabilities_info (hw_cap_self, "gpo") == 0);
+        // The reply is consumed
+        hw_cap_test_reply_gpo = NULL;
+        assert (libgpio_compute_pin_number (hw_cap_self->gpio_lib, 1, GPIO_DIRECTION_OUT) == 489);
+        assert (libgpio_compute_pin_number (hw_cap_self->gpio_lib, 4, GPIO_DIRECTION_OUT) == 502);
+        assert (libgpio_compute_pin_number (hw_cap_self->gpio_lib, 12, GPIO_DIRECTION_OUT) == 500);
+        fty_sensor_gpio_server_destroy (&hw_cap_self);
+    }
+
+    // Forge a HW_CAP reply message
+    //msg-correlation-id'/OK/'type'/'count'/'base_address'/'offset'/'mapping1'/'mapping_val1'/'mapping2'/'mapping_val2'/ ...
+    hw_cap_test_reply_gpi = zmsg_new ();
+    hw_cap_test_reply_gpo = zmsg_new ();
+    // zuuid_t can be omitted, since it's already been pop'ed
+    // Same for "OK"
+    // GPI
+    // Offset '-1' means GPI '1' address is '488'
+    zmsg_addstr (hw_cap_test_reply_gpi, "gpi");
+    zmsg_addstr (hw_cap_test_reply_gpi, "10");
+    zmsg_addstr (hw_cap_test_reply_gpi, "488");
+    zmsg_addstr (hw_cap_test_reply_gpi, "-1");
+    // GPO
+    // We'll use GPO port '2', so address will be '490'
+    zmsg_addstr (hw_cap_test_reply_gpo, "gpo");
+    zmsg_addstr (hw_cap_test_reply_gpo, "5");
+    zmsg_addstr (hw_cap_test_reply_gpo, "488");
+    zmsg_addstr (hw_cap_test_reply_gpo, "0");
+    zmsg_addstr (hw_cap_test_reply_gpo, "p4");
+    zmsg_addstr (hw_cap_test_reply_gpo, "502");
+    zmsg_addstr (hw_cap_test_reply_gpo, "p5");
+    zmsg_addstr (hw_cap_test_reply_gpo, "503");
+
+    // Configure the server
+    if (verbose)
+        zstr_sendx (self, "VERBOSE", NULL);
+    // TEST *MUST* be set first, before HW_CAP, for HW capabilities
+    zstr_sendx (self, "TEST", NULL);
+    zstr_sendx (self, "CONNECT", endpoint, NULL);
+    zstr_sendx (self, "PRODUCER", FTY_PROTO_STREAM_METRICS_SENSOR, NULL);
+    zstr_sendx (self, "TEMPLATE_DIR", template_dir.c_str(), NULL);
+    zstr_sendx (self, "HW_CAP", NULL);
+    mlm_client_t *mb_client = mlm_client_new ();
+    mlm_client_connect (mb_client, endpoint, 1000, "fty_sensor_gpio_client");
+
+    // Prepare the testbed with 2 assets (1xGPI + 1xGPO)
+    fty_sensor_gpio_assets_t *assets_self = fty_sensor_gpio_assets_new("gpio-assets");
+
+    int rv = add_sensor(assets_self, "create",
+        "Eaton", "sensorgpio-10", "GPIO-Sensor-Door1",
+        "DCS001", "door-contact-sensor",
+        "closed", "1",
+        "GPI", "IPC1", "Rack1", "",
+        "Door has been $status", "WARNING");
+    assert (rv == 0);
+
+    rv = add_sensor(assets_self, "create",
+        "Eaton", "gpo-11", "GPIO-Test-GPO1",
+        "DCS001", "dummy",
+        "closed", "2",
+        "GPO", "IPC1", "Room1", "",
+        "Dummy has been $status", "WARNING");
+    assert (rv == 0);
+
+    // Also create the dummy file for reading the GPI sensor
+    std::string gpi_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio488";
+    zsys_dir_create (gpi_sys_dir.c_str());
+    std::string gpi1_fn = gpi_sys_dir + "/value";
+    int handle = open (gpi1_fn.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0777);
+    assert (handle >= 0);
+    int rc = write (handle, "0", 1);   // 0 == GPIO_STATE_CLOSED
+    assert (rc == 1);
+    close (handle);
+    // and the path for GPO
+    std::string gpo_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio490";
+    zsys_dir_create (gpo_sys_dir.c_str());
+    std::string gpo_mapping_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio503";
+    zsys_dir_create (gpo_mapping_sys_dir.c_str());
+
+    // Acquire the list of monitored sensors
+    pthread_mutex_lock (&gpx_list_mutex);
+    zlistx_t *test_gpx_list = get_gpx_list(verbose);
+    assert (test_gpx_list);
+    int sensors_count = zlistx_size (test_gpx_list);
+    assert (sensors_count == 2);
+    // Test the first sensor
+/*    _gpx_info_t *gpx_info = (_gpx_info_t *)zlistx_first (test_gpx_list);
+    assert (gpx_info);
+    // Modify the current_state
+    gpx_info->current_state = GPIO_STATE_OPENED;
+*/
+    pthread_mutex_unlock (&gpx_list_mutex);
+
+    zmsg_t *msg = zmsg_new ();
+    zmsg_addstr (msg, "sensorgpio-11");
+    zmsg_addstr (msg, "2");
+    zmsg_addstr (msg, "closed");
+    rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPOSTATE", NULL, 5000, &msg);
+    assert ( rv == 0 ); // no response
+
+    // Test #1: Get status for an asset through its published metric
+    {
+        mlm_client_t *metrics_listener = mlm_client_new ();
+        mlm_client_connect (metrics_listener, endpoint, 1000, "fty_sensor_gpio_metrics_listener");
+        mlm_client_set_consumer (metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, ".*");
+
+        // Send an update and check for the generated metric
+        zstr_sendx (self, "UPDATE", endpoint, NULL);
+        zclock_sleep (500);
+
+        // Check the published metric
+        zmsg_t *recv = mlm_client_recv (metrics_listener);
+        assert (recv);
+        fty_proto_t *frecv = fty_proto_decode (&recv);
+        assert (frecv);
+        assert (streq (fty_proto_name (frecv), "IPC1"));
+        assert (streq (fty_proto_type (frecv), "status.GPI1"));
+        assert (streq (fty_proto_aux_string (frecv, "port", NULL), "GPI1"));
+        assert (streq (fty_proto_value (frecv), "closed"));
+        assert (streq (fty_proto_aux_string (frecv, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, NULL), "sensorgpio-10"));
+        // The metric carries the time of the sample, and its age when published
+        const char *sample_time = fty_proto_aux_string (frecv, "sample_time_ns", NULL);
+        const char *sample_age = fty_proto_aux_string (frecv, "sample_age_ns", NULL);
+        assert (sample_time && sample_age);
+        assert ((int64_t) fty_proto_time (frecv) == strtoll (sample_time, NULL, 10) / 1000000000);
+        assert (strtoll (sample_age, NULL, 10) >= 0);
+        assert (strtoll (sample_age, NULL, 10) < 500 * (int64_t) 1000000);
+
+        fty_proto_destroy (&frecv);
+        zmsg_destroy (&recv);
+
+        recv = mlm_client_recv (metrics_listener);
+        assert (recv);
+        frecv = fty_proto_decode (&recv);
+        assert (frecv);
+        assert (streq (fty_proto_name (frecv), "IPC1"));
+        assert (streq (fty_proto_type (frecv), "status.GPO2"));
+        assert (streq (fty_proto_aux_string (frecv, "port", NULL), "GPO2"));
+        assert (streq (fty_proto_value (frecv), "closed"));
+        assert (streq (fty_proto_aux_string (frecv, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, NULL), "gpo-11"));
+        fty_proto_destroy (&frecv);
+        zmsg_destroy (&recv);
+
+        mlm_client_destroy (&metrics_listener);
+    }
+
+    // Test #1b: Check that the internal scheduler publishes metrics without
+    // any explicit UPDATE
+    {
+        mlm_client_t *metrics_listener = mlm_client_new ();
+        mlm_client_connect (metrics_listener, endpoint, 1000, "fty_sensor_gpio_metrics_listener");
+        mlm_client_set_consumer (metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, ".*");
+
+        zstr_sendx (self, "POLL_INTERVAL", "200", NULL);
+        zmsg_t *recv = my_mlm_client_recv (metrics_listener, 2000);
+        assert (recv);
+        zmsg_destroy (&recv);
+        zstr_sendx (self, "POLL_INTERVAL", "0", NULL);
+        zclock_sleep (500);
+
+        mlm_client_destroy (&metrics_listener);
+    }
+
+    // Test #1c: Request GPIO_STATS and check the sampling of the GPI
+    {
+        zmsg_t *msg = zmsg_new ();
+        zuuid_t *zuuid = zuuid_new ();
+        zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+        int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_STATS", NULL, 5000, &msg);
+        assert ( rv == 0 );
+
+        zmsg_t *recv = mlm_client_recv (mb_client);
+        assert (recv);
+        char *recv_str = zmsg_popstr (recv);
+        assert (streq (zuuid_str_canonical (zuuid), recv_str));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert ( streq ( recv_str, "OK") );
+        zstr_free (&recv_str);
+        bool found = false;
+        bool found_mailbox = false;
+        bool found_gpio = false;
+        bool found_percentiles = false;
+        char *key = zmsg_popstr (recv);
+        while (key) {
+            char *value = zmsg_popstr (recv);
+            assert (value);
+            if (streq (key, "sampling.sensorgpio-10.count")) {
+                assert (atoi (value) >= 1);
+                found = true;
+            }
+            if (streq (key, "mailbox.query.served")) {
+                // This very request
+                assert (atoi (value) >= 1);
+                found_mailbox = true;
+            }
+            if (streq (key, "gpio.reads")) {
+                // The GPI has been read at least once
+                assert (atoi (value) >= 1);
+                found_gpio = true;
+            }
+            if (streq (key, "mailbox.query.latency_p99_us")
+                || streq (key, "poll.duration_p99_us")) {
+                assert (atoi (value) >= 0);
+                found_percentiles = true;
+            }
+            zstr_free (&value);
+            zstr_free (&key);
+            key = zmsg_popstr (recv);
+        }
+        assert (found);
+        assert (found_mailbox);
+        assert (found_gpio);
+        assert (found_percentiles);
+        zuuid_destroy (&zuuid);
+        zmsg_destroy (&recv);
+
+        // GPO actions are served ahead of queries, and queries ahead of
+        // manifests and templates
+        assert (s_mailbox_class ("GPO_INTERACTION") == MAILBOX_CLASS_CONTROL);
+        assert (s_mailbox_class ("GPOSTATE") == MAILBOX_CLASS_CONTROL);
+        assert (s_mailbox_class ("GPIO_STATS") == MAILBOX_CLASS_QUERY);
+        assert (s_mailbox_class ("GPIO_MANIFEST") == MAILBOX_CLASS_BULK);
+        assert (s_mailbox_class ("GPIO_TEMPLATE_ADD") == MAILBOX_CLASS_BULK);
+
+        // With a budget of one request per pass, a burst of requests is
+        // still served entirely, over several passes
+        zstr_sendx (self, "MAILBOX_BUDGET", "1", NULL);
+        zuuid_t *zuuids [4];
+        for (int i = 0; i < 4; i++) {
+            zuuids [i] = zuuid_new ();
+            msg = zmsg_new ();
+            zmsg_addstr (msg, zuuid_str_canonical (zuuids [i]));
+            rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_STATS", NULL, 5000, &msg);
+            assert ( rv == 0 );
+        }
+        for (int i = 0; i < 4; i++) {
+            recv = mlm_client_recv (mb_client);
+            assert (recv);
+            recv_str = zmsg_popstr (recv);
+            assert (streq (zuuid_str_canonical (zuuids [i]), recv_str));
+            zstr_free (&recv_str);
+            zmsg_destroy (&recv);
+            zuuid_destroy (&zuuids [i]);
+        }
+        zstr_sendx (self, "MAILBOX_BUDGET", std::to_string (DEFAULT_MAILBOX_BUDGET).c_str (), NULL);
+    }
+
+    // Test #1d: Request GPIO_STATUS for the GPI, by ext name, then for an
+    // unknown sensor
+    {
+        zmsg_t *msg = zmsg_new ();
+        zuuid_t *zuuid = zuuid_new ();
+        zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+        zmsg_addstr (msg, "GPIO-Sensor-Door1");
+        int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_STATUS", NULL, 5000, &msg);
+        assert ( rv == 0 );
+
+        zmsg_t *recv = mlm_client_recv (mb_client);
+        assert (recv);
+        assert (zmsg_size (recv) == 6);
+        char *recv_str = zmsg_popstr (recv);
+        assert (streq (zuuid_str_canonical (zuuid), recv_str));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (recv_str, "OK"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (recv_str, "sensorgpio-10"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (recv_str, "closed"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (atoll (recv_str) > 0);      // last change
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (atoll (recv_str) >= 0);     // sample age
+        zstr_free (&recv_str);
+        zuuid_destroy (&zuuid);
+        zmsg_destroy (&recv);
+
+        msg = zmsg_new ();
+        zuuid = zuuid_new ();
+        zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+        zmsg_addstr (msg, "sensorgpio-99");
+        rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_STATUS", NULL, 5000, &msg);
+        assert ( rv == 0 );
+
+        recv = mlm_client_recv (mb_client);
+        assert (recv);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (zuuid_str_canonical (zuuid), recv_str));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (recv_str, "ERROR"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (recv_str, "ASSET_NOT_FOUND"));
+        zstr_free (&recv_str);
+        zuuid_destroy (&zuuid);
+        zmsg_destroy (&recv);
+
+        // A sensor not read yet is reported in an unknown state
+        _gpx_info_t unread;
+        memset (&unread, 0, sizeof (unread));
+        unread.asset_name = (char *) "sensorgpio-99";
+        unread.current_state = GPIO_STATE_UNKNOWN;
+        zmsg_t *reply = zmsg_new ();
+        s_add_status (reply, &unread, zclock_mono ());
+        recv_str = zmsg_popstr (reply);
+        assert (streq (recv_str, "sensorgpio-99"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (reply);
+        assert (streq (recv_str, "unknown"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (reply);
+        assert (atoll (recv_str) == 0);     // last change
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (reply);
+        assert (atoll (recv_str) == -1);    // sample age
+        zstr_free (&recv_str);
+        zmsg_destroy (&reply);
+    }
 
-    // Forge a HW_CAP reply message
-    //msg-correlation-id'/OK/'type'/'count'/'base_address'/'offset'/'mapping1'/'mapping_val1'/'mapping2'/'mapping_val2'/ ...
-    hw_cap_test_reply_gpi = zmsg_new ();
-    hw_cap_test_reply_gpo = zmsg_new ();
-    // zuuid_t can be omitted, since it's already been pop'ed
-    // Same for "OK"
-    // GPI
-    // Offset '-1' means GPI '1' address is '488'
-    zmsg_addstr (hw_cap_test_reply_gpi, "gpi");
-    zmsg_addstr (hw_cap_test_reply_gpi, "10");
-    zmsg_addstr (hw_cap_test_reply_gpi, "488");
-    zmsg_addstr (hw_cap_test_reply_gpi, "-1");
-    // GPO
-    // We'll use GPO port '2', so address will be '490'
-    zmsg_addstr (hw_cap_test_reply_gpo, "gpo");
-    zmsg_addstr (hw_cap_test_reply_gpo, "5");
-    zmsg_addstr (hw_cap_test_reply_gpo, "488");
-    zmsg_addstr (hw_cap_test_reply_gpo, "0");
-    // FIXME: add some mapping for testing
-    zmsg_addstr (hw_cap_test_reply_gpo, "p4");
-    zmsg_addstr (hw_cap_test_reply_gpo, "502");
-    zmsg_addstr (hw_cap_test_reply_gpo, "p5");
-    zmsg_addstr (hw_cap_test_reply_gpo, "503");
+    // Test #1e: Query the sensors by location, type and state
+    {
+        auto gpio_query = [&](std::vector<const char *> criteria, std::vector<const char *> expected) {
+            zmsg_t *msg = zmsg_new ();
+            zuuid_t *zuuid = zuuid_new ();
+            zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+            for (const char *criterion : criteria)
+                zmsg_addstr (msg, criterion);
+            int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_QUERY", NULL, 5000, &msg);
+            assert ( rv == 0 );
+            zmsg_t *recv = mlm_client_recv (mb_client);
+            assert (recv);
+            char *recv_str = zmsg_popstr (recv);
+            assert (streq (zuuid_str_canonical (zuuid), recv_str));
+            zstr_free (&recv_str);
+            for (const char *expected_str : expected) {
+                recv_str = zmsg_popstr (recv);
+                assert (recv_str && streq (recv_str, expected_str));
+                zstr_free (&recv_str);
+            }
+            assert (zmsg_size (recv) == 0);
+            zuuid_destroy (&zuuid);
+            zmsg_destroy (&recv);
+        };
+        gpio_query ({ "location", "Rack1" }, { "OK", "sensorgpio-10" });
+        gpio_query ({ "location", "Room1", "type", "dummy" }, { "OK", "gpo-11" });
+        gpio_query ({ "location", "Rack1", "state", "closed" }, { "OK", "sensorgpio-10" });
+        gpio_query ({ "location", "Rack1", "state", "open" }, { "OK" });
+        gpio_query ({ "location", "Rack2" }, { "OK" });
+        gpio_query ({ "color", "red" }, { "ERROR", "BAD_COMMAND" });
+    }
 
-    // Configure the server
-    if (verbose)
-        zstr_sendx (self, "VERBOSE", NULL);
-    // TEST *MUST* be set first, before HW_CAP, for HW capabilities
-    zstr_sendx (self, "TEST", NULL);
-    zstr_sendx (self, "CONNECT", endpoint, NULL);
-    zstr_sendx (self, "PRODUCER", FTY_PROTO_STREAM_METRICS_SENSOR, NULL);
-    zstr_sendx (self, "TEMPLATE_DIR", template_dir.c_str(), NULL);
-    zstr_sendx (self, "HW_CAP", NULL);
-    mlm_client_t *mb_client = mlm_client_new ();
-    mlm_client_connect (mb_client, endpoint, 1000, "fty_sensor_gpio_client");
+    // Test #1f: Open the door contact, and check the count of sensors in
+    // abnormal state published for its type and location, then close it
+    {
+        mlm_client_t *metrics_listener = mlm_client_new ();
+        mlm_client_connect (metrics_listener, endpoint, 1000, "fty_sensor_gpio_metrics_listener");
+        mlm_client_set_consumer (metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "abnormal_count.*");
+
+        const char *states[] = { "1", "0" };  // opened, then closed again
+        for (int i = 0; i < 2; i++) {
+            int handle = open (gpi1_fn.c_str(), O_WRONLY | O_TRUNC, 0);
+            assert (handle >= 0);
+            int rc = write (handle, states [i], 1);
+            assert (rc == 1);
+            close (handle);
+            zstr_sendx (self, "UPDATE", NULL);
+
+            zmsg_t *recv = mlm_client_recv (metrics_listener);
+            assert (recv);
+            fty_proto_t *frecv = fty_proto_decode (&recv);
+            assert (frecv);
+            assert (streq (fty_proto_name (frecv), "Rack1"));
+            assert (streq (fty_proto_type (frecv), "abnormal_count.door-contact-sensor"));
+            assert (streq (fty_proto_value (frecv), (i == 0)? "1" : "0"));
+            fty_proto_destroy (&frecv);
+        }
+        mlm_client_destroy (&metrics_listener);
 
-    // Prepare the testbed with 2 assets (1xGPI + 1xGPO)
-    fty_sensor_gpio_assets_t *assets_self = fty_sensor_gpio_assets_new("gpio-assets");
+        // Both changes have been timed, from their sample to their
+        // publication
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addstr (msg, "latency");
+        int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_STATS", NULL, 5000, &msg);
+        assert ( rv == 0 );
+        zmsg_t *reply = mlm_client_recv (mb_client);
+        assert (reply);
+        char *recv_str = zmsg_popstr (reply);
+        assert (streq (recv_str, "latency"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (reply);
+        assert (streq (recv_str, "OK"));
+        zstr_free (&recv_str);
+        int64_t total[3] = { -1, -1, -1 };  // p50, p99, max
+        const char *total_keys[3] = { "latency.total.p50_us", "latency.total.p99_us", "latency.total.max_us" };
+        uint64_t total_count = 0;
+        char *key = zmsg_popstr (reply);
+        while (key) {
+            char *value = zmsg_popstr (reply);
+            assert (value);
+            if (streq (key, "latency.total.count"))
+                total_count = strtoull (value, NULL, 10);
+            for (int i = 0; i < 3; i++) {
+                if (streq (key, total_keys [i]))
+                    total [i] = strtoll (value, NULL, 10);
+            }
+            zstr_free (&value);
+            zstr_free (&key);
+            key = zmsg_popstr (reply);
+        }
+        zmsg_destroy (&reply);
+        assert (total_count >= 2);
+        assert ((total [0] >= 0) && (total [0] <= total [1]) && (total [1] <= total [2]));
+    }
 
-    int rv = add_sensor(assets_self, "create",
-        "Eaton", "sensorgpio-10", "GPIO-Sensor-Door1",
-        "DCS001", "door-contact-sensor",
-        "closed", "1",
-        "GPI", "IPC1", "Rack1", "",
-        "Door has been $status", "WARNING");
-    assert (rv == 0);
+    // Test #1g: Request the history of the door contact, which has just
+    // been opened and closed again
+    {
+        zmsg_t *msg = zmsg_new ();
+        zuuid_t *zuuid = zuuid_new ();
+        zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+        zmsg_addstr (msg, "sensorgpio-10");
+        int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_HISTORY", NULL, 5000, &msg);
+        assert ( rv == 0 );
 
-    rv = add_sensor(assets_self, "create",
-        "Eaton", "gpo-11", "GPIO-Test-GPO1",
-        "DCS001", "dummy",
-        "closed", "2",
-        "GPO", "IPC1", "Room1", "",
-        "Dummy has been $status", "WARNING");
-    assert (rv == 0);
+        zmsg_t *recv = mlm_client_recv (mb_client);
+        assert (recv);
+        char *recv_str = zmsg_popstr (recv);
+        assert (streq (zuuid_str_canonical (zuuid), recv_str));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (recv_str, "OK"));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert (streq (recv_str, "sensorgpio-10"));
+        zstr_free (&recv_str);
+        // closed (initial checks), opened, closed
+        assert (zmsg_size (recv) == 3 * 4);
+        const char *expected[] = { "closed", "opened", "closed" };
+        int64_t previous_last = 0;
+        for (const char *expected_state : expected) {
+            recv_str = zmsg_popstr (recv);
+            assert (streq (recv_str, expected_state));
+            zstr_free (&recv_str);
+            char *first = zmsg_popstr (recv);
+            char *last = zmsg_popstr (recv);
+            char *samples = zmsg_popstr (recv);
+            assert (atoll (first) >= previous_last);
+            assert (atoll (last) >= atoll (first));
+            assert (atoi (samples) >= 1);
+            previous_last = atoll (last);
+            zstr_free (&first);
+            zstr_free (&last);
+            zstr_free (&samples);
+        }
+        zuuid_destroy (&zuuid);
+        zmsg_destroy (&recv);
+    }
 
-    // Also create the dummy file for reading the GPI sensor
-    std::string gpi_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio488";
-    zsys_dir_create (gpi_sys_dir.c_str());
-    std::string gpi1_fn = gpi_sys_dir + "/value";
-    int handle = open (gpi1_fn.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0777);
-    assert (handle >= 0);
-    int rc = write (handle, "0", 1);   // 0 == GPIO_STATE_CLOSED
-    assert (rc == 1);
-    close (handle);
-    // and the path for GPO
-    std::string gpo_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio490";
-    zsys_dir_create (gpo_sys_dir.c_str());
-    std::string gpo_mapping_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio503";
-    zsys_dir_create (gpo_mapping_sys_dir.c_str());
+    // Test #1h: Declare a pulse counter on GPI 4, count some pulses, and
+    // check its published pulses count and rate
+    {
+        rv = add_sensor(assets_self, "create",
+            "Generic", "sensorgpio-14", "GPIO-Meter1",
+            "PLS001", "pulse-counter",
+            "opened", "4",
+            "GPI", "IPC1", "Room1", "",
+            "Pulse counter", "WARNING");
+        assert (rv == 0);
+        pthread_mutex_lock (&gpx_list_mutex);
+        _gpx_info_t *gpx_info = get_gpx_info ("sensorgpio-14");
+        assert (gpx_info);
+        gpx_info->counter_edge = strdup ("rising");
+        gpx_info->counter = gpio_counter_new (DEFAULT_COUNTER_WINDOW);
+        pthread_mutex_unlock (&gpx_list_mutex);
 
-    // Acquire the list of monitored sensors
-    pthread_mutex_lock (&gpx_list_mutex);
-    zlistx_t *test_gpx_list = get_gpx_list(verbose);
-    assert (test_gpx_list);
-    int sensors_count = zlistx_size (test_gpx_list);
-    assert (sensors_count == 2);
-    // Test the first sensor
-/*    _gpx_info_t *gpx_info = (_gpx_info_t *)zlistx_first (test_gpx_list);
-    assert (gpx_info);
-    // Modify the current_state
-    gpx_info->current_state = GPIO_STATE_OPENED;
-*/
-    pthread_mutex_unlock (&gpx_list_mutex);
+        mlm_client_t *metrics_listener = mlm_client_new ();
+        mlm_client_connect (metrics_listener, endpoint, 1000, "fty_sensor_gpio_metrics_listener");
+        mlm_client_set_consumer (metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "pulse.*");
+
+        // The sysfs edge file can't signal edges in test mode, so report
+        // the pulses as the edge watcher does
+        zstr_sendx (self, "UPDATE", NULL);
+        zstr_sendx (self, "PULSES", "sensorgpio-14", "5", NULL);
+        zstr_sendx (self, "PULSES", "sensorgpio-14", "7",
+            std::to_string (zclock_mono () * 1000000).c_str (), "1500000000123456789", NULL);
+        zstr_sendx (self, "UPDATE", NULL);
+
+        // The first check published no pulse yet
+        const char *expected[] = { "0", "12" };
+        for (int i = 0; i < 4; i++) {
+            zmsg_t *recv = mlm_client_recv (metrics_listener);
+            assert (recv);
+            fty_proto_t *frecv = fty_proto_decode (&recv);
+            assert (frecv);
+            assert (streq (fty_proto_name (frecv), "IPC1"));
+            assert (streq (fty_proto_aux_string (frecv, "port", NULL), "GPI4"));
+            assert (streq (fty_proto_aux_string (frecv, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, NULL), "sensorgpio-14"));
+            // Stamped with the time of the last edge, once there is one
+            if (i >= 2) {
+                assert (streq (fty_proto_aux_string (frecv, "sample_time_ns", ""), "1500000000123456789"));
+                assert (fty_proto_time (frecv) == 1500000000);
+            }
+            if (i % 2 == 0) {
+                assert (streq (fty_proto_type (frecv), "pulses.GPI4"));
+                assert (streq (fty_proto_value (frecv), expected [i / 2]));
+            }
+            else {
+                assert (streq (fty_proto_type (frecv), "pulse_rate.GPI4"));
+                assert (streq (fty_proto_unit (frecv), "Hz"));
+                assert ((i == 1)? (atof (fty_proto_value (frecv)) == 0.0) : (atof (fty_proto_value (frecv)) > 0.0));
+            }
+            fty_proto_destroy (&frecv);
+        }
+        mlm_client_destroy (&metrics_listener);
 
-    zmsg_t *msg = zmsg_new ();
-    zmsg_addstr (msg, "sensorgpio-11");
-    zmsg_addstr (msg, "2");
-    zmsg_addstr (msg, "closed");
-    rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPOSTATE", NULL, 5000, &msg);
-    assert ( rv == 0 ); // no response
+        // The GPI is watched for rising edges
+        std::string edge_fn = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio491/edge";
+        auto gpi_edge = [&]() {
+            int handle = open (edge_fn.c_str(), O_RDONLY, 0);
+            assert (handle >= 0);
+            char readbuf[8] = "";
+            int rc = read (handle, &readbuf[0], 7);
+            assert (rc > 0);
+            close (handle);
+            return std::string (readbuf);
+        };
+        assert (gpi_edge () == "rising");
+
+        // Another edge unwatches the GPI, which is released once the edge
+        // watcher closed its descriptor, and watched again afterwards
+        pthread_mutex_lock (&gpx_list_mutex);
+        gpx_info = get_gpx_info ("sensorgpio-14");
+        assert (gpx_info);
+        free (gpx_info->counter_edge);
+        gpx_info->counter_edge = strdup ("falling");
+        pthread_mutex_unlock (&gpx_list_mutex);
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (200);
+        assert (gpi_edge () == "none");
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (200);
+        assert (gpi_edge () == "falling");
+    }
 
-    // Test #1: Get status for an asset through its published metric
+    // Test #1i: Restore the times in state of the door contact from a state
+    // file, and check their publication
     {
+        std::string state_fn = str_SELFTEST_DIR_RW + "/state";
+        FILE *f_state = fopen (state_fn.c_str (), "w");
+        assert (f_state);
+        fprintf (f_state, "dwell sensorgpio-10 1000 5000\n");
+        fclose (f_state);
+        zstr_sendx (self, "STATEFILE", state_fn.c_str (), NULL);
+
         mlm_client_t *metrics_listener = mlm_client_new ();
         mlm_client_connect (metrics_listener, endpoint, 1000, "fty_sensor_gpio_metrics_listener");
-        mlm_client_set_consumer (metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, ".*");
+        mlm_client_set_consumer (metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "open_time.*|duty_cycle.*");
 
-        // Send an update and check for the generated metric
-        zstr_sendx (self, "UPDATE", endpoint, NULL);
-        zclock_sleep (500);
+        zstr_sendx (self, "DWELL_INTERVAL", "100", NULL);
+        zclock_sleep (200);
+        zstr_sendx (self, "UPDATE", NULL);
 
-        // Check the published metric
+        // Only the door contact is a GPI in level mode
         zmsg_t *recv = mlm_client_recv (metrics_listener);
         assert (recv);
         fty_proto_t *frecv = fty_proto_decode (&recv);
         assert (frecv);
         assert (streq (fty_proto_name (frecv), "IPC1"));
-        assert (streq (fty_proto_type (frecv), "status.GPI1"));
-        assert (streq (fty_proto_aux_string (frecv, "port", NULL), "GPI1"));
-        assert (streq (fty_proto_value (frecv), "closed"));
+        assert (streq (fty_proto_type (frecv), "open_time.GPI1"));
+        assert (streq (fty_proto_unit (frecv), "s"));
         assert (streq (fty_proto_aux_string (frecv, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, NULL), "sensorgpio-10"));
-
+        // Restored, plus the time it has been opened in test #1f
+        assert (atof (fty_proto_value (frecv)) >= 5.0);
+        assert (atof (fty_proto_value (frecv)) < 10.0);
         fty_proto_destroy (&frecv);
-        zmsg_destroy (&recv);
 
         recv = mlm_client_recv (metrics_listener);
         assert (recv);
         frecv = fty_proto_decode (&recv);
         assert (frecv);
-        assert (streq (fty_proto_name (frecv), "IPC1"));
-        assert (streq (fty_proto_type (frecv), "status.GPO2"));
-        assert (streq (fty_proto_aux_string (frecv, "port", NULL), "GPO2"));
-        assert (streq (fty_proto_value (frecv), "closed"));
-        assert (streq (fty_proto_aux_string (frecv, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, NULL), "gpo-11"));
+        assert (streq (fty_proto_type (frecv), "duty_cycle.GPI1"));
+        assert (streq (fty_proto_unit (frecv), "%"));
+        // The restored times are not part of the duty cycle, and the door
+        // has been closed most of the time since the test started
+        assert (atof (fty_proto_value (frecv)) >= 0.0);
+        assert (atof (fty_proto_value (frecv)) < 50.0);
         fty_proto_destroy (&frecv);
-        zmsg_destroy (&recv);
 
+        zstr_sendx (self, "DWELL_INTERVAL", "0", NULL);
+        mlm_client_destroy (&metrics_listener);
+        remove (state_fn.c_str ());
+    }
+
+    // Test #1j: Declare a virtual sensor, opened while the door contact
+    // (referred to by its ext name) is closed, and check that it follows the
+    // changes of the door
+    {
+        rv = add_sensor(assets_self, "create",
+            "Generic", "sensorgpio-15", "GPIO-Composite1",
+            "VGI001", "composite-sensor",
+            "closed", "1",
+            "virtual", "IPC1", "Rack1", "",
+            "Composite sensor $device_name has been $status", "WARNING");
+        assert (rv == 0);
+        pthread_mutex_lock (&gpx_list_mutex);
+        _gpx_info_t *gpx_info = get_gpx_info ("sensorgpio-15");
+        assert (gpx_info);
+        gpx_info->expr = gpio_expr_new ("not GPIO-Sensor-Door1");
+        assert (gpx_info->expr);
+        pthread_mutex_unlock (&gpx_list_mutex);
+
+        mlm_client_t *metrics_listener = mlm_client_new ();
+        mlm_client_connect (metrics_listener, endpoint, 1000, "fty_sensor_gpio_metrics_listener");
+        mlm_client_set_consumer (metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status.VGI.*");
+
+        const char *states[] = { "0", "1", "0" };  // closed, opened, then closed again
+        const char *expected[] = { "opened", "closed", "opened" };
+        for (int i = 0; i < 3; i++) {
+            int handle = open (gpi1_fn.c_str(), O_WRONLY | O_TRUNC, 0);
+            assert (handle >= 0);
+            int rc = write (handle, states [i], 1);
+            assert (rc == 1);
+            close (handle);
+            zstr_sendx (self, "UPDATE", NULL);
+
+            // The virtual sensor is published by its own checks, which may
+            // come before the one of the door, and upon the door changes
+            bool found = false;
+            for (int n = 0; !found && (n < 3); n++) {
+                zmsg_t *recv = mlm_client_recv (metrics_listener);
+                assert (recv);
+                fty_proto_t *frecv = fty_proto_decode (&recv);
+                assert (frecv);
+                assert (streq (fty_proto_name (frecv), "IPC1"));
+                assert (streq (fty_proto_type (frecv), "status.VGI1"));
+                assert (streq (fty_proto_aux_string (frecv, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, NULL), "sensorgpio-15"));
+                found = streq (fty_proto_value (frecv), expected [i]);
+                fty_proto_destroy (&frecv);
+            }
+            assert (found);
+        }
         mlm_client_destroy (&metrics_listener);
     }
 
+    // Test #1k: Write the Prometheus text file, and check the states and the
+    // statistics it holds
+    {
+        std::string prometheus_fn = str_SELFTEST_DIR_RW + "/fty-sensor-gpio.prom";
+        zstr_sendx (self, "PROMETHEUS_INTERVAL", "100", NULL);
+        zstr_sendx (self, "PROMETHEUS_FILE", prometheus_fn.c_str (), NULL);
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (500);
+
+        FILE *f_prometheus = fopen (prometheus_fn.c_str (), "r");
+        assert (f_prometheus);
+        const char *state_prefix = "fty_sensor_gpio_state{asset=\"sensorgpio-10\",name=\"GPIO-Sensor-Door1\"";
+        const char *stats_prefix = "fty_sensor_gpio_poll_cycles ";
+        bool found_state = false;
+        bool found_stats = false;
+        char line [1024];
+        while (fgets (line, sizeof (line), f_prometheus)) {
+            if (strncmp (line, state_prefix, strlen (state_prefix)) == 0)
+                found_state = true;
+            if (strncmp (line, stats_prefix, strlen (stats_prefix)) == 0)
+                found_stats = true;
+        }
+        fclose (f_prometheus);
+        assert (found_state);
+        assert (found_stats);
+        // Never left half written
+        assert (access ((prometheus_fn + ".tmp").c_str (), F_OK) != 0);
+
+        zstr_sendx (self, "PROMETHEUS_FILE", "", NULL);
+        remove (prometheus_fn.c_str ());
+    }
+
+    // Test #1l: Maintain the shared memory table, and read the states of the
+    // door contact and of the virtual sensor from it
+    {
+        std::string shm_fn = str_SELFTEST_DIR_RW + "/fty-sensor-gpio.shm";
+        zstr_sendx (self, "SHM", shm_fn.c_str (), NULL);
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (500);
+
+        fty_sensor_gpio_shm_t *shm = fty_sensor_gpio_shm_open (shm_fn.c_str ());
+        assert (shm);
+        assert (fty_sensor_gpio_shm_generation (shm) > 0);
+        fty_sensor_gpio_shm_entry_t entry;
+        assert (fty_sensor_gpio_shm_find (shm, "sensorgpio-10", &entry) == 0);
+        assert (streq (entry.port, "GPI1"));
+        assert (entry.direction == GPIO_DIRECTION_IN);
+        assert (entry.number == 1);
+        assert ((entry.state == GPIO_STATE_CLOSED) || (entry.state == GPIO_STATE_OPENED));
+        assert (entry.time_ns > 0);
+        int door_state = entry.state;
+        assert (fty_sensor_gpio_shm_find (shm, "sensorgpio-15", &entry) == 0);
+        assert (streq (entry.port, "VGI1"));
+        assert (entry.state == !door_state);
+        assert (fty_sensor_gpio_shm_find (shm, "sensorgpio-unknown", &entry) == -1);
+        fty_sensor_gpio_shm_destroy (&shm);
+
+        zstr_sendx (self, "SHM", "", NULL);
+        remove (shm_fn.c_str ());
+    }
+
+    // Test #1m: Record the GPIO transitions read during an update, then
+    // replay them one per read
+    {
+        std::string trace_fn = str_SELFTEST_DIR_RW + "/fty-sensor-gpio.trace";
+        zstr_sendx (self, "GPIO_RECORD", trace_fn.c_str (), NULL);
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (500);
+        zstr_sendx (self, "GPIO_RECORD", "", NULL);
+
+        FILE *trace_file = fopen (trace_fn.c_str (), "r");
+        assert (trace_file);
+        char line[64];
+        assert (fgets (line, sizeof (line), trace_file));
+        assert (strncmp (line, "# fty-sensor-gpio trace", 23) == 0);
+        int events = 0;
+        bool door = false;
+        while (fgets (line, sizeof (line), trace_file)) {
+            events++;
+            const char *event = strchr (line, ' ');
+            if (event && (strncmp (event, " I 1 ", 5) == 0))
+                door = true;
+        }
+        fclose (trace_file);
+        assert (door);
+
+        zstr_sendx (self, "GPIO_REPLAY", trace_fn.c_str (), "0", NULL);
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (500);
+        zmsg_t *msg = zmsg_new ();
+        zuuid_t *zuuid = zuuid_new ();
+        zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+        int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPIO_STATS", NULL, 5000, &msg);
+        assert ( rv == 0 );
+
+        zmsg_t *recv = mlm_client_recv (mb_client);
+        assert (recv);
+        char *recv_str = zmsg_popstr (recv);
+        assert (streq (zuuid_str_canonical (zuuid), recv_str));
+        zstr_free (&recv_str);
+        recv_str = zmsg_popstr (recv);
+        assert ( streq ( recv_str, "OK") );
+        zstr_free (&recv_str);
+        // The reads of the update have consumed some events of the trace
+        bool replayed = false;
+        char *key = zmsg_popstr (recv);
+        while (key) {
+            char *value = zmsg_popstr (recv);
+            assert (value);
+            if (streq (key, "gpio.replay_remaining")) {
+                assert (atoi (value) < events);
+                replayed = true;
+            }
+            zstr_free (&value);
+            zstr_free (&key);
+            key = zmsg_popstr (recv);
+        }
+        assert (replayed);
+        zmsg_destroy (&recv);
+        zuuid_destroy (&zuuid);
+
+        zstr_sendx (self, "GPIO_REPLAY", "", NULL);
+        remove (trace_fn.c_str ());
+    }
+
     // Test #2: Post a GPIO_TEMPLATE_ADD request and check the file created
     // Note: this will serve afterward for the GPIO_MANIFEST / GPIO_MANIFEST_SUMMARY
     // requests
@@ -1494,6 +4782,166 @@ fty_sensor_gpio_server_test (bool verbose)
         assert ( readbuf[0] == '1' ); // 1 == GPIO_STATE_OPENED
     }
 
+    // Test #6b: Local automation rule: close 'gpo-12' when 'sensorgpio-10'
+    // gets opened, and open it back when it gets closed
+    {
+        zstr_sendx (self, "RULE", "test-rule", "sensorgpio-10", "opened", "0",
+            "gpo-12", "disable", "true", NULL);
+
+        int handle = open (gpi1_fn.c_str(), O_WRONLY | O_TRUNC, 0);
+        assert (handle >= 0);
+        int rc = write (handle, "1", 1);   // 1 == GPIO_STATE_OPENED
+        assert (rc == 1);
+        close (handle);
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (500);
+
+        std::string gpo2_fn = gpo_mapping_sys_dir + "/value";
+        handle = open (gpo2_fn.c_str(), O_RDONLY, 0);
+        assert (handle >= 0);
+        char readbuf[2];
+        rc = read (handle, &readbuf[0], 1);
+        assert (rc == 1);
+        close (handle);
+        assert ( readbuf[0] == '0' ); // 0 == GPIO_STATE_CLOSED
+
+        handle = open (gpi1_fn.c_str(), O_WRONLY | O_TRUNC, 0);
+        assert (handle >= 0);
+        rc = write (handle, "0", 1);
+        assert (rc == 1);
+        close (handle);
+        zstr_sendx (self, "UPDATE", NULL);
+        zclock_sleep (500);
+
+        handle = open (gpo2_fn.c_str(), O_RDONLY, 0);
+        assert (handle >= 0);
+        rc = read (handle, &readbuf[0], 1);
+        assert (rc == 1);
+        close (handle);
+        assert ( readbuf[0] == '1' ); // reverted
+    }
+
+    // Test #6c: Send a GPO_INTERACTION_BATCH request on both GPOs, and an
+    // unknown one, and check it
+    {
+        zmsg_t *msg = zmsg_new ();
+        zuuid_t *zuuid = zuuid_new ();
+        zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+        zmsg_addstr (msg, "gpo-11");
+        zmsg_addstr (msg, "close");
+        zmsg_addstr (msg, "GPIO-Test-GPO2");  // ext name of gpo-12
+        zmsg_addstr (msg, "close");
+        zmsg_addstr (msg, "gpo-99");
+        zmsg_addstr (msg, "open");
+        int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPO_INTERACTION_BATCH", NULL, 5000, &msg);
+        assert ( rv == 0 );
+
+        zmsg_t *recv = mlm_client_recv (mb_client);
+        assert(recv);
+        const char *expected[] = { zuuid_str_canonical (zuuid), "ERROR",
+            "gpo-11", "OK", "GPIO-Test-GPO2", "OK", "gpo-99", "ASSET_NOT_FOUND" };
+        for (const char *expected_str : expected) {
+            char *recv_str = zmsg_popstr (recv);
+            assert (recv_str && streq (recv_str, expected_str));
+            zstr_free (&recv_str);
+        }
+        assert (zmsg_size (recv) == 0);
+        zuuid_destroy (&zuuid);
+        zmsg_destroy (&recv);
+
+        // Now check the filesystem
+        std::string gpo_fns[] = { gpo_sys_dir + "/value", gpo_mapping_sys_dir + "/value" };
+        for (const std::string &gpo_fn : gpo_fns) {
+            int handle = open (gpo_fn.c_str(), O_RDONLY, 0);
+            assert (handle >= 0);
+            char readbuf[2];
+            int rc = read (handle, &readbuf[0], 1);
+            assert (rc == 1);
+            close (handle);
+            assert ( readbuf[0] == '0' ); // 0 == GPIO_STATE_CLOSED
+        }
+    }
+
+    // Test #6d: Timed actions on GPO 'gpo-11': pulse, timed revert, cancel
+    {
+        zmsg_t *msg = zmsg_new ();
+        zmsg_addstr (msg, "gpo-11");
+        zmsg_addstr (msg, "2");
+        zmsg_addstr (msg, "closed");
+        int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPOSTATE", NULL, 5000, &msg);
+        assert ( rv == 0 ); // no response
+
+        std::string gpo1_fn = gpo_sys_dir + "/value";
+        auto gpo_interaction = [&](const char *action, const char *arg, const char *expected) {
+            zmsg_t *msg = zmsg_new ();
+            zuuid_t *zuuid = zuuid_new ();
+            zmsg_addstr (msg, zuuid_str_canonical (zuuid));
+            zmsg_addstr (msg, "gpo-11");
+            zmsg_addstr (msg, action);
+            if (arg)
+                zmsg_addstr (msg, arg);
+            int rv = mlm_client_sendto (mb_client, FTY_SENSOR_GPIO_AGENT, "GPO_INTERACTION", NULL, 5000, &msg);
+            assert ( rv == 0 );
+            zmsg_t *recv = mlm_client_recv (mb_client);
+            assert (recv);
+            char *recv_str = zmsg_popstr (recv);
+            assert (streq (zuuid_str_canonical (zuuid), recv_str));
+            zstr_free (&recv_str);
+            recv_str = zmsg_popstr (recv);
+            if (!streq (recv_str, "OK")) {
+                zstr_free (&recv_str);
+                recv_str = zmsg_popstr (recv);
+            }
+            assert (streq (recv_str, expected));
+            zstr_free (&recv_str);
+            zuuid_destroy (&zuuid);
+            zmsg_destroy (&recv);
+        };
+        auto gpo_value = [&]() {
+            int handle = open (gpo1_fn.c_str(), O_RDONLY, 0);
+            assert (handle >= 0);
+            char readbuf[2];
+            int rc = read (handle, &readbuf[0], 1);
+            assert (rc == 1);
+            close (handle);
+            return readbuf[0];
+        };
+
+        // Pulse, re-armed by an identical request
+        gpo_interaction ("pulse", "400", "OK");
+        assert (gpo_value () == '1');
+        zclock_sleep (200);
+        gpo_interaction ("pulse", "400", "OK");
+        zclock_sleep (300);
+        assert (gpo_value () == '1');
+        zclock_sleep (300);
+        assert (gpo_value () == '0');
+
+        // Timed revert, then cancelled
+        gpo_interaction ("open", "10000", "OK");
+        assert (gpo_value () == '1');
+        gpo_interaction ("cancel", NULL, "OK");
+        assert (gpo_value () == '0');
+        gpo_interaction ("cancel", NULL, "ACTION_NOT_APPLICABLE");
+        gpo_interaction ("close", "1000", "ACTION_NOT_APPLICABLE");
+        gpo_interaction ("pulse", "0", "BAD_COMMAND");
+
+        // A timed revert saved in the state file is resumed on the GPO
+        // already announced by fty-sensor-gpio-assets
+        std::string state_fn = str_SELFTEST_DIR_RW + "/state";
+        FILE *f_state = fopen (state_fn.c_str (), "w");
+        assert (f_state);
+        fprintf (f_state, "gpo-11 2 %d %d %d %d 500 0 %" PRIi64 "\n", GPIO_STATE_CLOSED, GPIO_STATE_OPENED,
+            GPO_TIMED_REVERT, GPIO_STATE_CLOSED, zclock_time () + 500);
+        fclose (f_state);
+        zstr_sendx (self, "STATEFILE", state_fn.c_str (), NULL);
+        zclock_sleep (200);
+        assert (gpo_value () == '1');
+        zclock_sleep (600);
+        assert (gpo_value () == '0');
+        remove (state_fn.c_str ());
+    }
+
     // Test #7: Disable all GPI/GPO (as on OVA),
     // Create a sensor and verify that it fails
     {
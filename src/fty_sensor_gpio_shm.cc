@@ -0,0 +1,512 @@
+/*  =========================================================================
+    fty_sensor_gpio_shm - Shared memory table of the sensors states
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_sensor_gpio_shm - Shared memory table of the sensors states
+@discuss
+    The agent maintains the states of its sensors in a table mapped from a
+    file (typically under /dev/shm), when configured, so that local
+    consumers get them without joining malamute nor decoding fty_proto
+    messages.
+
+    Each slot of the table is protected by a sequence lock: the agent, the
+    only writer, makes its sequence odd while it writes the slot in place,
+    and even again once done. A consumer copies the slot out, and retries if
+    the sequence was odd or changed meanwhile, so that it never blocks the
+    agent nor sees a torn entry. A generation count in the header is
+    incremented by each write, for consumers to poll for changes.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+#include <sys/mman.h>
+#include <sched.h>
+
+#define SHM_MAGIC           0x4f495047  // "GPIO"
+#define SHM_READ_ATTEMPTS   1000        // Attempts to read a slot consistently
+
+//  Header of the table, at the start of the mapping
+
+typedef struct {
+    uint32_t magic;         // SHM_MAGIC, once the table is initialized
+    uint32_t version;       // FTY_SENSOR_GPIO_SHM_VERSION
+    uint32_t capacity;      // Number of slots
+    uint32_t slot_size;     // Size of a slot
+    uint64_t generation;    // Number of writes, updated atomically
+    int64_t  writer_pid;    // Process ID of the agent
+} shm_header_t;
+
+//  Slot of the table, following the header
+
+typedef struct {
+    uint32_t sequence;      // Sequence lock, odd while the slot is written
+    uint32_t used;          // 1 if the slot holds a sensor, 0 if free
+    fty_sensor_gpio_shm_entry_t entry;
+} shm_slot_t;
+
+//  Structure of our class
+
+struct _fty_sensor_gpio_shm_t {
+    void         *map;      // Mapping of the table
+    size_t       map_size;  // Size of the mapping
+    shm_header_t *header;   // Header of the table
+    shm_slot_t   *slots;    // Slots of the table
+    size_t       capacity;  // Number of slots
+    zhashx_t     *index;    // Writer only: slot + 1 per asset name (NULL: reader)
+    bool         *swept;    // Writer only: slots updated during the current sweep
+    bool         sweeping;  // Writer only: true during a sweep
+};
+
+//  --------------------------------------------------------------------------
+//  Write a slot in place, under its sequence lock (entry NULL: free it)
+
+static void
+s_write_slot (fty_sensor_gpio_shm_t *self, size_t slot, const fty_sensor_gpio_shm_entry_t *entry)
+{
+    shm_slot_t *shm_slot = &self->slots [slot];
+    uint32_t sequence = __atomic_load_n (&shm_slot->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n (&shm_slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+    shm_slot->used = entry? 1 : 0;
+    if (entry)
+        memcpy (&shm_slot->entry, entry, sizeof (fty_sensor_gpio_shm_entry_t));
+    else
+        memset (&shm_slot->entry, 0, sizeof (fty_sensor_gpio_shm_entry_t));
+    __atomic_store_n (&shm_slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+    __atomic_fetch_add (&self->header->generation, 1, __ATOMIC_RELEASE);
+}
+
+//  --------------------------------------------------------------------------
+//  Map a table file, and check its header if it is expected to be initialized.
+//  The writer never shrinks an existing table, whose readers may still map
+//  its tail: it takes over all of its slots if there are more than asked.
+
+static fty_sensor_gpio_shm_t *
+s_map (const char *path, bool writer, size_t capacity)
+{
+    int fd = open (path, writer? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (fd < 0)
+        return NULL;
+    size_t map_size = sizeof (shm_header_t) + capacity * sizeof (shm_slot_t);
+    struct stat st;
+    if (writer) {
+        if (fstat (fd, &st) != 0) {
+            close (fd);
+            return NULL;
+        }
+        size_t file_size = st.st_size;
+        if (file_size > sizeof (shm_header_t)) {
+            size_t file_capacity = (file_size - sizeof (shm_header_t)) / sizeof (shm_slot_t);
+            if (file_capacity > capacity)
+                capacity = file_capacity;
+        }
+        map_size = sizeof (shm_header_t) + capacity * sizeof (shm_slot_t);
+        if (file_size > map_size)
+            map_size = file_size;
+        if ((file_size < map_size) && (ftruncate (fd, map_size) != 0)) {
+            close (fd);
+            return NULL;
+        }
+    }
+    else
+    if ((fstat (fd, &st) != 0) || ((size_t) st.st_size < sizeof (shm_header_t))) {
+        close (fd);
+        return NULL;
+    }
+    else
+        map_size = st.st_size;
+
+    void *map = mmap (NULL, map_size, writer? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    fty_sensor_gpio_shm_t *self = (fty_sensor_gpio_shm_t *) zmalloc (sizeof (fty_sensor_gpio_shm_t));
+    assert (self);
+    self->map = map;
+    self->map_size = map_size;
+    self->header = (shm_header_t *) map;
+    self->slots = (shm_slot_t *) ((char *) map + sizeof (shm_header_t));
+    self->capacity = capacity;
+    if (!writer) {
+        shm_header_t *header = self->header;
+        if ((__atomic_load_n (&header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC)
+            || (header->version != FTY_SENSOR_GPIO_SHM_VERSION)
+            || (header->slot_size != sizeof (shm_slot_t))
+            || (sizeof (shm_header_t) + (size_t) header->capacity * sizeof (shm_slot_t) > map_size)) {
+            fty_sensor_gpio_shm_destroy (&self);
+            return NULL;
+        }
+        self->capacity = header->capacity;
+    }
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Create (or reset) the table, for writing
+
+fty_sensor_gpio_shm_t *
+fty_sensor_gpio_shm_new (const char *path, size_t capacity)
+{
+    assert (path);
+    fty_sensor_gpio_shm_t *self = s_map (path, true, capacity);
+    if (!self)
+        return NULL;
+    capacity = self->capacity;
+    //  Initialize class properties here
+    self->index = zhashx_new ();
+    self->swept = (bool *) zmalloc (capacity * sizeof (bool));
+    assert (self->index && self->swept);
+
+    // Free all the slots, keeping their sequences going for the consumers
+    // of a previous table, and unlocking those a previous agent left locked
+    for (size_t slot = 0; slot < capacity; slot++) {
+        if (self->slots [slot].sequence & 1)
+            self->slots [slot].sequence++;
+        s_write_slot (self, slot, NULL);
+    }
+    shm_header_t *header = self->header;
+    header->version = FTY_SENSOR_GPIO_SHM_VERSION;
+    header->capacity = (uint32_t) capacity;
+    header->slot_size = sizeof (shm_slot_t);
+    header->writer_pid = getpid ();
+    __atomic_store_n (&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Map the table, read only
+
+fty_sensor_gpio_shm_t *
+fty_sensor_gpio_shm_open (const char *path)
+{
+    assert (path);
+    return s_map (path, false, 0);
+}
+
+//  --------------------------------------------------------------------------
+//  Write the state of a sensor in place
+
+int
+fty_sensor_gpio_shm_update (fty_sensor_gpio_shm_t *self, const fty_sensor_gpio_shm_entry_t *entry)
+{
+    assert (self);
+    assert (self->index);
+    assert (entry);
+    // Normalized copy, so that unchanged entries compare equal
+    fty_sensor_gpio_shm_entry_t copy;
+    memset (&copy, 0, sizeof (copy));
+    snprintf (copy.asset_name, sizeof (copy.asset_name), "%s", entry->asset_name);
+    snprintf (copy.port, sizeof (copy.port), "%s", entry->port);
+    copy.direction = entry->direction;
+    copy.number = entry->number;
+    copy.state = entry->state;
+    copy.time_ns = entry->time_ns;
+
+    size_t slot = (size_t) zhashx_lookup (self->index, copy.asset_name);
+    if (slot == 0) {
+        while ((slot < self->capacity) && self->slots [slot].used)
+            slot++;
+        if (slot == self->capacity)
+            return -1;
+        zhashx_insert (self->index, copy.asset_name, (void *) (slot + 1));
+    }
+    else
+        slot--;
+
+    self->swept [slot] = true;
+    if (!self->slots [slot].used || (memcmp (&self->slots [slot].entry, &copy, sizeof (copy)) != 0))
+        s_write_slot (self, slot, &copy);
+    return (int) slot;
+}
+
+//  --------------------------------------------------------------------------
+//  Free the slot of a sensor
+
+void
+fty_sensor_gpio_shm_remove (fty_sensor_gpio_shm_t *self, const char *asset_name)
+{
+    assert (self);
+    assert (self->index);
+    assert (asset_name);
+    char key [FTY_SENSOR_GPIO_SHM_NAME_SIZE];
+    snprintf (key, sizeof (key), "%s", asset_name);
+    size_t slot = (size_t) zhashx_lookup (self->index, key);
+    if (slot == 0)
+        return;
+    zhashx_delete (self->index, key);
+    s_write_slot (self, slot - 1, NULL);
+}
+
+//  --------------------------------------------------------------------------
+//  Start a sweep of the sensors
+
+void
+fty_sensor_gpio_shm_sweep_begin (fty_sensor_gpio_shm_t *self)
+{
+    assert (self);
+    assert (self->index);
+    memset (self->swept, 0, self->capacity * sizeof (bool));
+    self->sweeping = true;
+}
+
+//  --------------------------------------------------------------------------
+//  End a sweep of the sensors
+
+void
+fty_sensor_gpio_shm_sweep_end (fty_sensor_gpio_shm_t *self)
+{
+    assert (self);
+    assert (self->index);
+    if (!self->sweeping)
+        return;
+    self->sweeping = false;
+    for (size_t slot = 0; slot < self->capacity; slot++) {
+        if (self->slots [slot].used && !self->swept [slot])
+            fty_sensor_gpio_shm_remove (self, self->slots [slot].entry.asset_name);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of slots of the table
+
+size_t
+fty_sensor_gpio_shm_capacity (fty_sensor_gpio_shm_t *self)
+{
+    assert (self);
+    return self->capacity;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the version of the content of the table
+
+uint64_t
+fty_sensor_gpio_shm_generation (fty_sensor_gpio_shm_t *self)
+{
+    assert (self);
+    return __atomic_load_n (&self->header->generation, __ATOMIC_ACQUIRE);
+}
+
+//  --------------------------------------------------------------------------
+//  Copy a consistent snapshot of a slot
+
+int
+fty_sensor_gpio_shm_read (fty_sensor_gpio_shm_t *self, size_t slot, fty_sensor_gpio_shm_entry_t *entry)
+{
+    assert (self);
+    assert (entry);
+    if (slot >= self->capacity)
+        return -1;
+    shm_slot_t *shm_slot = &self->slots [slot];
+    for (int attempt = 0; attempt < SHM_READ_ATTEMPTS; attempt++) {
+        uint32_t before = __atomic_load_n (&shm_slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            // Being written
+            sched_yield ();
+            continue;
+        }
+        uint32_t used = __atomic_load_n (&shm_slot->used, __ATOMIC_RELAXED);
+        memcpy (entry, &shm_slot->entry, sizeof (fty_sensor_gpio_shm_entry_t));
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+        if (__atomic_load_n (&shm_slot->sequence, __ATOMIC_RELAXED) == before) {
+            entry->asset_name [FTY_SENSOR_GPIO_SHM_NAME_SIZE - 1] = '\0';
+            entry->port [FTY_SENSOR_GPIO_SHM_PORT_SIZE - 1] = '\0';
+            return used? 0 : -1;
+        }
+    }
+    return -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Copy a consistent snapshot of the state of a sensor, by asset name
+
+int
+fty_sensor_gpio_shm_find (fty_sensor_gpio_shm_t *self, const char *asset_name, fty_sensor_gpio_shm_entry_t *entry)
+{
+    assert (self);
+    assert (asset_name);
+    assert (entry);
+    for (size_t slot = 0; slot < self->capacity; slot++) {
+        if ((fty_sensor_gpio_shm_read (self, slot, entry) == 0)
+            && (strncmp (entry->asset_name, asset_name, FTY_SENSOR_GPIO_SHM_NAME_SIZE - 1) == 0))
+            return 0;
+    }
+    return -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the fty_sensor_gpio_shm
+
+void
+fty_sensor_gpio_shm_destroy (fty_sensor_gpio_shm_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        fty_sensor_gpio_shm_t *self = *self_p;
+        //  Free class properties here
+        if (self->index)
+            __atomic_store_n (&self->header->writer_pid, 0, __ATOMIC_RELEASE);
+        munmap (self->map, self->map_size);
+        zhashx_destroy (&self->index);
+        free (self->swept);
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+//  Writer thread of the test, rewriting the same slot over and over, with
+//  the number, state and time of each entry tied together
+
+static void *
+s_test_writer (void *args)
+{
+    fty_sensor_gpio_shm_t *self = (fty_sensor_gpio_shm_t *) args;
+    fty_sensor_gpio_shm_entry_t entry;
+    memset (&entry, 0, sizeof (entry));
+    strcpy (entry.asset_name, "sensorgpio-busy");
+    for (int i = 1; i <= 100000; i++) {
+        entry.number = i;
+        entry.state = i % 2;
+        entry.time_ns = (int64_t) i * 1000;
+        snprintf (entry.port, sizeof (entry.port), "GPI%d", i);
+        fty_sensor_gpio_shm_update (self, &entry);
+    }
+    return NULL;
+}
+
+void
+fty_sensor_gpio_shm_test (bool verbose)
+{
+    printf (" * fty_sensor_gpio_shm: ");
+
+    //  @selftest
+    //  Note: If your selftest reads SCMed fixture data, please keep it in
+    //  src/selftest-ro; if your test creates filesystem objects, please
+    //  do so under src/selftest-rw.
+    const char *SELFTEST_DIR_RW = "src/selftest-rw";
+    std::string path = std::string (SELFTEST_DIR_RW) + "/fty-sensor-gpio.shm";
+    remove (path.c_str ());
+    assert (fty_sensor_gpio_shm_open (path.c_str ()) == NULL);
+
+    fty_sensor_gpio_shm_t *writer = fty_sensor_gpio_shm_new (path.c_str (), 2);
+    assert (writer);
+    fty_sensor_gpio_shm_t *reader = fty_sensor_gpio_shm_open (path.c_str ());
+    assert (reader);
+    assert (fty_sensor_gpio_shm_capacity (reader) == 2);
+    uint64_t generation = fty_sensor_gpio_shm_generation (reader);
+
+    // Written in place, and read back without any lock
+    fty_sensor_gpio_shm_entry_t entry, read;
+    memset (&entry, 0, sizeof (entry));
+    strcpy (entry.asset_name, "sensorgpio-10");
+    strcpy (entry.port, "GPI1");
+    entry.direction = GPIO_DIRECTION_IN;
+    entry.number = 1;
+    entry.state = GPIO_STATE_CLOSED;
+    entry.time_ns = 1000;
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 0);
+    assert (fty_sensor_gpio_shm_generation (reader) == generation + 1);
+    assert (fty_sensor_gpio_shm_read (reader, 0, &read) == 0);
+    assert (streq (read.asset_name, "sensorgpio-10"));
+    assert (streq (read.port, "GPI1"));
+    assert (read.state == GPIO_STATE_CLOSED);
+    assert (read.time_ns == 1000);
+    assert (fty_sensor_gpio_shm_read (reader, 1, &read) == -1);
+    assert (fty_sensor_gpio_shm_read (reader, 2, &read) == -1);
+
+    // Unchanged entries are not written again, changed ones keep their slot
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 0);
+    assert (fty_sensor_gpio_shm_generation (reader) == generation + 1);
+    entry.state = GPIO_STATE_OPENED;
+    entry.time_ns = 2000;
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 0);
+    assert (fty_sensor_gpio_shm_generation (reader) == generation + 2);
+    assert (fty_sensor_gpio_shm_find (reader, "sensorgpio-10", &read) == 0);
+    assert (read.state == GPIO_STATE_OPENED);
+    assert (read.time_ns == 2000);
+
+    // Up to the capacity of the table
+    strcpy (entry.asset_name, "sensorgpio-11");
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 1);
+    strcpy (entry.asset_name, "sensorgpio-12");
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == -1);
+    assert (fty_sensor_gpio_shm_find (reader, "sensorgpio-12", &read) == -1);
+
+    // Removed explicitly, or when not updated during a sweep
+    fty_sensor_gpio_shm_remove (writer, "sensorgpio-11");
+    assert (fty_sensor_gpio_shm_find (reader, "sensorgpio-11", &read) == -1);
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 1);
+    fty_sensor_gpio_shm_sweep_begin (writer);
+    strcpy (entry.asset_name, "sensorgpio-10");
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 0);
+    fty_sensor_gpio_shm_sweep_end (writer);
+    assert (fty_sensor_gpio_shm_find (reader, "sensorgpio-10", &read) == 0);
+    assert (fty_sensor_gpio_shm_find (reader, "sensorgpio-12", &read) == -1);
+
+    // The readers never see a torn entry while the slot is rewritten
+    fty_sensor_gpio_shm_remove (writer, "sensorgpio-10");
+    pthread_t thread;
+    assert (pthread_create (&thread, NULL, s_test_writer, writer) == 0);
+    int consistent = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (fty_sensor_gpio_shm_find (reader, "sensorgpio-busy", &read) == 0) {
+            assert (read.state == read.number % 2);
+            assert (read.time_ns == (int64_t) read.number * 1000);
+            assert (atoi (read.port + 3) == read.number);
+            consistent++;
+        }
+    }
+    pthread_join (thread, NULL);
+    if (verbose)
+        printf ("%d consistent reads ", consistent);
+
+    // A restarted writer resets the table, which the readers keep on using
+    fty_sensor_gpio_shm_destroy (&writer);
+    assert (writer == NULL);
+    writer = fty_sensor_gpio_shm_new (path.c_str (), 2);
+    assert (writer);
+    assert (fty_sensor_gpio_shm_find (reader, "sensorgpio-busy", &read) == -1);
+    assert (fty_sensor_gpio_shm_generation (reader) > generation);
+
+    // A restarted writer asking for fewer slots does not shrink the table
+    // under its readers, it keeps all of them
+    fty_sensor_gpio_shm_destroy (&writer);
+    writer = fty_sensor_gpio_shm_new (path.c_str (), 1);
+    assert (writer);
+    assert (fty_sensor_gpio_shm_capacity (writer) == 2);
+    assert (fty_sensor_gpio_shm_read (reader, 1, &read) == -1);
+    strcpy (entry.asset_name, "sensorgpio-13");
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 0);
+    strcpy (entry.asset_name, "sensorgpio-14");
+    assert (fty_sensor_gpio_shm_update (writer, &entry) == 1);
+    assert (fty_sensor_gpio_shm_find (reader, "sensorgpio-14", &read) == 0);
+
+    fty_sensor_gpio_shm_destroy (&reader);
+    fty_sensor_gpio_shm_destroy (&writer);
+    remove (path.c_str ());
+    //  @end
+    printf ("OK\n");
+}
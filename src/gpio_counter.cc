@@ -0,0 +1,192 @@
+/*  =========================================================================
+    gpio_counter - GPI pulse counter
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_counter - GPI pulse counter
+@discuss
+    Accumulate the pulses of a GPI, and compute their rate over a sliding
+    window. The window is split into a ring of fixed size buckets, so that
+    recording pulses and computing the rate don't depend on the number of
+    pulses. The window is rounded up to a multiple of the buckets count.
+    Until a whole window has elapsed since the first pulses, the rate is
+    computed over the elapsed time only.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Structure of our class
+
+struct _gpio_counter_t {
+    int      window;        // Rate window, msec
+    int      bucket_span;   // Duration of a bucket, msec (window rounded up to a bucket multiple)
+    uint64_t buckets [GPIO_COUNTER_BUCKETS]; // Ring of pulses per bucket
+    int64_t  bucket_ids [GPIO_COUNTER_BUCKETS]; // Bucket number (time / span) of each slot
+    uint64_t total;         // Total number of pulses
+    int64_t  start;         // Monotonic timestamp of the first pulses, msec (-1: none)
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_counter
+
+gpio_counter_t *
+gpio_counter_new (int window)
+{
+    gpio_counter_t *self = (gpio_counter_t *) zmalloc (sizeof (gpio_counter_t));
+    assert (self);
+    //  Initialize class properties here
+    self->bucket_span = (window + GPIO_COUNTER_BUCKETS - 1) / GPIO_COUNTER_BUCKETS;
+    if (self->bucket_span < 1)
+        self->bucket_span = 1;
+    self->window = window;
+    for (int i = 0; i < GPIO_COUNTER_BUCKETS; i++)
+        self->bucket_ids [i] = -1;
+    self->start = -1;
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Record pulses
+
+void
+gpio_counter_add (gpio_counter_t *self, uint64_t pulses, int64_t now)
+{
+    assert (self);
+    int64_t id = now / self->bucket_span;
+    int slot = (int) (id % GPIO_COUNTER_BUCKETS);
+    // Recycle the slot of an expired bucket
+    if (self->bucket_ids [slot] != id) {
+        self->bucket_ids [slot] = id;
+        self->buckets [slot] = 0;
+    }
+    self->buckets [slot] += pulses;
+    self->total += pulses;
+    if (self->start < 0)
+        self->start = now;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the total number of pulses counted
+
+uint64_t
+gpio_counter_total (gpio_counter_t *self)
+{
+    assert (self);
+    return self->total;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the pulse rate over the window, pulses per second
+
+double
+gpio_counter_rate (gpio_counter_t *self, int64_t now)
+{
+    assert (self);
+    if (self->start < 0)
+        return 0.0;
+    int64_t id = now / self->bucket_span;
+    uint64_t pulses = 0;
+    for (int i = 0; i < GPIO_COUNTER_BUCKETS; i++) {
+        if ((self->bucket_ids [i] > id - GPIO_COUNTER_BUCKETS) && (self->bucket_ids [i] <= id))
+            pulses += self->buckets [i];
+    }
+    int64_t span = now - self->start;
+    if (span > self->bucket_span * GPIO_COUNTER_BUCKETS)
+        span = self->bucket_span * GPIO_COUNTER_BUCKETS;
+    if (span < self->bucket_span)
+        span = self->bucket_span;
+    return pulses * 1000.0 / span;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the rate window, msec
+
+int
+gpio_counter_window (gpio_counter_t *self)
+{
+    assert (self);
+    return self->window;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_counter
+
+void
+gpio_counter_destroy (gpio_counter_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_counter_t *self = *self_p;
+        //  Free class properties here
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_counter_test (bool verbose)
+{
+    printf (" * gpio_counter: ");
+
+    //  @selftest
+    gpio_counter_t *self = gpio_counter_new (16000);
+    assert (self);
+    assert (gpio_counter_window (self) == 16000);
+
+    // No pulse yet
+    assert (gpio_counter_total (self) == 0);
+    assert (gpio_counter_rate (self, 1000) == 0.0);
+
+    // Before a whole window has elapsed, the rate is over the elapsed time
+    gpio_counter_add (self, 10, 100000);
+    gpio_counter_add (self, 10, 104000);
+    assert (gpio_counter_total (self) == 20);
+    assert (gpio_counter_rate (self, 108000) == 20 * 1000.0 / 8000);
+
+    // Steady rate of 5 pulses per second over the whole window
+    for (int64_t now = 105000; now < 132000; now += 1000)
+        gpio_counter_add (self, 5, now);
+    assert (gpio_counter_total (self) == 20 + 27 * 5);
+    assert (gpio_counter_rate (self, 131500) == 5.0);
+
+    // Pulses expire with the window
+    assert (gpio_counter_rate (self, 140000) == 7 * 5 * 1000.0 / 16000);
+    assert (gpio_counter_rate (self, 200000) == 0.0);
+    assert (gpio_counter_total (self) == 20 + 27 * 5);
+
+    // A tiny window still has a bucket per slot
+    gpio_counter_destroy (&self);
+    self = gpio_counter_new (1);
+    assert (gpio_counter_window (self) == 1);
+    gpio_counter_add (self, 3, 0);
+    assert (gpio_counter_rate (self, 0) == 3 * 1000.0);
+
+    gpio_counter_destroy (&self);
+    assert (self == NULL);
+    //  @end
+    printf ("OK\n");
+}
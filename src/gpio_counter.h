@@ -0,0 +1,72 @@
+/*  =========================================================================
+    gpio_counter - GPI pulse counter
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_COUNTER_H_INCLUDED
+#define GPIO_COUNTER_H_INCLUDED
+
+// Number of buckets the rate window is split into
+#define GPIO_COUNTER_BUCKETS 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new gpio_counter, computing the pulse rate over a sliding
+//  'window' msec
+FTY_SENSOR_GPIO_PRIVATE gpio_counter_t *
+    gpio_counter_new (int window);
+
+//  @interface
+//  Record 'pulses' pulses at 'now' (monotonic, msec)
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_counter_add (gpio_counter_t *self, uint64_t pulses, int64_t now);
+
+//  @interface
+//  Get the total number of pulses counted
+FTY_SENSOR_GPIO_PRIVATE uint64_t
+    gpio_counter_total (gpio_counter_t *self);
+
+//  @interface
+//  Get the pulse rate over the window as of 'now', pulses per second
+FTY_SENSOR_GPIO_PRIVATE double
+    gpio_counter_rate (gpio_counter_t *self, int64_t now);
+
+//  @interface
+//  Get the rate window, msec
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_counter_window (gpio_counter_t *self);
+
+//  Destroy the gpio_counter
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_counter_destroy (gpio_counter_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_counter_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
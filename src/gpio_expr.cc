@@ -0,0 +1,470 @@
+/*  =========================================================================
+    gpio_expr - Boolean expression over sensor states
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_expr - Boolean expression over sensor states
+@discuss
+    The expression is compiled once into a graph of nodes, where chains of
+    the same operator are merged into a single node. Each node keeps the
+    count of its true children, so that setting an input only updates its
+    leaves and their ancestors, up to the first node whose value doesn't
+    change: the cost of an update doesn't depend on the expression size.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Kinds of nodes
+
+#define GPIO_EXPR_INPUT 0
+#define GPIO_EXPR_NOT   1
+#define GPIO_EXPR_AND   2
+#define GPIO_EXPR_OR    3
+
+//  Node of the evaluation graph
+
+typedef struct {
+    int      kind;          // GPIO_EXPR_*
+    int      parent;        // Index of the parent node (-1: root)
+    int      input;         // Index of the input, for input nodes
+    int      next_leaf;     // Next input node of the same input (-1: none)
+    int      children;      // Number of children
+    int      true_count;    // Number of true children
+    bool     value;         // Value of the node
+} gpio_expr_node_t;
+
+//  Structure of our class
+
+struct _gpio_expr_t {
+    gpio_expr_node_t *nodes;  // Nodes, children before their parent
+    int      node_count;    // Number of nodes, the last one being the root
+    char     **names;       // Sensor name of each input
+    int      *first_leaf;   // First input node of each input
+    bool     *known;        // Has each input been set?
+    int      input_count;   // Number of inputs
+    int      known_count;   // Number of inputs set
+    uint64_t updates;       // Number of nodes recomputed
+};
+
+//  Parser state
+
+typedef struct {
+    gpio_expr_t *expr;
+    const char  *text;
+    size_t       pos;
+    bool         failed;
+} gpio_expr_parser_t;
+
+static int s_parse_or (gpio_expr_parser_t *parser);
+static int s_parse_and (gpio_expr_parser_t *parser);
+
+
+//  --------------------------------------------------------------------------
+//  Compute the value of a node from its children
+
+static bool
+s_node_value (gpio_expr_node_t *node)
+{
+    switch (node->kind) {
+        case GPIO_EXPR_NOT:
+            return node->true_count == 0;
+        case GPIO_EXPR_AND:
+            return node->true_count == node->children;
+        case GPIO_EXPR_OR:
+            return node->true_count > 0;
+        default:
+            return node->value;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Lexer: skip blanks, and return the length of the sensor name or keyword
+//  at the current position (0 if none)
+
+static bool
+s_name_char (char c)
+{
+    return isalnum ((unsigned char) c) || (c == '-') || (c == '_') || (c == '.') || (c == ':') || (c == '@');
+}
+
+static size_t
+s_peek_word (gpio_expr_parser_t *parser)
+{
+    while (isspace ((unsigned char) parser->text [parser->pos]))
+        parser->pos++;
+    size_t length = 0;
+    while (s_name_char (parser->text [parser->pos + length]))
+        length++;
+    return length;
+}
+
+//  Consume an operator, given as a symbol (possibly doubled) or a keyword
+
+static bool
+s_accept (gpio_expr_parser_t *parser, char symbol, const char *keyword)
+{
+    size_t length = s_peek_word (parser);
+    const char *at = parser->text + parser->pos;
+    if ((length == 0) && (*at == symbol)) {
+        parser->pos += (at [1] == symbol)? 2 : 1;
+        return true;
+    }
+    if ((length == strlen (keyword)) && (strncasecmp (at, keyword, length) == 0)) {
+        parser->pos += length;
+        return true;
+    }
+    return false;
+}
+
+//  --------------------------------------------------------------------------
+//  Add a node, and return its index
+
+static int
+s_add_node (gpio_expr_t *self, int kind)
+{
+    gpio_expr_node_t *node = &self->nodes [self->node_count];
+    node->kind = kind;
+    node->parent = -1;
+    node->input = -1;
+    node->next_leaf = -1;
+    return self->node_count++;
+}
+
+//  Parse an operand: a sensor name, a negation, or a parenthesized expression
+
+static int
+s_parse_operand (gpio_expr_parser_t *parser)
+{
+    gpio_expr_t *self = parser->expr;
+    if (s_accept (parser, '!', "not")) {
+        int child = s_parse_operand (parser);
+        if (parser->failed)
+            return -1;
+        int index = s_add_node (self, GPIO_EXPR_NOT);
+        self->nodes [child].parent = index;
+        self->nodes [index].children = 1;
+        return index;
+    }
+    size_t length = s_peek_word (parser);
+    if ((length == 0) && (parser->text [parser->pos] == '(')) {
+        parser->pos++;
+        int index = s_parse_or (parser);
+        s_peek_word (parser);
+        if (parser->failed || (parser->text [parser->pos] != ')')) {
+            parser->failed = true;
+            return -1;
+        }
+        parser->pos++;
+        return index;
+    }
+    const char *at = parser->text + parser->pos;
+    if ((length == 0) || ((length == 3) && (strncasecmp (at, "and", 3) == 0))
+        || ((length == 2) && (strncasecmp (at, "or", 2) == 0))) {
+        parser->failed = true;
+        return -1;
+    }
+    // Sensor name, shared by all its occurrences
+    int input;
+    for (input = 0; input < self->input_count; input++) {
+        if ((strlen (self->names [input]) == length) && (strncmp (self->names [input], at, length) == 0))
+            break;
+    }
+    if (input == self->input_count) {
+        self->names [input] = strndup (at, length);
+        self->first_leaf [input] = -1;
+        self->input_count++;
+    }
+    parser->pos += length;
+    int index = s_add_node (self, GPIO_EXPR_INPUT);
+    self->nodes [index].input = input;
+    self->nodes [index].next_leaf = self->first_leaf [input];
+    self->first_leaf [input] = index;
+    return index;
+}
+
+//  Parse a chain of operands joined by the same operator, as a single node
+
+static int
+s_parse_chain (gpio_expr_parser_t *parser, int kind)
+{
+    gpio_expr_t *self = parser->expr;
+    int (*parse_operand) (gpio_expr_parser_t *) = (kind == GPIO_EXPR_OR)? s_parse_and : s_parse_operand;
+    int first = parse_operand (parser);
+    if (parser->failed)
+        return -1;
+    int *children = NULL;
+    int count = 1;
+    while ((kind == GPIO_EXPR_OR)? s_accept (parser, '|', "or") : s_accept (parser, '&', "and")) {
+        if (!children) {
+            children = (int *) zmalloc (strlen (parser->text) * sizeof (int));
+            children [0] = first;
+        }
+        children [count++] = parse_operand (parser);
+        if (parser->failed) {
+            free (children);
+            return -1;
+        }
+    }
+    if (!children)
+        return first;
+    int index = s_add_node (self, kind);
+    for (int i = 0; i < count; i++)
+        self->nodes [children [i]].parent = index;
+    self->nodes [index].children = count;
+    free (children);
+    return index;
+}
+
+static int
+s_parse_and (gpio_expr_parser_t *parser)
+{
+    return s_parse_chain (parser, GPIO_EXPR_AND);
+}
+
+static int
+s_parse_or (gpio_expr_parser_t *parser)
+{
+    return s_parse_chain (parser, GPIO_EXPR_OR);
+}
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_expr
+
+gpio_expr_t *
+gpio_expr_new (const char *text)
+{
+    assert (text);
+    gpio_expr_t *self = (gpio_expr_t *) zmalloc (sizeof (gpio_expr_t));
+    assert (self);
+    //  Initialize class properties here
+    // Each node or input consumes at least one character of the text
+    size_t capacity = strlen (text) + 1;
+    self->nodes = (gpio_expr_node_t *) zmalloc (capacity * sizeof (gpio_expr_node_t));
+    self->names = (char **) zmalloc (capacity * sizeof (char *));
+    self->first_leaf = (int *) zmalloc (capacity * sizeof (int));
+    self->known = (bool *) zmalloc (capacity * sizeof (bool));
+    assert (self->nodes && self->names && self->first_leaf && self->known);
+
+    gpio_expr_parser_t parser = { self, text, 0, false };
+    s_parse_or (&parser);
+    s_peek_word (&parser);
+    if (parser.failed || (text [parser.pos] != '\0')) {
+        zsys_error ("gpio_expr: syntax error at offset %zu of '%s'", parser.pos, text);
+        gpio_expr_destroy (&self);
+        return NULL;
+    }
+
+    // Initial evaluation, with all the inputs false
+    for (int i = 0; i < self->node_count; i++) {
+        gpio_expr_node_t *node = &self->nodes [i];
+        node->value = s_node_value (node);
+        if (node->value && (node->parent >= 0))
+            self->nodes [node->parent].true_count++;
+    }
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of distinct inputs
+
+int
+gpio_expr_inputs (gpio_expr_t *self)
+{
+    assert (self);
+    return self->input_count;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the sensor name of an input
+
+const char *
+gpio_expr_input (gpio_expr_t *self, int index)
+{
+    assert (self);
+    return ((index >= 0) && (index < self->input_count))? self->names [index] : NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the index of the input for a sensor name
+
+int
+gpio_expr_find (gpio_expr_t *self, const char *name)
+{
+    assert (self);
+    for (int i = 0; name && (i < self->input_count); i++) {
+        if (streq (self->names [i], name))
+            return i;
+    }
+    return -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the value of an input, and propagate it
+
+bool
+gpio_expr_set (gpio_expr_t *self, int index, bool value)
+{
+    assert (self);
+    if ((index < 0) || (index >= self->input_count))
+        return false;
+    int root = self->node_count - 1;
+    bool previous = self->nodes [root].value;
+    bool was_known = (self->known_count == self->input_count);
+    if (!self->known [index]) {
+        self->known [index] = true;
+        self->known_count++;
+    }
+    for (int leaf = self->first_leaf [index]; leaf >= 0; leaf = self->nodes [leaf].next_leaf) {
+        gpio_expr_node_t *node = &self->nodes [leaf];
+        if (node->value == value)
+            continue;
+        node->value = value;
+        self->updates++;
+        // Update the ancestors, until one doesn't change
+        while (node->parent >= 0) {
+            gpio_expr_node_t *parent = &self->nodes [node->parent];
+            parent->true_count += node->value? 1 : -1;
+            self->updates++;
+            bool parent_value = s_node_value (parent);
+            if (parent_value == parent->value)
+                break;
+            parent->value = parent_value;
+            node = parent;
+        }
+    }
+    if (self->known_count < self->input_count)
+        return false;
+    return !was_known || (self->nodes [root].value != previous);
+}
+
+//  --------------------------------------------------------------------------
+//  Get the value of the expression
+
+int
+gpio_expr_value (gpio_expr_t *self)
+{
+    assert (self);
+    if (self->known_count < self->input_count)
+        return -1;
+    return self->nodes [self->node_count - 1].value? 1 : 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of nodes recomputed
+
+uint64_t
+gpio_expr_updates (gpio_expr_t *self)
+{
+    assert (self);
+    return self->updates;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_expr
+
+void
+gpio_expr_destroy (gpio_expr_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_expr_t *self = *self_p;
+        //  Free class properties here
+        for (int i = 0; i < self->input_count; i++)
+            free (self->names [i]);
+        free (self->names);
+        free (self->first_leaf);
+        free (self->known);
+        free (self->nodes);
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_expr_test (bool verbose)
+{
+    printf (" * gpio_expr: ");
+
+    //  @selftest
+    // Syntax errors
+    assert (gpio_expr_new ("") == NULL);
+    assert (gpio_expr_new ("door-1 and") == NULL);
+    assert (gpio_expr_new ("(door-1 | door-2") == NULL);
+    assert (gpio_expr_new ("door-1 door-2") == NULL);
+    assert (gpio_expr_new ("and or") == NULL);
+
+    // Any door of the rack opened, and motion, or the override
+    gpio_expr_t *self = gpio_expr_new ("(door-1 | door-2 or door-3) && motion || !override");
+    assert (self);
+    assert (gpio_expr_inputs (self) == 5);
+    assert (streq (gpio_expr_input (self, 0), "door-1"));
+    assert (gpio_expr_find (self, "motion") == 3);
+    assert (gpio_expr_find (self, "door-4") == -1);
+    assert (gpio_expr_input (self, 5) == NULL);
+
+    // Unknown until all the inputs are set
+    assert (!gpio_expr_set (self, 0, false));
+    assert (!gpio_expr_set (self, 1, false));
+    assert (!gpio_expr_set (self, 2, false));
+    assert (!gpio_expr_set (self, 3, true));
+    assert (gpio_expr_value (self) == -1);
+    assert (gpio_expr_set (self, 4, true));
+    assert (gpio_expr_value (self) == 0);
+
+    // A door opened with motion
+    assert (gpio_expr_set (self, 1, true));
+    assert (gpio_expr_value (self) == 1);
+    // Another one doesn't change the result, and stops at the doors node
+    uint64_t updates = gpio_expr_updates (self);
+    assert (!gpio_expr_set (self, 2, true));
+    assert (gpio_expr_updates (self) == updates + 2);
+    // Setting the same value doesn't recompute anything
+    assert (!gpio_expr_set (self, 2, true));
+    assert (gpio_expr_updates (self) == updates + 2);
+    // No more motion
+    assert (gpio_expr_set (self, 3, false));
+    assert (gpio_expr_value (self) == 0);
+    // Override
+    assert (gpio_expr_set (self, 4, false));
+    assert (gpio_expr_value (self) == 1);
+    gpio_expr_destroy (&self);
+    assert (self == NULL);
+
+    // The same input several times, and nested negations
+    self = gpio_expr_new ("not (a and not a) and NOT NOT b");
+    assert (self);
+    assert (gpio_expr_inputs (self) == 2);
+    gpio_expr_set (self, 0, true);
+    assert (gpio_expr_set (self, 1, true));
+    assert (gpio_expr_value (self) == 1);
+    assert (!gpio_expr_set (self, 0, false));
+    assert (gpio_expr_value (self) == 1);
+    assert (gpio_expr_set (self, 1, false));
+    assert (gpio_expr_value (self) == 0);
+    gpio_expr_destroy (&self);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,83 @@
+/*  =========================================================================
+    gpio_expr - Boolean expression over sensor states
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_EXPR_H_INCLUDED
+#define GPIO_EXPR_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Compile a boolean expression over the states of sensors, made of sensor
+//  names (true when opened), 'not' (or '!'), 'and' (or '&'), 'or' (or '|')
+//  and parentheses. Return NULL on syntax error.
+FTY_SENSOR_GPIO_PRIVATE gpio_expr_t *
+    gpio_expr_new (const char *text);
+
+//  @interface
+//  Get the number of distinct inputs (sensor names) of the expression
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_expr_inputs (gpio_expr_t *self);
+
+//  @interface
+//  Get the sensor name of the input at 'index'
+FTY_SENSOR_GPIO_PRIVATE const char *
+    gpio_expr_input (gpio_expr_t *self, int index);
+
+//  @interface
+//  Get the index of the input for a sensor name, or -1 if none
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_expr_find (gpio_expr_t *self, const char *name);
+
+//  @interface
+//  Set the value of an input, and update the nodes which depend on it.
+//  Return true if the value of the expression has changed (or is known for
+//  the first time).
+FTY_SENSOR_GPIO_PRIVATE bool
+    gpio_expr_set (gpio_expr_t *self, int index, bool value);
+
+//  @interface
+//  Get the value of the expression: 1 (true), 0 (false), or -1 until all
+//  its inputs have been set
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_expr_value (gpio_expr_t *self);
+
+//  @interface
+//  Get the number of nodes recomputed since the compilation
+FTY_SENSOR_GPIO_PRIVATE uint64_t
+    gpio_expr_updates (gpio_expr_t *self);
+
+//  Destroy the gpio_expr
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_expr_destroy (gpio_expr_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_expr_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,280 @@
+/*  =========================================================================
+    gpio_filter - GPI samples debounce filter
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_filter - GPI samples debounce filter
+@discuss
+    Cut the spurious transitions caused by contact bounce or electromagnetic
+    interference, using two stages:
+    * a N-of-M majority vote over the last samples, kept as a shift register,
+    * a minimum stable time of the voted state before it gets accepted.
+    Both are cheap enough to run on every sample. A real transition is only
+    delayed by the time needed to collect the majority (which oversampling
+    shortens) and the stable time.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Structure of our class
+
+struct _gpio_filter_t {
+    int      samples;        // Size of the majority window (M)
+    int      threshold;      // Number of samples needed to win the vote (N)
+    int      stable_time;    // Time the voted state must be stable, msec
+    uint32_t history;        // Last samples, one bit each (1: opened)
+    int      count;          // Number of valid samples in history
+    int      state;          // Filtered state
+    int      candidate;      // Voted state, pending acceptance
+    int64_t  candidate_since;// When the voted state last changed, msec
+    bool     excursion;      // Raw samples have differed from the filtered state
+    uint64_t glitches;       // Number of rejected excursions
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_filter
+
+gpio_filter_t *
+gpio_filter_new (int samples, int threshold, int stable_time)
+{
+    gpio_filter_t *self = (gpio_filter_t *) zmalloc (sizeof (gpio_filter_t));
+    assert (self);
+    //  Initialize class properties here
+    if (samples < 1)
+        samples = 1;
+    if (samples > GPIO_FILTER_MAX_SAMPLES)
+        samples = GPIO_FILTER_MAX_SAMPLES;
+    // Both states can't win the vote at the same time
+    if (threshold <= samples / 2)
+        threshold = samples / 2 + 1;
+    if (threshold > samples)
+        threshold = samples;
+    self->samples = samples;
+    self->threshold = threshold;
+    self->stable_time = (stable_time > 0)? stable_time : 0;
+    gpio_filter_reset (self);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Return true if both filters have the same settings
+
+bool
+gpio_filter_same_settings (gpio_filter_t *self, gpio_filter_t *other)
+{
+    assert (self);
+    assert (other);
+    return (self->samples == other->samples)
+        && (self->threshold == other->threshold)
+        && (self->stable_time == other->stable_time);
+}
+
+//  --------------------------------------------------------------------------
+//  Forget the samples history and the filtered state
+
+void
+gpio_filter_reset (gpio_filter_t *self)
+{
+    assert (self);
+    self->history = 0;
+    self->count = 0;
+    self->state = GPIO_STATE_UNKNOWN;
+    self->candidate = GPIO_STATE_UNKNOWN;
+    self->candidate_since = 0;
+    self->excursion = false;
+}
+
+//  --------------------------------------------------------------------------
+//  Feed a raw sample, and return the filtered state
+
+int
+gpio_filter_sample (gpio_filter_t *self, int raw, int64_t now)
+{
+    assert (self);
+    if ((raw != GPIO_STATE_OPENED) && (raw != GPIO_STATE_CLOSED))
+        return self->state;
+
+    self->history = (self->history << 1) | ((raw == GPIO_STATE_OPENED)? 1 : 0);
+    if (self->count < self->samples)
+        self->count++;
+
+    // The first sample is trusted, so that startup is not delayed
+    if (self->state == GPIO_STATE_UNKNOWN) {
+        self->state = self->candidate = raw;
+        self->candidate_since = now;
+        return self->state;
+    }
+
+    // Majority vote; when no state wins, the previous vote stands
+    uint32_t mask = (self->samples == 32)? 0xffffffff : ((1u << self->samples) - 1);
+    int opened = __builtin_popcount (self->history & mask);
+    int closed = self->count - opened;
+    int candidate = self->candidate;
+    if (opened >= self->threshold)
+        candidate = GPIO_STATE_OPENED;
+    else
+    if (closed >= self->threshold)
+        candidate = GPIO_STATE_CLOSED;
+    if (candidate != self->candidate) {
+        self->candidate = candidate;
+        self->candidate_since = now;
+    }
+
+    // Stability of the vote
+    if ((self->candidate != self->state)
+        && (now - self->candidate_since >= self->stable_time)) {
+        self->state = self->candidate;
+        self->excursion = false;
+    }
+    else
+    if (raw != self->state)
+        self->excursion = true;
+    else
+    if (self->excursion && (self->candidate == self->state)) {
+        // Back to the filtered state, without having changed it
+        self->excursion = false;
+        self->glitches++;
+    }
+    return self->state;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the filtered state
+
+int
+gpio_filter_state (gpio_filter_t *self)
+{
+    assert (self);
+    return self->state;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the time at which the pending state will be accepted, or 0
+
+int64_t
+gpio_filter_deadline (gpio_filter_t *self)
+{
+    assert (self);
+    if ((self->stable_time == 0) || (self->candidate == self->state))
+        return 0;
+    return self->candidate_since + self->stable_time;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of rejected excursions
+
+uint64_t
+gpio_filter_glitches (gpio_filter_t *self)
+{
+    assert (self);
+    return self->glitches;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_filter
+
+void
+gpio_filter_destroy (gpio_filter_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_filter_t *self = *self_p;
+        //  Free class properties here
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_filter_test (bool verbose)
+{
+    printf (" * gpio_filter: ");
+
+    //  @selftest
+    // Pass-through
+    {
+        gpio_filter_t *self = gpio_filter_new (1, 1, 0);
+        assert (self);
+        assert (gpio_filter_state (self) == GPIO_STATE_UNKNOWN);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 0) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_sample (self, GPIO_STATE_OPENED, 10) == GPIO_STATE_OPENED);
+        assert (gpio_filter_sample (self, GPIO_STATE_UNKNOWN, 20) == GPIO_STATE_OPENED);
+        assert (gpio_filter_deadline (self) == 0);
+        gpio_filter_destroy (&self);
+        assert (self == NULL);
+    }
+    // 2-of-3 majority: single bounces are rejected, real changes are not
+    {
+        gpio_filter_t *self = gpio_filter_new (3, 0, 0);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 0) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 1) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 2) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_sample (self, GPIO_STATE_OPENED, 3) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 4) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_glitches (self) == 1);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 5) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_sample (self, GPIO_STATE_OPENED, 6) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_sample (self, GPIO_STATE_OPENED, 7) == GPIO_STATE_OPENED);
+        assert (gpio_filter_glitches (self) == 1);
+        gpio_filter_reset (self);
+        assert (gpio_filter_state (self) == GPIO_STATE_UNKNOWN);
+        gpio_filter_destroy (&self);
+    }
+    // Minimum stable time
+    {
+        gpio_filter_t *self = gpio_filter_new (1, 1, 100);
+        assert (gpio_filter_sample (self, GPIO_STATE_OPENED, 1000) == GPIO_STATE_OPENED);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 1010) == GPIO_STATE_OPENED);
+        assert (gpio_filter_deadline (self) == 1110);
+        assert (gpio_filter_sample (self, GPIO_STATE_OPENED, 1050) == GPIO_STATE_OPENED);
+        assert (gpio_filter_deadline (self) == 0);
+        assert (gpio_filter_glitches (self) == 1);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 1060) == GPIO_STATE_OPENED);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 1100) == GPIO_STATE_OPENED);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, 1160) == GPIO_STATE_CLOSED);
+        assert (gpio_filter_deadline (self) == 0);
+        gpio_filter_destroy (&self);
+    }
+    // Threshold is adjusted to a strict majority, window to its maximum
+    {
+        gpio_filter_t *self = gpio_filter_new (64, 2, 0);
+        gpio_filter_t *same = gpio_filter_new (GPIO_FILTER_MAX_SAMPLES, 0, -1);
+        gpio_filter_t *other = gpio_filter_new (GPIO_FILTER_MAX_SAMPLES, 0, 10);
+        assert (gpio_filter_same_settings (self, same));
+        assert (!gpio_filter_same_settings (self, other));
+        gpio_filter_destroy (&same);
+        gpio_filter_destroy (&other);
+        assert (gpio_filter_sample (self, GPIO_STATE_OPENED, 0) == GPIO_STATE_OPENED);
+        int64_t now = 1;
+        for (; now < 17; now++)
+            assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, now) == GPIO_STATE_OPENED);
+        assert (gpio_filter_sample (self, GPIO_STATE_CLOSED, now) == GPIO_STATE_CLOSED);
+        gpio_filter_destroy (&self);
+    }
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,87 @@
+/*  =========================================================================
+    gpio_filter - GPI samples debounce filter
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_FILTER_H_INCLUDED
+#define GPIO_FILTER_H_INCLUDED
+
+// Maximum size of the majority window
+#define GPIO_FILTER_MAX_SAMPLES 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new gpio_filter. A new state is accepted when at least
+//  'threshold' of the last 'samples' samples agree on it, and this for at
+//  least 'stable_time' msec. 'threshold' is adjusted to a strict majority
+//  when needed.
+FTY_SENSOR_GPIO_PRIVATE gpio_filter_t *
+    gpio_filter_new (int samples, int threshold, int stable_time);
+
+//  @interface
+//  Feed a raw sample (GPIO_STATE_OPENED or GPIO_STATE_CLOSED) read at 'now'
+//  (monotonic, msec). Other values are ignored. Return the filtered state.
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_filter_sample (gpio_filter_t *self, int raw, int64_t now);
+
+//  @interface
+//  Get the filtered state (GPIO_STATE_UNKNOWN until the first sample)
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_filter_state (gpio_filter_t *self);
+
+//  @interface
+//  Get the monotonic time at which a pending state will be accepted if it
+//  remains stable, or 0 if no state is pending
+FTY_SENSOR_GPIO_PRIVATE int64_t
+    gpio_filter_deadline (gpio_filter_t *self);
+
+//  @interface
+//  Get the number of glitches, i.e. excursions from the filtered state which
+//  have been rejected
+FTY_SENSOR_GPIO_PRIVATE uint64_t
+    gpio_filter_glitches (gpio_filter_t *self);
+
+//  @interface
+//  Return true if both filters have the same settings
+FTY_SENSOR_GPIO_PRIVATE bool
+    gpio_filter_same_settings (gpio_filter_t *self, gpio_filter_t *other);
+
+//  @interface
+//  Forget the samples history and the filtered state
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_filter_reset (gpio_filter_t *self);
+
+//  Destroy the gpio_filter
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_filter_destroy (gpio_filter_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_filter_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
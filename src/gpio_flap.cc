@@ -0,0 +1,220 @@
+/*  =========================================================================
+    gpio_flap - GPI flapping detector
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_flap - GPI flapping detector
+@discuss
+    Count the transitions of a sensor over a sliding window, using a ring of
+    their timestamps. Entering and leaving the flapping state use different
+    thresholds, so that a sensor toggling around the limit doesn't flap
+    between both modes.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Structure of our class
+
+struct _gpio_flap_t {
+    int      window;        // Sliding window, msec
+    int      threshold;     // Transitions within the window to start flapping
+    int      restore;       // Transitions within the window to stop flapping
+    int64_t  times [GPIO_FLAP_MAX_TRANSITIONS]; // Ring of transition timestamps
+    int      head;          // Index of the oldest transition
+    int      count;         // Number of transitions in the ring
+    bool     flapping;      // Is the sensor flapping?
+    uint64_t episodes;      // Number of flapping episodes
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_flap
+
+gpio_flap_t *
+gpio_flap_new (int window, int threshold, int restore)
+{
+    gpio_flap_t *self = (gpio_flap_t *) zmalloc (sizeof (gpio_flap_t));
+    assert (self);
+    //  Initialize class properties here
+    if (threshold < 2)
+        threshold = 2;
+    if (threshold > GPIO_FLAP_MAX_TRANSITIONS)
+        threshold = GPIO_FLAP_MAX_TRANSITIONS;
+    if ((restore < 0) || (restore >= threshold))
+        restore = threshold / 2;
+    self->window = (window > 0)? window : 0;
+    self->threshold = threshold;
+    self->restore = restore;
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Record a transition
+
+void
+gpio_flap_transition (gpio_flap_t *self, int64_t now)
+{
+    assert (self);
+    // When the ring is full, the oldest transition is overwritten
+    if (self->count == GPIO_FLAP_MAX_TRANSITIONS) {
+        self->head = (self->head + 1) % GPIO_FLAP_MAX_TRANSITIONS;
+        self->count--;
+    }
+    self->times [(self->head + self->count) % GPIO_FLAP_MAX_TRANSITIONS] = now;
+    self->count++;
+}
+
+//  --------------------------------------------------------------------------
+//  Expire old transitions and update the flapping state
+
+bool
+gpio_flap_update (gpio_flap_t *self, int64_t now)
+{
+    assert (self);
+    while ((self->count > 0) && (now - self->times [self->head] >= self->window)) {
+        self->head = (self->head + 1) % GPIO_FLAP_MAX_TRANSITIONS;
+        self->count--;
+    }
+    if (!self->flapping && (self->count >= self->threshold)) {
+        self->flapping = true;
+        self->episodes++;
+    }
+    else
+    if (self->flapping && (self->count <= self->restore))
+        self->flapping = false;
+    return self->flapping;
+}
+
+//  --------------------------------------------------------------------------
+//  Return true if the sensor is flapping
+
+bool
+gpio_flap_flapping (gpio_flap_t *self)
+{
+    assert (self);
+    return self->flapping;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of transitions within the window
+
+int
+gpio_flap_transitions (gpio_flap_t *self)
+{
+    assert (self);
+    return self->count;
+}
+
+//  --------------------------------------------------------------------------
+//  Return true if both detectors have the same settings
+
+bool
+gpio_flap_same_settings (gpio_flap_t *self, gpio_flap_t *other)
+{
+    assert (self);
+    assert (other);
+    return (self->window == other->window)
+        && (self->threshold == other->threshold)
+        && (self->restore == other->restore);
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of flapping episodes
+
+uint64_t
+gpio_flap_episodes (gpio_flap_t *self)
+{
+    assert (self);
+    return self->episodes;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_flap
+
+void
+gpio_flap_destroy (gpio_flap_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_flap_t *self = *self_p;
+        //  Free class properties here
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_flap_test (bool verbose)
+{
+    printf (" * gpio_flap: ");
+
+    //  @selftest
+    gpio_flap_t *self = gpio_flap_new (1000, 4, 1);
+    assert (self);
+
+    // A few transitions are not flapping
+    gpio_flap_transition (self, 0);
+    gpio_flap_transition (self, 100);
+    gpio_flap_transition (self, 200);
+    assert (!gpio_flap_update (self, 300));
+    assert (gpio_flap_transitions (self) == 3);
+
+    // Too many transitions in the window are
+    gpio_flap_transition (self, 400);
+    assert (gpio_flap_update (self, 400));
+    assert (gpio_flap_flapping (self));
+    assert (gpio_flap_episodes (self) == 1);
+
+    // Hysteresis: still flapping with 2 transitions left in the window
+    assert (gpio_flap_update (self, 1150));
+    assert (gpio_flap_transitions (self) == 2);
+
+    // Stable again
+    assert (!gpio_flap_update (self, 1300));
+    assert (gpio_flap_transitions (self) == 1);
+    assert (!gpio_flap_update (self, 1400));
+    assert (gpio_flap_transitions (self) == 0);
+
+    // The ring doesn't overflow
+    for (int64_t now = 2000; now < 2100; now++)
+        gpio_flap_transition (self, now);
+    assert (gpio_flap_update (self, 2100));
+    assert (gpio_flap_transitions (self) == GPIO_FLAP_MAX_TRANSITIONS);
+    assert (gpio_flap_episodes (self) == 2);
+
+    // Settings are compared once adjusted
+    gpio_flap_t *same = gpio_flap_new (1000, 4, 1);
+    gpio_flap_t *other = gpio_flap_new (1000, 4, -1);
+    assert (gpio_flap_same_settings (self, same));
+    assert (!gpio_flap_same_settings (self, other));
+    gpio_flap_destroy (&same);
+    gpio_flap_destroy (&other);
+
+    gpio_flap_destroy (&self);
+    assert (self == NULL);
+    //  @end
+    printf ("OK\n");
+}
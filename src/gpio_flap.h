@@ -0,0 +1,84 @@
+/*  =========================================================================
+    gpio_flap - GPI flapping detector
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_FLAP_H_INCLUDED
+#define GPIO_FLAP_H_INCLUDED
+
+// Maximum number of transitions tracked in the window
+#define GPIO_FLAP_MAX_TRANSITIONS 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new gpio_flap. A sensor starts flapping when it has at least
+//  'threshold' transitions within 'window' msec, and stops when it has no
+//  more than 'restore' transitions within the window.
+FTY_SENSOR_GPIO_PRIVATE gpio_flap_t *
+    gpio_flap_new (int window, int threshold, int restore);
+
+//  @interface
+//  Record a transition at 'now' (monotonic, msec)
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_flap_transition (gpio_flap_t *self, int64_t now);
+
+//  @interface
+//  Expire the transitions older than the window, and update the flapping
+//  state. Return true if the sensor is flapping.
+FTY_SENSOR_GPIO_PRIVATE bool
+    gpio_flap_update (gpio_flap_t *self, int64_t now);
+
+//  @interface
+//  Return true if the sensor is flapping
+FTY_SENSOR_GPIO_PRIVATE bool
+    gpio_flap_flapping (gpio_flap_t *self);
+
+//  @interface
+//  Get the number of transitions within the window, as of the last update
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_flap_transitions (gpio_flap_t *self);
+
+//  @interface
+//  Return true if both detectors have the same settings
+FTY_SENSOR_GPIO_PRIVATE bool
+    gpio_flap_same_settings (gpio_flap_t *self, gpio_flap_t *other);
+
+//  @interface
+//  Get the number of flapping episodes
+FTY_SENSOR_GPIO_PRIVATE uint64_t
+    gpio_flap_episodes (gpio_flap_t *self);
+
+//  Destroy the gpio_flap
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_flap_destroy (gpio_flap_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_flap_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
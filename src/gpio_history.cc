@@ -0,0 +1,267 @@
+/*  =========================================================================
+    gpio_history - Run-length encoded history of a sensor state
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_history - Run-length encoded history of a sensor state
+@discuss
+    Keep the recent states of a sensor in a fixed size ring of runs, each
+    run being a state with the times of its first and last samples, and its
+    number of samples. A sensor which doesn't change only updates its last
+    run, so the memory is bounded and the ring covers a long period.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Run of identical samples
+
+typedef struct {
+    int      state;         // State of the samples
+    int64_t  first;         // Time of the first sample, msec
+    int64_t  last;          // Time of the last sample, msec
+    uint32_t samples;       // Number of samples
+} gpio_history_run_t;
+
+//  Structure of our class
+
+struct _gpio_history_t {
+    gpio_history_run_t *runs;  // Ring of runs
+    int      size;          // Size of the ring
+    int      head;          // Index of the oldest run
+    int      count;         // Number of runs in the ring
+};
+
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_history
+
+gpio_history_t *
+gpio_history_new (int size)
+{
+    gpio_history_t *self = (gpio_history_t *) zmalloc (sizeof (gpio_history_t));
+    assert (self);
+    //  Initialize class properties here
+    self->size = (size > 0)? size : 1;
+    self->runs = (gpio_history_run_t *) zmalloc (self->size * sizeof (gpio_history_run_t));
+    assert (self->runs);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of runs the history can keep
+
+int
+gpio_history_size (gpio_history_t *self)
+{
+    assert (self);
+    return self->size;
+}
+
+//  --------------------------------------------------------------------------
+//  Change the number of runs the history can keep, keeping the newest ones
+
+void
+gpio_history_resize (gpio_history_t *self, int size)
+{
+    assert (self);
+    if (size < 1)
+        size = 1;
+    if (size == self->size)
+        return;
+    gpio_history_run_t *runs = (gpio_history_run_t *) zmalloc (size * sizeof (gpio_history_run_t));
+    assert (runs);
+    int kept = (self->count < size)? self->count : size;
+    for (int i = 0; i < kept; i++)
+        runs [i] = self->runs [(self->head + self->count - kept + i) % self->size];
+    free (self->runs);
+    self->runs = runs;
+    self->size = size;
+    self->head = 0;
+    self->count = kept;
+}
+
+//  --------------------------------------------------------------------------
+//  Record a sample
+
+void
+gpio_history_add (gpio_history_t *self, int64_t time, int state)
+{
+    assert (self);
+    if (self->count > 0) {
+        gpio_history_run_t *run = &self->runs [(self->head + self->count - 1) % self->size];
+        if ((run->state == state) && (run->samples < UINT32_MAX)) {
+            run->last = time;
+            run->samples++;
+            return;
+        }
+    }
+    // When the ring is full, the oldest run is overwritten
+    if (self->count == self->size) {
+        self->head = (self->head + 1) % self->size;
+        self->count--;
+    }
+    gpio_history_run_t *run = &self->runs [(self->head + self->count) % self->size];
+    run->state = state;
+    run->first = time;
+    run->last = time;
+    run->samples = 1;
+    self->count++;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of runs recorded
+
+int
+gpio_history_count (gpio_history_t *self)
+{
+    assert (self);
+    return self->count;
+}
+
+//  --------------------------------------------------------------------------
+//  Get a run, 0 being the oldest
+
+int
+gpio_history_run (gpio_history_t *self, int index, int *state,
+    int64_t *first, int64_t *last, uint32_t *samples)
+{
+    assert (self);
+    if ((index < 0) || (index >= self->count))
+        return -1;
+    gpio_history_run_t *run = &self->runs [(self->head + index) % self->size];
+    if (state)
+        *state = run->state;
+    if (first)
+        *first = run->first;
+    if (last)
+        *last = run->last;
+    if (samples)
+        *samples = run->samples;
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the index of the first run still lasting at 'time'. A run lasts
+//  until the first sample of the next one.
+
+int
+gpio_history_find (gpio_history_t *self, int64_t time)
+{
+    assert (self);
+    // Runs are ordered by time: binary search of the first run whose
+    // successor starts after 'time'
+    int low = 0, high = self->count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        int next = middle + 1;
+        if ((next < self->count)
+            && (self->runs [(self->head + next) % self->size].first <= time))
+            low = next;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_history
+
+void
+gpio_history_destroy (gpio_history_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_history_t *self = *self_p;
+        //  Free class properties here
+        free (self->runs);
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_history_test (bool verbose)
+{
+    printf (" * gpio_history: ");
+
+    //  @selftest
+    gpio_history_t *self = gpio_history_new (3);
+    assert (self);
+    assert (gpio_history_count (self) == 0);
+    assert (gpio_history_find (self, 0) == 0);
+    assert (gpio_history_run (self, 0, NULL, NULL, NULL, NULL) == -1);
+
+    // Identical samples are merged into a single run
+    gpio_history_add (self, 1000, GPIO_STATE_CLOSED);
+    gpio_history_add (self, 2000, GPIO_STATE_CLOSED);
+    gpio_history_add (self, 3000, GPIO_STATE_CLOSED);
+    assert (gpio_history_count (self) == 1);
+    int state;
+    int64_t first, last;
+    uint32_t samples;
+    assert (gpio_history_run (self, 0, &state, &first, &last, &samples) == 0);
+    assert (state == GPIO_STATE_CLOSED);
+    assert (first == 1000 && last == 3000 && samples == 3);
+
+    // Transitions start new runs
+    gpio_history_add (self, 4000, GPIO_STATE_OPENED);
+    gpio_history_add (self, 5000, GPIO_STATE_CLOSED);
+    gpio_history_add (self, 6000, GPIO_STATE_CLOSED);
+    assert (gpio_history_count (self) == 3);
+    assert (gpio_history_find (self, 0) == 0);
+    assert (gpio_history_find (self, 3500) == 0);
+    assert (gpio_history_find (self, 4000) == 1);
+    assert (gpio_history_find (self, 4999) == 1);
+    assert (gpio_history_find (self, 9000) == 2);
+
+    // The oldest run is overwritten when the ring is full
+    gpio_history_add (self, 7000, GPIO_STATE_OPENED);
+    assert (gpio_history_count (self) == 3);
+    assert (gpio_history_run (self, 0, &state, &first, &last, &samples) == 0);
+    assert (state == GPIO_STATE_OPENED);
+    assert (first == 4000 && last == 4000 && samples == 1);
+    assert (gpio_history_run (self, 2, &state, &first, NULL, NULL) == 0);
+    assert (state == GPIO_STATE_OPENED && first == 7000);
+
+    // Resizing keeps the newest runs
+    assert (gpio_history_size (self) == 3);
+    gpio_history_resize (self, 5);
+    assert (gpio_history_size (self) == 5);
+    assert (gpio_history_count (self) == 3);
+    gpio_history_add (self, 8000, GPIO_STATE_CLOSED);
+    assert (gpio_history_count (self) == 4);
+    gpio_history_resize (self, 2);
+    assert (gpio_history_count (self) == 2);
+    assert (gpio_history_run (self, 0, &state, &first, NULL, NULL) == 0);
+    assert (state == GPIO_STATE_OPENED && first == 7000);
+    assert (gpio_history_run (self, 1, &state, &first, NULL, NULL) == 0);
+    assert (state == GPIO_STATE_CLOSED && first == 8000);
+
+    gpio_history_destroy (&self);
+    assert (self == NULL);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,85 @@
+/*  =========================================================================
+    gpio_history - Run-length encoded history of a sensor state
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_HISTORY_H_INCLUDED
+#define GPIO_HISTORY_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new gpio_history, keeping up to 'size' runs of identical
+//  samples. When full, the oldest run is overwritten.
+FTY_SENSOR_GPIO_PRIVATE gpio_history_t *
+    gpio_history_new (int size);
+
+//  @interface
+//  Get the number of runs the history can keep
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_history_size (gpio_history_t *self);
+
+//  @interface
+//  Change the number of runs the history can keep, dropping the oldest ones
+//  if it shrinks.
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_history_resize (gpio_history_t *self, int size);
+
+//  @interface
+//  Record a sample of 'state' at 'time' (wall clock, msec). It extends the
+//  last run if the state is the same, and starts a new run otherwise.
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_history_add (gpio_history_t *self, int64_t time, int state);
+
+//  @interface
+//  Get the number of runs recorded
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_history_count (gpio_history_t *self);
+
+//  @interface
+//  Get the run at 'index' (0: oldest): its state, the times of its first
+//  and last samples, and its number of samples. Return 0 on success, -1 if
+//  'index' is out of range.
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_history_run (gpio_history_t *self, int index, int *state,
+        int64_t *first, int64_t *last, uint32_t *samples);
+
+//  @interface
+//  Get the index of the first run still lasting at 'time', or the number of
+//  runs if none.
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_history_find (gpio_history_t *self, int64_t time);
+
+//  Destroy the gpio_history
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_history_destroy (gpio_history_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_history_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
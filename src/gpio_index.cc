@@ -0,0 +1,200 @@
+/*  =========================================================================
+    gpio_index - Secondary index of the sensors
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_index - Secondary index of the sensors
+@discuss
+    Map the values of a sensor attribute (location, type, ...) to the set of
+    sensors having it, so that lookups are proportional to the result rather
+    than to the inventory. The index is maintained incrementally by its
+    owner, upon each change of the indexed attribute.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Structure of our class
+
+struct _gpio_index_t {
+    zhashx_t *sets;         // Key -> zlistx_t of items
+};
+
+//  Items are compared by address
+
+static int
+s_item_compare (const void *item1, const void *item2)
+{
+    return (item1 < item2)? -1 : ((item1 > item2)? 1 : 0);
+}
+
+static void
+s_set_destroy (void **item)
+{
+    zlistx_destroy ((zlistx_t **) item);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_index
+
+gpio_index_t *
+gpio_index_new (void)
+{
+    gpio_index_t *self = (gpio_index_t *) zmalloc (sizeof (gpio_index_t));
+    assert (self);
+    //  Initialize class properties here
+    self->sets = zhashx_new ();
+    assert (self->sets);
+    zhashx_set_destructor (self->sets, s_set_destroy);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Add an item under a key
+
+void
+gpio_index_insert (gpio_index_t *self, const char *key, void *item)
+{
+    assert (self);
+    assert (item);
+    zlistx_t *set = (zlistx_t *) zhashx_lookup (self->sets, key? key : "");
+    if (!set) {
+        set = zlistx_new ();
+        assert (set);
+        zlistx_set_comparator (set, s_item_compare);
+        zhashx_insert (self->sets, key? key : "", set);
+    }
+    if (!zlistx_find (set, item))
+        zlistx_add_end (set, item);
+}
+
+//  --------------------------------------------------------------------------
+//  Remove an item from a key
+
+void
+gpio_index_remove (gpio_index_t *self, const char *key, void *item)
+{
+    assert (self);
+    zlistx_t *set = (zlistx_t *) zhashx_lookup (self->sets, key? key : "");
+    if (!set)
+        return;
+    void *handle = zlistx_find (set, item);
+    if (handle)
+        zlistx_delete (set, handle);
+    if (zlistx_size (set) == 0)
+        zhashx_delete (self->sets, key? key : "");
+}
+
+//  --------------------------------------------------------------------------
+//  Move an item from a key to another
+
+void
+gpio_index_move (gpio_index_t *self, const char *old_key, const char *new_key, void *item)
+{
+    assert (self);
+    if (streq (old_key? old_key : "", new_key? new_key : ""))
+        return;
+    gpio_index_remove (self, old_key, item);
+    gpio_index_insert (self, new_key, item);
+}
+
+//  --------------------------------------------------------------------------
+//  Return the items indexed under a key, or NULL if none
+
+zlistx_t *
+gpio_index_lookup (gpio_index_t *self, const char *key)
+{
+    assert (self);
+    return (zlistx_t *) zhashx_lookup (self->sets, key? key : "");
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of items indexed under a key
+
+size_t
+gpio_index_count (gpio_index_t *self, const char *key)
+{
+    zlistx_t *set = gpio_index_lookup (self, key);
+    return set? zlistx_size (set) : 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_index
+
+void
+gpio_index_destroy (gpio_index_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_index_t *self = *self_p;
+        //  Free class properties here
+        zhashx_destroy (&self->sets);
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_index_test (bool verbose)
+{
+    printf (" * gpio_index: ");
+
+    //  @selftest
+    gpio_index_t *self = gpio_index_new ();
+    assert (self);
+
+    int door1, door2, water;
+    gpio_index_insert (self, "Rack1", &door1);
+    gpio_index_insert (self, "Rack1", &door2);
+    gpio_index_insert (self, "Rack1", &door2);    // Already indexed
+    gpio_index_insert (self, "Room1", &water);
+    gpio_index_insert (self, NULL, &water);
+    assert (gpio_index_count (self, "Rack1") == 2);
+    assert (gpio_index_count (self, "Room1") == 1);
+    assert (gpio_index_count (self, "") == 1);
+    assert (gpio_index_count (self, "Rack2") == 0);
+    assert (gpio_index_lookup (self, "Rack2") == NULL);
+
+    zlistx_t *set = gpio_index_lookup (self, "Rack1");
+    assert (set);
+    assert (zlistx_first (set) == &door1);
+    assert (zlistx_next (set) == &door2);
+
+    // Moving an item updates both sets, and drops the empty ones
+    gpio_index_move (self, "Rack1", "Rack2", &door1);
+    assert (gpio_index_count (self, "Rack1") == 1);
+    assert (gpio_index_count (self, "Rack2") == 1);
+    gpio_index_move (self, "Room1", "Room1", &water);
+    assert (gpio_index_count (self, "Room1") == 1);
+    gpio_index_remove (self, "Room1", &water);
+    assert (gpio_index_lookup (self, "Room1") == NULL);
+    gpio_index_remove (self, "Room1", &water);     // No more indexed
+
+    gpio_index_destroy (&self);
+    assert (self == NULL);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,74 @@
+/*  =========================================================================
+    gpio_index - Secondary index of the sensors
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_INDEX_H_INCLUDED
+#define GPIO_INDEX_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new gpio_index, mapping keys to sets of items (not owned)
+FTY_SENSOR_GPIO_PRIVATE gpio_index_t *
+    gpio_index_new (void);
+
+//  @interface
+//  Add an item under a key (NULL is indexed as an empty key)
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_index_insert (gpio_index_t *self, const char *key, void *item);
+
+//  @interface
+//  Remove an item from a key. Empty sets are dropped.
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_index_remove (gpio_index_t *self, const char *key, void *item);
+
+//  @interface
+//  Move an item from a key to another
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_index_move (gpio_index_t *self, const char *old_key, const char *new_key, void *item);
+
+//  @interface
+//  Return the items indexed under a key, or NULL if none. The list belongs
+//  to the index, and is only valid until its next change.
+FTY_SENSOR_GPIO_PRIVATE zlistx_t *
+    gpio_index_lookup (gpio_index_t *self, const char *key);
+
+//  @interface
+//  Get the number of items indexed under a key
+FTY_SENSOR_GPIO_PRIVATE size_t
+    gpio_index_count (gpio_index_t *self, const char *key);
+
+//  Destroy the gpio_index
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_index_destroy (gpio_index_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_index_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
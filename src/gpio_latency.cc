@@ -0,0 +1,206 @@
+/*  =========================================================================
+    gpio_latency - Latency histogram
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_latency - Latency histogram
+@discuss
+    Record latencies into a fixed size histogram, with exact buckets for the
+    smallest values, then GPIO_LATENCY_SUB_BUCKETS buckets per power of two,
+    so that the relative error is bounded whatever the magnitude of the
+    values. Recording is O(1) and allocation free, and percentiles are
+    computed from the bucket counts, the higher bound of a bucket being
+    reported (capped by the highest value recorded).
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Structure of our class
+
+struct _gpio_latency_t {
+    uint64_t buckets [GPIO_LATENCY_BUCKETS]; // Number of values per bucket
+    uint64_t count;         // Number of values recorded
+    int64_t  max;           // Highest value recorded
+};
+
+//  --------------------------------------------------------------------------
+//  Get the bucket of a value
+
+static int
+s_bucket (int64_t value)
+{
+    if (value < 16)
+        return (int) value;
+    int exponent = 63 - __builtin_clzll ((unsigned long long) value);
+    int index = 16 + (exponent - 4) * GPIO_LATENCY_SUB_BUCKETS
+        + (int) ((value >> (exponent - 3)) & (GPIO_LATENCY_SUB_BUCKETS - 1));
+    return (index < GPIO_LATENCY_BUCKETS)? index : GPIO_LATENCY_BUCKETS - 1;
+}
+
+//  Get the highest value of a bucket
+
+static int64_t
+s_bucket_high (int index)
+{
+    if (index < 16)
+        return index;
+    int exponent = (index - 16) / GPIO_LATENCY_SUB_BUCKETS + 4;
+    int64_t low = (int64_t) (GPIO_LATENCY_SUB_BUCKETS + (index - 16) % GPIO_LATENCY_SUB_BUCKETS) << (exponent - 3);
+    return low + ((int64_t) 1 << (exponent - 3)) - 1;
+}
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_latency
+
+gpio_latency_t *
+gpio_latency_new (void)
+{
+    gpio_latency_t *self = (gpio_latency_t *) zmalloc (sizeof (gpio_latency_t));
+    assert (self);
+    //  Initialize class properties here
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Record a latency
+
+void
+gpio_latency_record (gpio_latency_t *self, int64_t value)
+{
+    assert (self);
+    if (value < 0)
+        value = 0;
+    self->buckets [s_bucket (value)]++;
+    self->count++;
+    if (value > self->max)
+        self->max = value;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of latencies recorded
+
+uint64_t
+gpio_latency_count (gpio_latency_t *self)
+{
+    assert (self);
+    return self->count;
+}
+
+//  --------------------------------------------------------------------------
+//  Get a percentile of the latencies recorded
+
+int64_t
+gpio_latency_percentile (gpio_latency_t *self, double percent)
+{
+    assert (self);
+    if (self->count == 0)
+        return 0;
+    // Rank of the value, from 1
+    uint64_t rank = (uint64_t) ceil (percent * self->count / 100.0);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < GPIO_LATENCY_BUCKETS; i++) {
+        seen += self->buckets [i];
+        if (seen >= rank) {
+            int64_t high = s_bucket_high (i);
+            return (high < self->max)? high : self->max;
+        }
+    }
+    return self->max;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the highest latency recorded
+
+int64_t
+gpio_latency_max (gpio_latency_t *self)
+{
+    assert (self);
+    return self->max;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_latency
+
+void
+gpio_latency_destroy (gpio_latency_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_latency_t *self = *self_p;
+        //  Free class properties here
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_latency_test (bool verbose)
+{
+    printf (" * gpio_latency: ");
+
+    //  @selftest
+    gpio_latency_t *self = gpio_latency_new ();
+    assert (self);
+    assert (gpio_latency_count (self) == 0);
+    assert (gpio_latency_percentile (self, 50) == 0);
+    assert (gpio_latency_max (self) == 0);
+
+    // Small values are exact
+    for (int i = 1; i <= 10; i++)
+        gpio_latency_record (self, i);
+    assert (gpio_latency_count (self) == 10);
+    assert (gpio_latency_percentile (self, 50) == 5);
+    assert (gpio_latency_percentile (self, 99) == 10);
+    assert (gpio_latency_percentile (self, 0) == 1);
+    assert (gpio_latency_max (self) == 10);
+    gpio_latency_destroy (&self);
+    assert (self == NULL);
+
+    // Larger ones within 12.5%, and never above the maximum
+    self = gpio_latency_new ();
+    for (int i = 0; i < 98; i++)
+        gpio_latency_record (self, 1000);
+    gpio_latency_record (self, 50000);
+    gpio_latency_record (self, 123456);
+    int64_t p50 = gpio_latency_percentile (self, 50);
+    assert ((p50 >= 1000) && (p50 <= 1125));
+    int64_t p99 = gpio_latency_percentile (self, 99);
+    assert ((p99 >= 50000) && (p99 <= 56250));
+    assert (gpio_latency_percentile (self, 100) == 123456);
+    assert (gpio_latency_max (self) == 123456);
+
+    // Negative and huge values are clamped into the histogram
+    gpio_latency_record (self, -5);
+    gpio_latency_record (self, INT64_MAX);
+    assert (gpio_latency_count (self) == 102);
+    assert (gpio_latency_percentile (self, 0.5) == 0);
+    assert (gpio_latency_max (self) == INT64_MAX);
+    gpio_latency_destroy (&self);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,74 @@
+/*  =========================================================================
+    gpio_latency - Latency histogram
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_LATENCY_H_INCLUDED
+#define GPIO_LATENCY_H_INCLUDED
+
+// Number of buckets per power of two (resolution: 1/8 = 12.5%)
+#define GPIO_LATENCY_SUB_BUCKETS 8
+// Number of buckets: exact values below 16, then up to 2^40
+#define GPIO_LATENCY_BUCKETS (16 + 36 * GPIO_LATENCY_SUB_BUCKETS)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new, empty, gpio_latency
+FTY_SENSOR_GPIO_PRIVATE gpio_latency_t *
+    gpio_latency_new (void);
+
+//  @interface
+//  Record a latency (negative values are recorded as 0)
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_latency_record (gpio_latency_t *self, int64_t value);
+
+//  @interface
+//  Get the number of latencies recorded
+FTY_SENSOR_GPIO_PRIVATE uint64_t
+    gpio_latency_count (gpio_latency_t *self);
+
+//  @interface
+//  Get the latency below which 'percent' % of the recorded ones are, within
+//  the resolution of the histogram (0 if none recorded)
+FTY_SENSOR_GPIO_PRIVATE int64_t
+    gpio_latency_percentile (gpio_latency_t *self, double percent);
+
+//  @interface
+//  Get the highest latency recorded (0 if none recorded)
+FTY_SENSOR_GPIO_PRIVATE int64_t
+    gpio_latency_max (gpio_latency_t *self);
+
+//  Destroy the gpio_latency
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_latency_destroy (gpio_latency_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_latency_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,293 @@
+/*  =========================================================================
+    gpio_prom - Prometheus text exposition
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    gpio_prom - Prometheus text exposition
+@discuss
+    Render metrics in the Prometheus text exposition format, into a memory
+    buffer, and write it atomically to a file, for the textfile collector of
+    the node exporter. The buffer is only built from values the caller
+    already has, so that the rendering has a bounded cost.
+@end
+*/
+
+#include "fty_sensor_gpio_classes.h"
+
+//  Structure of our class
+
+struct _gpio_prom_t {
+    char    *prefix;        // Prefix of the metric names
+    char    *text;          // Text rendered so far
+    size_t  length;         // Length of the text
+    size_t  size;           // Size of the text buffer
+    size_t  samples;        // Number of samples added
+};
+
+//  --------------------------------------------------------------------------
+//  Append a string to the text, growing the buffer as needed
+
+static void
+s_append (gpio_prom_t *self, const char *string, size_t length)
+{
+    if (self->length + length + 1 > self->size) {
+        while (self->length + length + 1 > self->size)
+            self->size *= 2;
+        self->text = (char *) realloc (self->text, self->size);
+        assert (self->text);
+    }
+    memcpy (self->text + self->length, string, length);
+    self->length += length;
+    self->text [self->length] = '\0';
+}
+
+//  Append the prefixed name of a metric, with the characters not allowed in
+//  a metric name replaced by '_'
+
+static void
+s_append_name (gpio_prom_t *self, const char *name)
+{
+    s_append (self, self->prefix, strlen (self->prefix));
+    for (const char *c = name; *c; c++) {
+        char valid = (isalnum ((unsigned char) *c) || (*c == '_') || (*c == ':'))? *c : '_';
+        s_append (self, &valid, 1);
+    }
+}
+
+//  Append a label value or a help text, with '\', '"' (label values only)
+//  and new lines escaped
+
+static void
+s_append_escaped (gpio_prom_t *self, const char *string, bool quotes)
+{
+    for (const char *c = string; *c; c++) {
+        if (*c == '\\')
+            s_append (self, "\\\\", 2);
+        else
+        if (*c == '\n')
+            s_append (self, "\\n", 2);
+        else
+        if ((*c == '"') && quotes)
+            s_append (self, "\\\"", 2);
+        else
+            s_append (self, c, 1);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Create a new gpio_prom
+
+gpio_prom_t *
+gpio_prom_new (const char *prefix)
+{
+    gpio_prom_t *self = (gpio_prom_t *) zmalloc (sizeof (gpio_prom_t));
+    assert (self);
+    //  Initialize class properties here
+    self->prefix = strdup (prefix? prefix : "");
+    self->size = 4096;
+    self->text = (char *) zmalloc (self->size);
+    assert (self->prefix && self->text);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Add the HELP and TYPE lines of a metric
+
+void
+gpio_prom_family (gpio_prom_t *self, const char *name, const char *type, const char *help)
+{
+    assert (self);
+    assert (name);
+    if (help) {
+        s_append (self, "# HELP ", 7);
+        s_append_name (self, name);
+        s_append (self, " ", 1);
+        s_append_escaped (self, help, false);
+        s_append (self, "\n", 1);
+    }
+    if (type) {
+        s_append (self, "# TYPE ", 7);
+        s_append_name (self, name);
+        s_append (self, " ", 1);
+        s_append (self, type, strlen (type));
+        s_append (self, "\n", 1);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Add a sample of a metric, with its labels
+
+void
+gpio_prom_add (gpio_prom_t *self, const char *name, const char *value, ...)
+{
+    assert (self);
+    assert (name);
+    assert (value);
+    s_append_name (self, name);
+    va_list args;
+    va_start (args, value);
+    const char *label = va_arg (args, const char *);
+    bool first = true;
+    while (label) {
+        const char *label_value = va_arg (args, const char *);
+        s_append (self, first? "{" : ",", 1);
+        s_append (self, label, strlen (label));
+        s_append (self, "=\"", 2);
+        s_append_escaped (self, label_value? label_value : "", true);
+        s_append (self, "\"", 1);
+        first = false;
+        label = va_arg (args, const char *);
+    }
+    va_end (args);
+    if (!first)
+        s_append (self, "}", 1);
+    s_append (self, " ", 1);
+    s_append (self, value, strlen (value));
+    s_append (self, "\n", 1);
+    self->samples++;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of samples added
+
+size_t
+gpio_prom_samples (gpio_prom_t *self)
+{
+    assert (self);
+    return self->samples;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the text rendered so far
+
+const char *
+gpio_prom_text (gpio_prom_t *self)
+{
+    assert (self);
+    return self->text;
+}
+
+//  --------------------------------------------------------------------------
+//  Write the text to a file atomically
+
+int
+gpio_prom_save (gpio_prom_t *self, const char *path)
+{
+    assert (self);
+    assert (path);
+    size_t tmp_length = strlen (path) + 5;
+    char *tmp_path = (char *) zmalloc (tmp_length);
+    assert (tmp_path);
+    snprintf (tmp_path, tmp_length, "%s.tmp", path);
+
+    int rv = -1;
+    FILE *file = fopen (tmp_path, "w");
+    if (file) {
+        bool written = (fwrite (self->text, 1, self->length, file) == self->length)
+            && (fflush (file) == 0);
+        if ((fclose (file) == 0) && written && (rename (tmp_path, path) == 0))
+            rv = 0;
+        else
+            unlink (tmp_path);
+    }
+    zstr_free (&tmp_path);
+    return rv;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the gpio_prom
+
+void
+gpio_prom_destroy (gpio_prom_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        gpio_prom_t *self = *self_p;
+        //  Free class properties here
+        zstr_free (&self->prefix);
+        zstr_free (&self->text);
+        //  Free object itself
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+gpio_prom_test (bool verbose)
+{
+    printf (" * gpio_prom: ");
+
+    //  @selftest
+    //  Note: If your selftest reads SCMed fixture data, please keep it in
+    //  src/selftest-ro; if your test creates filesystem objects, please
+    //  do so under src/selftest-rw.
+    const char *SELFTEST_DIR_RW = "src/selftest-rw";
+    gpio_prom_t *self = gpio_prom_new ("fty_sensor_gpio_");
+    assert (self);
+    assert (gpio_prom_samples (self) == 0);
+    assert (streq (gpio_prom_text (self), ""));
+
+    gpio_prom_family (self, "state", "gauge", "State of the sensor\n(1: opened)");
+    gpio_prom_add (self, "state", "1", "asset", "sensorgpio-10", "port", "GPI1", NULL);
+    gpio_prom_add (self, "state", "0", "asset", "a \"quoted\\name\"", NULL);
+    gpio_prom_add (self, "poll.duration_p99_us", "1234", NULL);
+    assert (gpio_prom_samples (self) == 3);
+    assert (streq (gpio_prom_text (self),
+        "# HELP fty_sensor_gpio_state State of the sensor\\n(1: opened)\n"
+        "# TYPE fty_sensor_gpio_state gauge\n"
+        "fty_sensor_gpio_state{asset=\"sensorgpio-10\",port=\"GPI1\"} 1\n"
+        "fty_sensor_gpio_state{asset=\"a \\\"quoted\\\\name\\\"\"} 0\n"
+        "fty_sensor_gpio_poll_duration_p99_us 1234\n"));
+
+    // The buffer grows as needed
+    for (int i = 0; i < 1000; i++)
+        gpio_prom_add (self, "filler", "0", "index", "0123456789", NULL);
+    assert (gpio_prom_samples (self) == 1003);
+    assert (strlen (gpio_prom_text (self)) > 4096);
+
+    // Saved atomically, without any temporary file left
+    std::string path = std::string (SELFTEST_DIR_RW) + "/gpio_prom.prom";
+    std::string tmp_path = path + ".tmp";
+    assert (gpio_prom_save (self, path.c_str ()) == 0);
+    assert (access (tmp_path.c_str (), F_OK) != 0);
+    FILE *file = fopen (path.c_str (), "r");
+    assert (file);
+    char line [128];
+    assert (fgets (line, sizeof (line), file));
+    assert (streq (line, "# HELP fty_sensor_gpio_state State of the sensor\\n(1: opened)\n"));
+    fseek (file, 0, SEEK_END);
+    assert ((size_t) ftell (file) == strlen (gpio_prom_text (self)));
+    fclose (file);
+    unlink (path.c_str ());
+
+    // A missing directory is reported
+    std::string bad_path = std::string (SELFTEST_DIR_RW) + "/missing/gpio_prom.prom";
+    assert (gpio_prom_save (self, bad_path.c_str ()) == -1);
+
+    gpio_prom_destroy (&self);
+    assert (self == NULL);
+    gpio_prom_destroy (&self);
+    //  @end
+    printf ("OK\n");
+}
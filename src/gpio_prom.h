@@ -0,0 +1,77 @@
+/*  =========================================================================
+    gpio_prom - Prometheus text exposition
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef GPIO_PROM_H_INCLUDED
+#define GPIO_PROM_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @interface
+//  Create a new, empty, gpio_prom, whose metric names start with prefix
+FTY_SENSOR_GPIO_PRIVATE gpio_prom_t *
+    gpio_prom_new (const char *prefix);
+
+//  @interface
+//  Add the HELP and TYPE (counter, gauge or untyped) lines of a metric,
+//  before its samples
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_prom_family (gpio_prom_t *self, const char *name, const char *type, const char *help);
+
+//  @interface
+//  Add a sample of a metric, followed by its labels as a NULL terminated
+//  list of name and value pairs. Invalid characters of the metric name are
+//  replaced by '_', and the label values are escaped.
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_prom_add (gpio_prom_t *self, const char *name, const char *value, ...);
+
+//  @interface
+//  Get the number of samples added
+FTY_SENSOR_GPIO_PRIVATE size_t
+    gpio_prom_samples (gpio_prom_t *self);
+
+//  @interface
+//  Get the text rendered so far
+FTY_SENSOR_GPIO_PRIVATE const char *
+    gpio_prom_text (gpio_prom_t *self);
+
+//  @interface
+//  Write the text to a file atomically: to '<path>.tmp' first, then renamed,
+//  so that a reader never sees a partial file. Return 0 if OK, -1 otherwise.
+FTY_SENSOR_GPIO_PRIVATE int
+    gpio_prom_save (gpio_prom_t *self, const char *path);
+
+//  Destroy the gpio_prom
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_prom_destroy (gpio_prom_t **self_p);
+
+//  Self test of this class
+FTY_SENSOR_GPIO_PRIVATE void
+    gpio_prom_test (bool verbose);
+
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
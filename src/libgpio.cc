@@ -23,6 +23,12 @@
 @header
     libgpio - General Purpose Input/Output (GPIO) sensors library
 @discuss
+    The transitions of the GPIOs read or written can be recorded to a trace
+    file, one event per line: the time elapsed since the previous event
+    (usec), the direction (I or O), the GPx number and the value read or
+    written. Such a trace can then be replayed instead of the sysfs, at real
+    or accelerated speed, or one event per read, to reproduce the same
+    sequence of states.
 @end
 */
 
@@ -40,7 +46,27 @@ struct _libgpio_t {
     int  gpi_count;          // number of supported GPI
     zhashx_t *gpi_mapping;   // mapping for GPIs
     zhashx_t *gpo_mapping;   // mapping for GPOs
+    uint64_t stats [GPIO_STATS]; // Statistics of the accesses, updated atomically
+    FILE     *record_file;   // Trace being recorded (NULL: none)
+    int64_t  record_last;    // Monotonic time of the last event recorded, usec (0: none yet)
+    bool     replaying;      // true if a trace is replayed instead of the sysfs
+    struct _trace_event_t *replay_events; // Events of the trace replayed
+    size_t   replay_count;   // Number of events of the trace replayed
+    size_t   replay_next;    // Next event to replay
+    int64_t  replay_start;   // Monotonic time of the start of the replay, usec
+    double   replay_speed;   // Speed of the replay (0: one event per read)
+    zhashx_t *trace_values [2]; // Last value recorded or replayed per GPx number, per direction
 };
+
+// Event of a GPIO trace
+typedef struct _trace_event_t {
+    int64_t time;       // Time from the start of the trace, usec
+    int     direction;  // GPIO_DIRECTION_IN | GPIO_DIRECTION_OUT
+    int     number;     // GPx number
+    int     value;      // Value read
+} trace_event_t;
+
+#define GPIO_TRACE_HEADER "# fty-sensor-gpio trace 1"
 // FIXME: libgpio should be shared with -server and -asset too
 int  _gpo_count = 0;
 int  _gpi_count = 0;
@@ -50,6 +76,7 @@ int  _gpi_count = 0;
 static int libgpio_export(libgpio_t *self, int pin);
 static int libgpio_unexport(libgpio_t *self, int pin);
 static int libgpio_set_direction(libgpio_t *self, int pin, int dir);
+static int libgpio_set_edge(libgpio_t *self, int pin, const char *edge);
 static int mkpath(char* file_path, mode_t mode);
 // FIXME: use zsys_dir_create (...);
 
@@ -77,6 +104,122 @@ static void free_fn (void ** self_ptr)
     free (*self_ptr);
 }
 
+//  Count an event in the statistics. The GPIOs are accessed by several
+//  threads (server, edge watcher), so counters are updated atomically,
+//  without locking
+
+static inline void
+s_count (libgpio_t *self, int stat, uint64_t count = 1)
+{
+    __atomic_fetch_add (&self->stats [stat], count, __ATOMIC_RELAXED);
+}
+
+//  Counted system calls on the sysfs
+
+static int
+s_open (libgpio_t *self, const char *path, int flags)
+{
+    s_count (self, GPIO_STAT_SYSCALLS);
+    return open (path, flags, 0777);
+}
+
+static ssize_t
+s_read (libgpio_t *self, int fd, void *buffer, size_t size)
+{
+    s_count (self, GPIO_STAT_SYSCALLS);
+    return read (fd, buffer, size);
+}
+
+static ssize_t
+s_write (libgpio_t *self, int fd, const void *buffer, size_t size)
+{
+    s_count (self, GPIO_STAT_SYSCALLS);
+    return write (fd, buffer, size);
+}
+
+static off_t
+s_lseek (libgpio_t *self, int fd, off_t offset, int whence)
+{
+    s_count (self, GPIO_STAT_SYSCALLS);
+    return lseek (fd, offset, whence);
+}
+
+static int
+s_close (libgpio_t *self, int fd)
+{
+    s_count (self, GPIO_STAT_SYSCALLS);
+    return close (fd);
+}
+
+//  Get the monotonic time in usec, which times the trace events
+
+static int64_t
+s_mono_usecs (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//  Stop recording or replaying a trace, and forget the values of the GPIOs
+
+static void
+s_trace_stop (libgpio_t *self)
+{
+    if (self->record_file)
+        fclose (self->record_file);
+    self->record_file = NULL;
+    self->record_last = 0;
+    free (self->replay_events);
+    self->replay_events = NULL;
+    self->replay_count = 0;
+    self->replay_next = 0;
+    self->replaying = false;
+    for (int i = 0; i < 2; i++)
+        zhashx_purge (self->trace_values [i]);
+}
+
+//  Record the value read from a GPIO or written to a GPO, if it changed since
+//  the last one
+
+static void
+s_trace_record (libgpio_t *self, int direction, int GPx_number, int value)
+{
+    if (!self->record_file || (value == -1))
+        return;
+    int index = (direction == GPIO_DIRECTION_IN)? 0 : 1;
+    int *last = (int *) zhashx_lookup (self->trace_values [index], (const void *) &GPx_number);
+    if (last && (*last == value))
+        return;
+    zhashx_update (self->trace_values [index], (const void *) &GPx_number, (void *) &value);
+    int64_t now = s_mono_usecs ();
+    fprintf (self->record_file, "%" PRIi64 " %c %d %d\n", self->record_last? now - self->record_last : 0,
+        (direction == GPIO_DIRECTION_IN)? 'I' : 'O', GPx_number, value);
+    // Flushed right away, so that the trace of an incident survives a crash
+    fflush (self->record_file);
+    self->record_last = now;
+}
+
+//  Read a GPIO from the trace replayed, after applying the events due by now
+
+static int
+s_trace_replay_read (libgpio_t *self, int direction, int GPx_number)
+{
+    int64_t now = (int64_t) ((s_mono_usecs () - self->replay_start) * self->replay_speed);
+    bool step = (self->replay_speed <= 0);
+    while ((self->replay_next < self->replay_count)
+        && (step || (self->replay_events [self->replay_next].time <= now))) {
+        trace_event_t *event = &self->replay_events [self->replay_next++];
+        zhashx_update (self->trace_values [(event->direction == GPIO_DIRECTION_IN)? 0 : 1],
+            (const void *) &event->number, (void *) &event->value);
+        step = false;
+    }
+    int *value = (int *) zhashx_lookup (self->trace_values [(direction == GPIO_DIRECTION_IN)? 0 : 1],
+        (const void *) &GPx_number);
+    my_zsys_debug (self->verbose, "%s: replayed value '%i' of GPx #%i", __func__, value? *value : -1, GPx_number);
+    return value? *value : -1;
+}
+
 
 //  --------------------------------------------------------------------------
 //  Create a new libgpio
@@ -104,6 +247,13 @@ libgpio_new (void)
     zhashx_set_duplicator (self->gpo_mapping, dup_int_ptr);
     zhashx_set_destructor (self->gpo_mapping, free_fn);
     assert (self->gpo_mapping);
+    for (int i = 0; i < 2; i++) {
+        self->trace_values [i] = zhashx_new ();
+        zhashx_set_key_duplicator (self->trace_values [i], dup_int_ptr);
+        zhashx_set_duplicator (self->trace_values [i], dup_int_ptr);
+        zhashx_set_destructor (self->trace_values [i], free_fn);
+        assert (self->trace_values [i]);
+    }
 
     return self;
 }
@@ -176,20 +326,33 @@ libgpio_get_gpo_count ()
 
 //---------------------------------------------------------------------------
 // Add mapping GPI number -> HW pin number
-void
+// Return 0 on success, -1 if the port is out of the supported GPI range
+int
 libgpio_add_gpi_mapping (libgpio_t *self, int port_num, int pin_num)
 {
+    if ((port_num < 1) || (port_num > self->gpi_count)) {
+        zsys_error ("%s: GPI port %d is out of range (count is %d)", __func__, port_num, self->gpi_count);
+        return -1;
+    }
     my_zsys_debug (self->verbose, "%s: adding GPI mapping from port %d to pin %d", __func__, port_num, pin_num);
-    zhashx_insert (self->gpi_mapping, (void *)&port_num, (void *)&pin_num);
+    // Update, since a HW_CAP refresh may remap an already known port
+    zhashx_update (self->gpi_mapping, (void *)&port_num, (void *)&pin_num);
+    return 0;
 }
 
 //---------------------------------------------------------------------------
 // Add mapping GPO number -> HW pin number
-void
+// Return 0 on success, -1 if the port is out of the supported GPO range
+int
 libgpio_add_gpo_mapping (libgpio_t *self, int port_num, int pin_num)
 {
-    my_zsys_debug (self->verbose, "%s: adding GPIO mapping from port %d to pin %d", __func__, port_num, pin_num);
-    zhashx_insert (self->gpo_mapping, (void *)&port_num, (void *)&pin_num);
+    if ((port_num < 1) || (port_num > self->gpo_count)) {
+        zsys_error ("%s: GPO port %d is out of range (count is %d)", __func__, port_num, self->gpo_count);
+        return -1;
+    }
+    my_zsys_debug (self->verbose, "%s: adding GPO mapping from port %d to pin %d", __func__, port_num, pin_num);
+    zhashx_update (self->gpo_mapping, (void *)&port_num, (void *)&pin_num);
+    return 0;
 }
 //  --------------------------------------------------------------------------
 //  Set the test mode
@@ -267,6 +430,13 @@ libgpio_read (libgpio_t *self, int GPx_number, int direction)
         pin = libgpio_compute_pin_number (self, GPx_number, direction);
     else
         pin = *pin_ptr;
+    if (self->replaying) {
+        retvalue = s_trace_replay_read (self, direction, GPx_number);
+        s_count (self, GPIO_STAT_READS);
+        if (retvalue == -1)
+            s_count (self, GPIO_STAT_FAILURES);
+        return retvalue;
+    }
     my_zsys_debug (self->verbose, "%s: reading GPx #%i (pin %i)", __func__, GPx_number, pin);
     // Enable the desired GPIO
     if (libgpio_export(self, pin) == -1) {
@@ -281,6 +451,7 @@ libgpio_read (libgpio_t *self, int GPx_number, int direction)
 
         // Wait a bit for the sysfs to be created and udev rules to be applied
         // so that we get the right privileges applied
+        s_count (self, GPIO_STAT_RETRIES);
         zclock_sleep(500);
 
         if (retries-- > 0) {
@@ -297,28 +468,32 @@ libgpio_read (libgpio_t *self, int GPx_number, int direction)
     // trick #2 to allow testing
     if (self->test_mode)
         mkpath(path, 0777);
-    fd = open(path, O_RDONLY | ((self->test_mode)?O_CREAT:0), 0777);
+    fd = s_open(self, path, O_RDONLY | ((self->test_mode)?O_CREAT:0));
     if (fd == -1) {
         zsys_error("Failed to open gpio '%s' for reading!", path);
         goto end;
     }
 
-    if (read(fd, value_str, 3) <= 0) {
+    if (s_read(self, fd, value_str, 3) <= 0) {
         zsys_error("Failed to read value!");
-        close(fd);
+        s_close(self, fd);
         goto end;
     }
     retvalue = atoi(&value_str[0]);
 
     my_zsys_debug (self->verbose, "%s: read value '%c'", __func__, value_str[0]);
 
-    close(fd);
+    s_close(self, fd);
 
 end:
+    s_count (self, GPIO_STAT_READS);
     if (libgpio_unexport(self, pin) == -1) {
         my_zsys_debug (self->verbose, "%s: Failed to unexport...", __func__);
-        return -1;
+        retvalue = -1;
     }
+    if (retvalue == -1)
+        s_count (self, GPIO_STAT_FAILURES);
+    s_trace_record (self, direction, GPx_number, retvalue);
 
     return retvalue;
 }
@@ -326,81 +501,230 @@ end:
 //  Write a GPO (to enable or disable it)
 int
 libgpio_write (libgpio_t *self, int GPO_number, int value)
+{
+    int result = -1;
+    libgpio_write_bulk (self, 1, &GPO_number, &value, &result);
+    return result;
+}
+
+//  --------------------------------------------------------------------------
+//  Write several GPOs at once. Each sysfs step (export, direction, value,
+//  unexport) is applied to all the GPOs before the next one, so that the
+//  direction retries delay the whole bank only once.
+//  The result of each write (0 or -1) is stored in 'results' if not NULL.
+//  Return the number of failed writes.
+int
+libgpio_write_bulk (libgpio_t *self, int count, const int *GPO_numbers, const int *values, int *results)
 {
     static const char s_values_str[] = "01";
     char path[GPIO_VALUE_MAX];
-    int fd = -1;
-    int retval = -1;
     int retries = GPIO_MAX_RETRY;
+    int failures = 0;
+
+    if (count <= 0)
+        return 0;
+    int *pins = (int *) zmalloc (count * sizeof (int));
+    int *status = (int *) zmalloc (count * sizeof (int));
+    // status: 0 = to do, 1 = exported, 2 = direction set, -1 = failed
+    bool *exported = (bool *) zmalloc (count * sizeof (bool));
+
+    for (int i = 0; i < count; i++) {
+        // Sanity check
+        if (GPO_numbers[i] > self->gpo_count) {
+            zsys_error("Requested GPx is higher than the count of supported GPIO!");
+            status[i] = -1;
+            continue;
+        }
+        // While replaying a trace, the GPOs only keep their new value
+        if (self->replaying) {
+            zhashx_update (self->trace_values [1], (const void *) &GPO_numbers[i], (void *) &values[i]);
+            status[i] = 2;
+            continue;
+        }
+        int *pin_ptr = (int *)(zhashx_lookup (self->gpo_mapping, (const void *)&GPO_numbers[i]));
+        if (pin_ptr == NULL)
+            pins[i] = libgpio_compute_pin_number (self, GPO_numbers[i], GPIO_DIRECTION_OUT);
+        else
+            pins[i] = *pin_ptr;
 
-    // Sanity check
-    if (GPO_number > self->gpo_count) {
-        zsys_error("Requested GPx is higher than the count of supported GPIO!");
-        return -1;
-    }
-
-    int pin;
-    int *pin_ptr = (int *)(zhashx_lookup (self->gpo_mapping, (const void *)&GPO_number));
-    if (pin_ptr == NULL)
-        pin = libgpio_compute_pin_number (self, GPO_number, GPIO_DIRECTION_OUT);
-    else
-        pin = *pin_ptr;
-
-    my_zsys_debug (self->verbose, "%s: writing GPO #%i (pin %i)", __func__, GPO_number, pin);
+        my_zsys_debug (self->verbose, "%s: writing GPO #%i (pin %i)", __func__, GPO_numbers[i], pins[i]);
 
-    // Enable the desired GPIO
-    if (libgpio_export(self, pin) == -1) {
-        my_zsys_debug (self->verbose, "%s: Failed to export, aborting...", __func__);
-        goto end;
+        // Enable the desired GPIO
+        exported[i] = true;
+        if (libgpio_export(self, pins[i]) == -1) {
+            my_zsys_debug (self->verbose, "%s: Failed to export, aborting...", __func__);
+            status[i] = -1;
+        }
+        else
+            status[i] = 1;
     }
 
-    // Set its direction, with a possible delay
-    while (libgpio_set_direction(self, pin, GPIO_DIRECTION_OUT) == -1) {
+    // Set their direction, with a possible delay shared by all the GPOs
+    while (true) {
+        bool pending = false;
+        for (int i = 0; i < count; i++) {
+            if (status[i] != 1)
+                continue;
+            if (libgpio_set_direction(self, pins[i], GPIO_DIRECTION_OUT) == -1)
+                pending = true;
+            else
+                status[i] = 2;
+        }
+        if (!pending)
+            break;
 
         my_zsys_debug (self->verbose, "%s: Failed to set direction, retrying...", __func__);
-
+        if (retries-- <= 0) {
+            zsys_error("%s: Failed to set direction after %i tries. Aborting!", __func__, GPIO_MAX_RETRY);
+            for (int i = 0; i < count; i++) {
+                if (status[i] == 1)
+                    status[i] = -1;
+            }
+            break;
+        }
         // Wait a bit for the sysfs to be created and udev rules to be applied
         // so that we get the right privileges applied
+        s_count (self, GPIO_STAT_RETRIES);
         zclock_sleep(500);
+    }
 
-        if (retries-- > 0) {
+    for (int i = 0; i < count; i++) {
+        if (status[i] != 2)
+            continue;
+        // trick #2 to allow testing
+        snprintf(path, GPIO_VALUE_MAX, "%s/sys/class/gpio/gpio%d/value",
+            (self->test_mode)?SELFTEST_DIR_RW:"", // trick #1 to allow testing
+            pins[i]);
+        if (self->test_mode)
+            mkpath(path, 0777);
+        int fd = s_open(self, path, O_WRONLY | ((self->test_mode)?O_CREAT:0));
+        if (fd == -1) {
+            zsys_error("Failed to open gpio value for writing (path: %s)!", path);
+            status[i] = -1;
             continue;
         }
+        if (s_write(self, fd, &s_values_str[GPIO_STATE_CLOSED == values[i] ? 0 : 1], 1) != 1) {
+            zsys_error("Failed to write value!");
+            status[i] = -1;
+        }
+        my_zsys_debug (self->verbose, "%s: wrote value '%i' with result %i", __func__,
+            values[i], (status[i] == 2)? 0 : -1);
+        s_close(self, fd);
+    }
 
-        zsys_error("%s: Failed to set direction after %i tries. Aborting!", __func__, GPIO_MAX_RETRY);
-        goto end;
+    for (int i = 0; i < count; i++) {
+        if (exported[i] && (libgpio_unexport(self, pins[i]) == -1))
+            status[i] = -1;
+        int result = (status[i] == 2)? 0 : -1;
+        if (result != 0)
+            failures++;
+        else
+        if (!self->replaying)
+            s_trace_record (self, GPIO_DIRECTION_OUT, GPO_numbers[i], values[i]);
+        if (results)
+            results[i] = result;
+    }
+    free (pins);
+    free (status);
+    free (exported);
+    s_count (self, GPIO_STAT_WRITES, count);
+    s_count (self, GPIO_STAT_FAILURES, failures);
+    return failures;
+}
+
+//  --------------------------------------------------------------------------
+//  Watch the edges of a GPI: export it as an input, select the edge(s) that
+//  trigger an interrupt ("rising", "falling" or "both"), and open its value
+//  file. The returned descriptor signals POLLPRI upon each edge, and must
+//  be acknowledged with libgpio_watch_ack (). Return -1 on failure.
+int
+libgpio_watch (libgpio_t *self, int GPI_number, const char *edge)
+{
+    char path[GPIO_VALUE_MAX];
+    int retries = GPIO_MAX_RETRY;
+
+    if (!edge || !(streq (edge, "rising") || streq (edge, "falling") || streq (edge, "both"))) {
+        zsys_error("%s: invalid edge '%s'", __func__, edge? edge : "");
+        return -1;
+    }
+    // Sanity check
+    if (GPI_number > self->gpi_count) {
+        zsys_error("Requested GPx is higher than the count of supported GPIO!");
+        return -1;
+    }
+    if (self->replaying) {
+        zsys_error("%s: edges can't be watched while replaying a trace", __func__);
+        return -1;
+    }
+    int pin = libgpio_compute_pin_number (self, GPI_number, GPIO_DIRECTION_IN);
+    my_zsys_debug (self->verbose, "%s: watching %s edges of GPI #%i (pin %i)", __func__, edge, GPI_number, pin);
+
+    if (libgpio_export(self, pin) == -1) {
+        my_zsys_debug (self->verbose, "%s: Failed to export, aborting...", __func__);
+        return -1;
+    }
+    while (libgpio_set_direction(self, pin, GPIO_DIRECTION_IN) == -1) {
+        my_zsys_debug (self->verbose, "%s: Failed to set direction, retrying...", __func__);
+        if (retries-- <= 0) {
+            zsys_error("%s: Failed to set direction after %i tries. Aborting!", __func__, GPIO_MAX_RETRY);
+            libgpio_unexport(self, pin);
+            return -1;
+        }
+        // Wait a bit for the sysfs to be created and udev rules to be applied
+        s_count (self, GPIO_STAT_RETRIES);
+        zclock_sleep(500);
+    }
+    if (libgpio_set_edge(self, pin, edge) == -1) {
+        libgpio_unexport(self, pin);
+        return -1;
     }
 
-    // trick #2 to allow testing
     snprintf(path, GPIO_VALUE_MAX, "%s/sys/class/gpio/gpio%d/value",
         (self->test_mode)?SELFTEST_DIR_RW:"", // trick #1 to allow testing
         pin);
+    // trick #2 to allow testing
     if (self->test_mode)
         mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode)?O_CREAT:0), 0777);
+    int fd = s_open(self, path, O_RDONLY | O_NONBLOCK | ((self->test_mode)?O_CREAT:0));
     if (fd == -1) {
-        zsys_error("Failed to open gpio value for writing (path: %s)!", path);
-        retval = -1;
-        goto end;
-    }
-
-    if (write(fd, &s_values_str[GPIO_STATE_CLOSED == value ? 0 : 1], 1) != 1) {
-        zsys_error("Failed to write value!");
-        retval = -1;
+        zsys_error("Failed to open gpio '%s' for watching!", path);
+        libgpio_set_edge(self, pin, "none");
+        libgpio_unexport(self, pin);
+        return -1;
     }
-    else
-        retval = 0;
+    // Consume the current value, so that only the next edges are signaled
+    libgpio_watch_ack (self, fd);
+    return fd;
+}
 
-    my_zsys_debug (self->verbose, "%s: wrote value '%i' with result %i", __func__, value, retval);
+//  --------------------------------------------------------------------------
+//  Acknowledge an edge signaled on a watched GPI descriptor, and return the
+//  current value of the GPI, or -1 on failure
+int
+libgpio_watch_ack (libgpio_t *self, int fd)
+{
+    char value_str[3];
 
-    close(fd);
-end:
-    if (libgpio_unexport(self, pin) == -1) {
-        retval = -1;
+    memset(&value_str[0], 0, 3);
+    if ((s_lseek(self, fd, 0, SEEK_SET) == -1) || (s_read(self, fd, value_str, 2) <= 0)) {
+        my_zsys_debug (self->verbose, "%s: Failed to read value!", __func__);
+        return -1;
     }
-    return retval;
+    return atoi(&value_str[0]);
 }
 
+//  --------------------------------------------------------------------------
+//  Stop watching the edges of a GPI, closing its descriptor if valid
+void
+libgpio_unwatch (libgpio_t *self, int GPI_number, int fd)
+{
+    int pin = libgpio_compute_pin_number (self, GPI_number, GPIO_DIRECTION_IN);
+    my_zsys_debug (self->verbose, "%s: unwatching GPI #%i (pin %i)", __func__, GPI_number, pin);
+    if (fd >= 0)
+        s_close(self, fd);
+    libgpio_set_edge(self, pin, "none");
+    libgpio_unexport(self, pin);
+}
 
 //  --------------------------------------------------------------------------
 //  Get the textual name for a status
@@ -418,7 +742,7 @@ libgpio_get_status_string (int value)
             break;
         case GPIO_STATE_UNKNOWN:
         default:
-            status_str = ""; // FIXME: return "unknown"?
+            status_str = ""; // As published in the metrics, GPIO_STATUS says "unknown"
     }
     return status_str;
 }
@@ -446,6 +770,105 @@ libgpio_get_status_value (const char* status_name)
     return status_value;
 }
 
+//  --------------------------------------------------------------------------
+//  Get a statistic of the accesses to the GPIOs
+
+uint64_t
+libgpio_get_stat (libgpio_t *self, int stat)
+{
+    if (!self || (stat < 0) || (stat >= GPIO_STATS))
+        return 0;
+    return __atomic_load_n (&self->stats [stat], __ATOMIC_RELAXED);
+}
+
+//  --------------------------------------------------------------------------
+//  Record the transitions of the GPIOs read or written to a trace file
+
+int
+libgpio_record (libgpio_t *self, const char *path)
+{
+    s_trace_stop (self);
+    if (!path)
+        return 0;
+    self->record_file = fopen (path, "w");
+    if (!self->record_file) {
+        zsys_error("%s: can't create trace '%s'", __func__, path);
+        return -1;
+    }
+    fprintf (self->record_file, "%s\n", GPIO_TRACE_HEADER);
+    fflush (self->record_file);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Replay a trace file instead of accessing the GPIOs
+
+int
+libgpio_replay (libgpio_t *self, const char *path, double speed)
+{
+    s_trace_stop (self);
+    if (!path)
+        return 0;
+    FILE *file = fopen (path, "r");
+    if (!file) {
+        zsys_error("%s: can't open trace '%s'", __func__, path);
+        return -1;
+    }
+    char line [128];
+    int line_number = 0;
+    int64_t time = 0;
+    size_t size = 0;
+    int rv = 0;
+    while (fgets (line, sizeof (line), file)) {
+        line_number++;
+        if ((line[0] == '#') || (line[0] == '\n'))
+            continue;
+        int64_t delta;
+        char direction;
+        int number, value;
+        if ((sscanf (line, "%" SCNi64 " %c %d %d", &delta, &direction, &number, &value) != 4)
+            || (delta < 0) || ((direction != 'I') && (direction != 'O'))) {
+            zsys_error("%s: invalid event on line %i of trace '%s'", __func__, line_number, path);
+            rv = -1;
+            break;
+        }
+        if (self->replay_count == size) {
+            size = size? size * 2 : 256;
+            self->replay_events = (trace_event_t *) realloc (self->replay_events, size * sizeof (trace_event_t));
+            assert (self->replay_events);
+        }
+        time += delta;
+        trace_event_t *event = &self->replay_events [self->replay_count++];
+        event->time = time;
+        event->direction = (direction == 'I')? GPIO_DIRECTION_IN : GPIO_DIRECTION_OUT;
+        event->number = number;
+        event->value = value;
+        // The first value of each GPIO is its value from the start
+        int index = (direction == 'I')? 0 : 1;
+        if (!zhashx_lookup (self->trace_values [index], (const void *) &number))
+            zhashx_update (self->trace_values [index], (const void *) &number, (void *) &value);
+    }
+    fclose (file);
+    if (rv == -1) {
+        s_trace_stop (self);
+        return -1;
+    }
+    self->replaying = true;
+    self->replay_speed = (speed > 0)? speed : 0;
+    self->replay_start = s_mono_usecs ();
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of events of the trace not replayed yet
+
+size_t
+libgpio_replay_remaining (libgpio_t *self)
+{
+    assert (self);
+    return self->replay_count - self->replay_next;
+}
+
 //  --------------------------------------------------------------------------
 //  Destroy the libgpio
 
@@ -456,8 +879,11 @@ libgpio_destroy (libgpio_t **self_p)
     if (*self_p) {
         libgpio_t *self = *self_p;
         //  Free class properties here
+        s_trace_stop (self);
         zhashx_destroy (&self->gpi_mapping);
         zhashx_destroy (&self->gpo_mapping);
+        zhashx_destroy (&self->trace_values [0]);
+        zhashx_destroy (&self->trace_values [1]);
         //  Free object itself
         free (self);
         *self_p = NULL;
@@ -522,11 +948,137 @@ libgpio_test (bool verbose)
     // Read test
     assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
 
+    // Bulk write test, with an invalid GPO which doesn't prevent the others
+    {
+        int gpos[] = { 2, 99, 3 };
+        int values[] = { GPIO_STATE_OPENED, GPIO_STATE_OPENED, GPIO_STATE_CLOSED };
+        int results[3];
+        assert( libgpio_write_bulk (self, 3, gpos, values, results) == 1 );
+        assert( results[0] == 0 );
+        assert( results[1] == -1 );
+        assert( results[2] == 0 );
+        assert( libgpio_read (self, 2, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED );
+        assert( libgpio_read (self, 3, GPIO_DIRECTION_OUT) == GPIO_STATE_CLOSED );
+    }
+
+    // Statistics: 4 writes (1 failed) and 3 reads so far, each one opening,
+    // writing (or reading) and closing the export, direction, value and
+    // unexport files
+    assert( libgpio_get_stat (self, GPIO_STAT_WRITES) == 4 );
+    assert( libgpio_get_stat (self, GPIO_STAT_READS) == 3 );
+    assert( libgpio_get_stat (self, GPIO_STAT_FAILURES) == 1 );
+    assert( libgpio_get_stat (self, GPIO_STAT_RETRIES) == 0 );
+    assert( libgpio_get_stat (self, GPIO_STAT_SYSCALLS) == 6 * 4 * 3 );
+    assert( libgpio_get_stat (self, GPIO_STATS) == 0 );
+
+    // Edge watch test: the sysfs files are regular files in test mode, so
+    // only the setup and the value reads can be checked
+    {
+        assert( libgpio_watch (self, 4, "sideways") == -1 );
+        assert( libgpio_watch (self, 99, "rising") == -1 );
+        assert( libgpio_write (self, 4, GPIO_STATE_OPENED) == 0 );
+        int fd = libgpio_watch (self, 4, "rising");
+        assert( fd >= 0 );
+        std::string edge_fn = string(SELFTEST_DIR_RW) + "/sys/class/gpio/gpio4/edge";
+        FILE *edge_file = fopen (edge_fn.c_str (), "r");
+        assert (edge_file);
+        char edge[16] = "";
+        assert( fgets (edge, sizeof (edge), edge_file) );
+        fclose (edge_file);
+        assert( streq (edge, "rising") );
+        assert( libgpio_watch_ack (self, fd) == GPIO_STATE_OPENED );
+        assert( libgpio_watch_ack (self, fd) == GPIO_STATE_OPENED );
+        libgpio_unwatch (self, 4, fd);
+        edge_file = fopen (edge_fn.c_str (), "r");
+        assert (edge_file);
+        assert( fgets (edge, sizeof (edge), edge_file) );
+        fclose (edge_file);
+        assert( streq (edge, "none") );
+    }
+
+    // Mapping test, with a port number beyond single digit
+    assert( libgpio_add_gpi_mapping (self, 10, 1) == 0 );
+    assert( libgpio_read (self, 10, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
+    // Ports out of the supported range are rejected
+    assert( libgpio_add_gpi_mapping (self, 11, 1) == -1 );
+    assert( libgpio_add_gpo_mapping (self, 6, 1) == -1 );
+    assert( libgpio_add_gpo_mapping (self, -1, 1) == -1 );
+    assert( libgpio_add_gpi_mapping (self, 0, 1) == -1 );
+
     // Value resolution test
     assert( libgpio_get_status_value("opened") == GPIO_STATE_OPENED );
     assert( libgpio_get_status_value("closed") == GPIO_STATE_CLOSED );
     assert( libgpio_get_status_value( libgpio_get_status_string(GPIO_STATE_CLOSED).c_str() ) == GPIO_STATE_CLOSED );
 
+    // Trace test: record the transitions read and written, then replay them
+    {
+        std::string trace_fn = string(SELFTEST_DIR_RW) + "/gpio.trace";
+        assert( libgpio_record (self, "/nonexistent/gpio.trace") == -1 );
+        assert( libgpio_record (self, trace_fn.c_str ()) == 0 );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
+        // Unchanged values are not recorded
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
+        assert( libgpio_write (self, 1, GPIO_STATE_OPENED) == 0 );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED );
+        assert( libgpio_read (self, 2, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED );
+        assert( libgpio_write (self, 1, GPIO_STATE_CLOSED) == 0 );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
+        assert( libgpio_record (self, NULL) == 0 );
+
+        FILE *trace_file = fopen (trace_fn.c_str (), "r");
+        assert (trace_file);
+        char line[64];
+        const char *expected[] = { GPIO_TRACE_HEADER, "I 1 0", "O 1 1", "I 1 1", "O 2 1", "O 1 0", "I 1 0" };
+        for (int i = 0; i < 7; i++) {
+            assert( fgets (line, sizeof (line), trace_file) );
+            line[strcspn (line, "\n")] = '\0';
+            if (i == 0)
+                assert( streq (line, expected[i]) );
+            else {
+                char *event = strchr (line, ' ');
+                assert( event && streq (event + 1, expected[i]) );
+            }
+        }
+        assert( !fgets (line, sizeof (line), trace_file) );
+        fclose (trace_file);
+
+        // Step mode: each read replays one more event, the first values
+        // being there from the start
+        assert( libgpio_replay (self, trace_fn.c_str (), 0) == 0 );
+        assert( libgpio_replay_remaining (self) == 6 );
+        assert( libgpio_read (self, 2, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED );
+        assert( libgpio_read (self, 2, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_OUT) == GPIO_STATE_CLOSED );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
+        assert( libgpio_replay_remaining (self) == 0 );
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
+        // GPIOs missing from the trace can't be read, nor watched
+        assert( libgpio_read (self, 3, GPIO_DIRECTION_IN) == -1 );
+        assert( libgpio_watch (self, 1, "both") == -1 );
+        // Writes only update the value of the GPOs
+        assert( libgpio_write (self, 3, GPIO_STATE_OPENED) == 0 );
+        assert( libgpio_read (self, 3, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED );
+
+        // Accelerated mode: the whole trace is replayed right away
+        assert( libgpio_replay (self, trace_fn.c_str (), 1e9) == 0 );
+        zclock_sleep (10);
+        assert( libgpio_read (self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED );
+        assert( libgpio_replay_remaining (self) == 0 );
+        assert( libgpio_replay (self, NULL, 0) == 0 );
+
+        // Invalid traces are rejected
+        trace_file = fopen (trace_fn.c_str (), "w");
+        assert (trace_file);
+        fprintf (trace_file, "%s\n0 I 1 0\n10 X 1 1\n", GPIO_TRACE_HEADER);
+        fclose (trace_file);
+        assert( libgpio_replay (self, trace_fn.c_str (), 1) == -1 );
+        assert( libgpio_replay_remaining (self) == 0 );
+        assert( libgpio_replay (self, "/nonexistent/gpio.trace", 1) == -1 );
+        remove (trace_fn.c_str ());
+    }
+
     // Delete all test files
     std::string sys_fn = string(SELFTEST_DIR_RW) + "/sys";
     zdir_t *dir = zdir_new (sys_fn.c_str(), NULL);
@@ -560,7 +1112,7 @@ libgpio_export(libgpio_t *self, int pin)
     // trick #2 to allow testing
     if (self->test_mode)
         mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode)?O_CREAT:0), 0777);
+    fd = s_open(self, path, O_WRONLY | ((self->test_mode)?O_CREAT:0));
     if (fd == -1) {
         zsys_error("%s: Failed to open %s for writing! %i", __func__, path, errno);
         return -1;
@@ -568,13 +1120,13 @@ libgpio_export(libgpio_t *self, int pin)
     my_zsys_debug (self->verbose, "%s: exporting pin %d", __func__, pin);
 
     bytes_written = snprintf(buffer, GPIO_BUFFER_MAX, "%d", pin);
-    if (write(fd, buffer, bytes_written) < bytes_written) {
+    if (s_write(self, fd, buffer, bytes_written) < bytes_written) {
         my_zsys_debug (self->verbose, "%s: ERROR: wrote less than %i bytes (errno %i)",
             __func__, bytes_written, errno);
         retval = -1;
     }
 
-    close(fd);
+    s_close(self, fd);
     return retval;
 }
 
@@ -595,20 +1147,20 @@ libgpio_unexport(libgpio_t *self, int pin)
     // trick #2 to allow testing
     if (self->test_mode)
         mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode)?O_CREAT:0), 0777);
+    fd = s_open(self, path, O_WRONLY | ((self->test_mode)?O_CREAT:0));
     if (fd == -1) {
       zsys_error("Failed to open unexport for writing!");
       return -1;
     }
 
     bytes_written = snprintf(buffer, GPIO_BUFFER_MAX, "%d", pin);
-    if (write(fd, buffer, bytes_written) < bytes_written) {
+    if (s_write(self, fd, buffer, bytes_written) < bytes_written) {
         my_zsys_debug (self->verbose, "%s: ERROR: wrote less than %i bytes",
             __func__, bytes_written);
         retval = -1;
     }
 
-    close(fd);
+    s_close(self, fd);
     return retval;
 }
 
@@ -631,19 +1183,51 @@ libgpio_set_direction(libgpio_t *self, int pin, int direction)
     // trick #2 to allow testing
     if (self->test_mode)
         mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode)?O_CREAT:0), 0777);
+    fd = s_open(self, path, O_WRONLY | ((self->test_mode)?O_CREAT:0));
     if (fd == -1) {
         my_zsys_debug (self->verbose,"%s: Failed to open %s for writing!", __func__, path);
         return -1;
     }
 
-    if (write(fd, &s_directions_str[GPIO_DIRECTION_IN == direction ? 0 : 3],
+    if (s_write(self, fd, &s_directions_str[GPIO_DIRECTION_IN == direction ? 0 : 3],
       GPIO_DIRECTION_IN == direction ? 2 : 3) == -1) {
         my_zsys_debug (self->verbose,"%s: Failed to set direction!", __func__);
         retval = -1;
     }
 
-    close(fd);
+    s_close(self, fd);
+    return retval;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the edge(s) of the current GPIO which trigger an interrupt
+//  ('none', 'rising', 'falling' or 'both')
+
+int
+libgpio_set_edge(libgpio_t *self, int pin, const char *edge)
+{
+    char path[GPIO_DIRECTION_MAX];
+    int retval = 0;
+    int fd;
+
+    snprintf(path, GPIO_DIRECTION_MAX, "%s/sys/class/gpio/gpio%d/edge",
+        ((self->test_mode)?SELFTEST_DIR_RW:""), // trick #1 to allow testing
+        pin);
+    // trick #2 to allow testing
+    if (self->test_mode)
+        mkpath(path, 0777);
+    fd = s_open(self, path, O_WRONLY | ((self->test_mode)?O_CREAT|O_TRUNC:0));
+    if (fd == -1) {
+        zsys_error("%s: Failed to open %s for writing!", __func__, path);
+        return -1;
+    }
+
+    if (s_write(self, fd, edge, strlen (edge)) == -1) {
+        zsys_error("%s: Failed to set edge '%s'!", __func__, edge);
+        retval = -1;
+    }
+
+    s_close(self, fd);
     return retval;
 }
 
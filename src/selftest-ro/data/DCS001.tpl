@@ -6,3 +6,5 @@ gpx-direction  = GPI
 power-source   = internal
 alarm-severity = WARNING
 alarm-message  = Door has been $status
+debounce-samples = 3
+oversample     = 3
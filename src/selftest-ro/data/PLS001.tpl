@@ -0,0 +1,11 @@
+manufacturer   = Generic
+part-number    = PLS001
+type           = pulse-counter
+normal-state   = opened
+gpx-direction  = GPI
+power-source   = internal
+alarm-severity = WARNING
+alarm-message  = Pulse counter
+counter-edge   = rising
+counter-window = 60000
+poll-interval  = 60000
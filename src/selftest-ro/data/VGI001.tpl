@@ -0,0 +1,8 @@
+manufacturer   = Generic
+part-number    = VGI001
+type           = composite-sensor
+normal-state   = closed
+gpx-direction  = virtual
+power-source   = internal
+alarm-severity = WARNING
+alarm-message  = Composite sensor $device_name has been $status
@@ -6,3 +6,4 @@ gpx-direction  = GPI
 power-source   = internal
 alarm-severity = WARNING
 alarm-message  = Vibrations detected
+poll-interval  = 30000
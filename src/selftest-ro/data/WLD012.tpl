@@ -6,3 +6,7 @@ gpx-direction  = GPI
 power-source   = internal
 alarm-severity = WARNING
 alarm-message  = Water leak detected
+poll-interval  = 1000
+burst-interval = 250
+burst-duration = 10000
+flap-threshold = 0